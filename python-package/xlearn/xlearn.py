@@ -61,6 +61,15 @@ class XLearn(object):
             elif key == 'log':
                 _check_call(_LIB.XLearnSetStr(ctypes.byref(self.handle),
                                               c_str(key), c_str(value)))
+            elif key == 'format':
+                _check_call(_LIB.XLearnSetStr(ctypes.byref(self.handle),
+                                              c_str(key), c_str(value)))
+            elif key == 'field_map':
+                _check_call(_LIB.XLearnSetStr(ctypes.byref(self.handle),
+                                              c_str(key), c_str(value)))
+            elif key == 'huge_page':
+                _check_call(_LIB.XLearnSetStr(ctypes.byref(self.handle),
+                                              c_str(key), c_str(value)))
             elif key == 'lr':
                 _check_call(_LIB.XLearnSetFloat(ctypes.byref(self.handle),
                                                 c_str(key), ctypes.c_float(value)))
@@ -103,6 +112,22 @@ class XLearn(object):
             elif key == 'seed':
                 _check_call(_LIB.XLearnSetInt(ctypes.byref(self.handle),
                                               c_str(key), ctypes.c_uint(value)))
+            elif key == 'shuffle_chunk':
+                _check_call(_LIB.XLearnSetInt(ctypes.byref(self.handle),
+                                              c_str(key), ctypes.c_uint(value)))
+            elif key == 'prefetch':
+                _check_call(_LIB.XLearnSetInt(ctypes.byref(self.handle),
+                                              c_str(key), ctypes.c_uint(value)))
+            elif key == 'mem_budget':
+                _check_call(_LIB.XLearnSetInt(ctypes.byref(self.handle),
+                                              c_str(key), ctypes.c_uint(value)))
+            elif key == 'shuffle_window':
+                _check_call(_LIB.XLearnSetInt(ctypes.byref(self.handle),
+                                              c_str(key), ctypes.c_uint(value)))
+                self.setDiskShuffle()
+            elif key == 'reader_threads':
+                _check_call(_LIB.XLearnSetInt(ctypes.byref(self.handle),
+                                              c_str(key), ctypes.c_uint(value)))
             else:
                 raise Exception("Invalid key!", key)
 
@@ -195,12 +220,61 @@ class XLearn(object):
         _check_call(_LIB.XLearnSetBool(ctypes.byref(self.handle),
                                        c_str(key), ctypes.c_bool(True)))
 
+    def setDiskShuffle(self):
+        """Visit the blocks of on-disk training in random order"""
+        key = 'disk_shuffle'
+        _check_call(_LIB.XLearnSetBool(ctypes.byref(self.handle),
+                                       c_str(key), ctypes.c_bool(True)))
+
+    def setShuffleFiles(self):
+        """Visit the files in random order if the input is a list of files"""
+        key = 'shuffle_files'
+        _check_call(_LIB.XLearnSetBool(ctypes.byref(self.handle),
+                                       c_str(key), ctypes.c_bool(True)))
+
     def setNoBin(self):
         """Do not generate bin file"""
         key = 'bin_out'
         _check_call(_LIB.XLearnSetBool(ctypes.byref(self.handle),
                                        c_str(key), ctypes.c_bool(False)))
 
+    def setVerifyBin(self):
+        """Hash the whole text file to verify the bin file"""
+        key = 'verify_bin'
+        _check_call(_LIB.XLearnSetBool(ctypes.byref(self.handle),
+                                       c_str(key), ctypes.c_bool(True)))
+
+    def setBinCompress(self):
+        """Store the bin file in compressed format"""
+        key = 'bin_compress'
+        _check_call(_LIB.XLearnSetBool(ctypes.byref(self.handle),
+                                       c_str(key), ctypes.c_bool(True)))
+
+    def setCompress(self):
+        """Store training data in compressed format"""
+        key = 'compress'
+        _check_call(_LIB.XLearnSetBool(ctypes.byref(self.handle),
+                                       c_str(key), ctypes.c_bool(True)))
+
+    def setQuantize(self):
+        """Store feature value in bfloat16 format"""
+        self.setCompress()
+        key = 'quantize'
+        _check_call(_LIB.XLearnSetBool(ctypes.byref(self.handle),
+                                       c_str(key), ctypes.c_bool(True)))
+
+    def setRemap(self):
+        """Map the used feature ids to a dense range"""
+        key = 'remap'
+        _check_call(_LIB.XLearnSetBool(ctypes.byref(self.handle),
+                                       c_str(key), ctypes.c_bool(True)))
+
+    def setNuma(self):
+        """Interleave the model across the NUMA nodes, and pin the threads"""
+        key = 'numa'
+        _check_call(_LIB.XLearnSetBool(ctypes.byref(self.handle),
+                                       c_str(key), ctypes.c_bool(True)))
+
     def disableNorm(self):
         """Disable instance-wise normalization"""
         key = 'norm'
@@ -17,9 +17,19 @@ REM # This script runs all of the unit test for C++
 .\base\Release\file_util_test.exe
 .\base\Release\levenshtein_distance_test.exe
 .\base\Release\thread_pool_test.exe
+.\base\Release\mapped_file_test.exe
+.\base\Release\compressed_file_test.exe
+.\base\Release\file_list_test.exe
+.\base\Release\file_signature_test.exe
+.\base\Release\huge_page_test.exe
+.\base\Release\numa_test.exe
 .\c_api\Release\c_api_test.exe
 .\data\Release\data_structure_test.exe
 .\data\Release\model_parameters_test.exe
+.\data\Release\compressed_matrix_test.exe
+.\data\Release\mapped_matrix_test.exe
+.\data\Release\block_cache_test.exe
+.\data\Release\feature_id_map_test.exe
 .\loss\Release\cross_entropy_loss_test.exe
 .\loss\Release\loss_test.exe
 .\loss\Release\metric_test.exe
@@ -27,6 +37,7 @@ REM # This script runs all of the unit test for C++
 .\reader\Release\file_splitor_test.exe
 .\reader\Release\parser_test.exe
 .\reader\Release\reader_test.exe
+.\reader\Release\tokenizer_test.exe
 .\score\Release\ffm_score_test.exe
 .\score\Release\fm_score_test.exe
 .\score\Release\linear_score_test.exe
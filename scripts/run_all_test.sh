@@ -17,9 +17,19 @@
 ./base/file_util_test
 ./base/levenshtein_distance_test
 ./base/thread_pool_test
+./base/mapped_file_test
+./base/compressed_file_test
+./base/file_list_test
+./base/file_signature_test
+./base/huge_page_test
+./base/numa_test
 ./c_api/c_api_test
 ./data/data_structure_test
 ./data/model_parameters_test
+./data/compressed_matrix_test
+./data/mapped_matrix_test
+./data/block_cache_test
+./data/feature_id_map_test
 ./loss/cross_entropy_loss_test
 ./loss/loss_test
 ./loss/metric_test
@@ -27,6 +37,7 @@
 ./reader/file_splitor_test
 ./reader/parser_test
 ./reader/reader_test
+./reader/tokenizer_test
 ./score/ffm_score_test
 ./score/fm_score_test
 ./score/linear_score_test
@@ -0,0 +1,298 @@
+//------------------------------------------------------------------------------
+// Copyright (c) 2018 by contributors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//------------------------------------------------------------------------------
+
+/*
+This file is the implementation of the CompressedFile class.
+*/
+
+#include "src/base/compressed_file.h"
+
+#include <string.h>
+#include <algorithm>
+
+#ifdef XLEARN_USE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef XLEARN_USE_ZSTD
+#include <zstd.h>
+#endif
+
+#include "src/base/logging.h"
+#include "src/base/stl-util.h"
+
+CompressedFile::CompressedFile()
+  : codec_(kNone),
+    gz_file_(nullptr),
+    zstd_file_(nullptr),
+    zstd_ctx_(nullptr),
+    zstd_in_pos_(0),
+    zstd_in_size_(0),
+    zstd_ret_(0),
+    current_(nullptr),
+    started_(false),
+    stop_(false),
+    end_(false) { }
+
+// Detect the codec of a file from its magic bytes.
+CompressedFile::Codec CompressedFile::DetectCodec(
+                           const std::string& filename) {
+  FILE* file = fopen(filename.c_str(), "rb");
+  if (file == nullptr) { return kNone; }
+  unsigned char magic[4] = {0, 0, 0, 0};
+  size_t len = fread(magic, 1, 4, file);
+  fclose(file);
+  if (len >= 2 && magic[0] == 0x1f && magic[1] == 0x8b) {
+    return kGzip;
+  }
+  if (len == 4 && magic[0] == 0x28 && magic[1] == 0xb5 &&
+      magic[2] == 0x2f && magic[3] == 0xfd) {
+    return kZstd;
+  }
+  return kNone;
+}
+
+// Return "gzip", "zstd", or "none".
+std::string CompressedFile::CodecName(Codec codec) {
+  if (codec == kGzip) { return "gzip"; }
+  if (codec == kZstd) { return "zstd"; }
+  return "none";
+}
+
+// Open the file.
+void CompressedFile::Open(const std::string& filename, Codec codec) {
+  CHECK_NE(codec, kNone);
+  Close();
+  filename_ = filename;
+  codec_ = codec;
+  open_decoder();
+}
+
+// Stop the background thread and close the file.
+void CompressedFile::Close() {
+  if (!IsOpen()) { return; }
+  stop();
+  close_decoder();
+  STLDeleteElementsAndClear(&chunk_buf_);
+  free_chunk_.clear();
+  ready_chunk_.clear();
+  current_ = nullptr;
+  codec_ = kNone;
+}
+
+// Read at most len bytes of the decompressed data to buf.
+size_t CompressedFile::Read(char* buf, size_t len) {
+  CHECK(IsOpen());
+  if (!started_) { start(); }
+  size_t ret = 0;
+  while (ret < len) {
+    if (current_ == nullptr || current_->pos == current_->size) {
+      std::unique_lock<std::mutex> lock(mutex_);
+      if (current_ != nullptr) {
+        free_chunk_.push_back(current_);
+        current_ = nullptr;
+        cond_.notify_all();
+      }
+      cond_.wait(lock, [this] {
+        return end_ || !ready_chunk_.empty();
+      });
+      if (ready_chunk_.empty()) { break; }  // end of file
+      current_ = ready_chunk_.front();
+      ready_chunk_.pop_front();
+    }
+    size_t size = std::min(len - ret, current_->size - current_->pos);
+    memcpy(buf + ret, current_->data.data() + current_->pos, size);
+    current_->pos += size;
+    ret += size;
+  }
+  return ret;
+}
+
+// Return to the beginning of the file.
+void CompressedFile::Rewind() {
+  CHECK(IsOpen());
+  // Nothing has been read yet.
+  if (!started_) { return; }
+  stop();
+  close_decoder();
+  open_decoder();
+}
+
+// Start the background thread.
+void CompressedFile::start() {
+  if (chunk_buf_.empty()) {
+    for (int i = 0; i < kChunkNumber; ++i) {
+      Chunk* chunk = new Chunk;
+      chunk->data.resize(kChunkSize);
+      chunk->size = 0;
+      chunk->pos = 0;
+      chunk_buf_.push_back(chunk);
+    }
+  }
+  free_chunk_.assign(chunk_buf_.begin(), chunk_buf_.end());
+  ready_chunk_.clear();
+  current_ = nullptr;
+  stop_ = false;
+  end_ = false;
+  started_ = true;
+  thread_ = std::thread(&CompressedFile::decompress_loop, this);
+}
+
+// Stop the background thread.
+void CompressedFile::stop() {
+  if (!started_) { return; }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  cond_.notify_all();
+  thread_.join();
+  started_ = false;
+}
+
+// Decompress the file into free chunks.
+void CompressedFile::decompress_loop() {
+  for (;;) {
+    Chunk* chunk = nullptr;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      cond_.wait(lock, [this] {
+        return stop_ || !free_chunk_.empty();
+      });
+      if (stop_) { return; }
+      chunk = free_chunk_.front();
+      free_chunk_.pop_front();
+    }
+    chunk->size = decode(chunk->data.data(), chunk->data.size());
+    chunk->pos = 0;
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (chunk->size == 0) {
+      free_chunk_.push_back(chunk);
+      end_ = true;
+      cond_.notify_all();
+      return;
+    }
+    ready_chunk_.push_back(chunk);
+    cond_.notify_all();
+  }
+}
+
+// Open the decoder.
+void CompressedFile::open_decoder() {
+  if (codec_ == kGzip) {
+#ifdef XLEARN_USE_ZLIB
+    gzFile file = gzopen(filename_.c_str(), "rb");
+    if (file == nullptr) {
+      LOG(FATAL) << "Cannot open file: " << filename_;
+    }
+    gzbuffer(file, 1024 * 1024);
+    gz_file_ = file;
+    return;
+#endif
+  } else if (codec_ == kZstd) {
+#ifdef XLEARN_USE_ZSTD
+    zstd_file_ = fopen(filename_.c_str(), "rb");
+    if (zstd_file_ == nullptr) {
+      LOG(FATAL) << "Cannot open file: " << filename_;
+    }
+    ZSTD_DStream* ctx = ZSTD_createDStream();
+    ZSTD_initDStream(ctx);
+    zstd_ctx_ = ctx;
+    zstd_in_.resize(ZSTD_DStreamInSize());
+    zstd_in_pos_ = 0;
+    zstd_in_size_ = 0;
+    zstd_ret_ = 0;
+    return;
+#endif
+  }
+  LOG(FATAL) << filename_ << " is compressed by "
+             << CodecName(codec_) << ", but xLearn is built without "
+             << CodecName(codec_) << " support. Please decompress "
+             << "the file first, or rebuild xLearn with "
+             << (codec_ == kGzip ? "zlib." : "libzstd.");
+}
+
+// Close the decoder.
+void CompressedFile::close_decoder() {
+#ifdef XLEARN_USE_ZLIB
+  if (gz_file_ != nullptr) {
+    gzclose(static_cast<gzFile>(gz_file_));
+    gz_file_ = nullptr;
+  }
+#endif
+#ifdef XLEARN_USE_ZSTD
+  if (zstd_ctx_ != nullptr) {
+    ZSTD_freeDStream(static_cast<ZSTD_DStream*>(zstd_ctx_));
+    zstd_ctx_ = nullptr;
+  }
+  if (zstd_file_ != nullptr) {
+    fclose(zstd_file_);
+    zstd_file_ = nullptr;
+  }
+#endif
+}
+
+// Decompress at most len bytes to buf.
+size_t CompressedFile::decode(char* buf, size_t len) {
+#ifdef XLEARN_USE_ZLIB
+  if (codec_ == kGzip) {
+    gzFile file = static_cast<gzFile>(gz_file_);
+    size_t ret = 0;
+    while (ret < len) {
+      int size = gzread(file, buf + ret, len - ret);
+      if (size < 0) {
+        int err = 0;
+        LOG(FATAL) << "Fail to decompress " << filename_ << ": "
+                   << gzerror(file, &err);
+      }
+      if (size == 0) { break; }
+      ret += size;
+    }
+    return ret;
+  }
+#endif
+#ifdef XLEARN_USE_ZSTD
+  if (codec_ == kZstd) {
+    ZSTD_DStream* ctx = static_cast<ZSTD_DStream*>(zstd_ctx_);
+    ZSTD_outBuffer out = { buf, len, 0 };
+    while (out.pos < out.size) {
+      bool eof = false;
+      if (zstd_in_pos_ == zstd_in_size_) {
+        zstd_in_size_ = fread(zstd_in_.data(), 1,
+                              zstd_in_.size(), zstd_file_);
+        zstd_in_pos_ = 0;
+        eof = (zstd_in_size_ == 0);
+      }
+      ZSTD_inBuffer in = { zstd_in_.data(), zstd_in_size_, zstd_in_pos_ };
+      size_t pos = out.pos;
+      zstd_ret_ = ZSTD_decompressStream(ctx, &out, &in);
+      if (ZSTD_isError(zstd_ret_)) {
+        LOG(FATAL) << "Fail to decompress " << filename_ << ": "
+                   << ZSTD_getErrorName(zstd_ret_);
+      }
+      zstd_in_pos_ = in.pos;
+      // Nothing left in the decoder
+      if (eof && out.pos == pos) {
+        if (zstd_ret_ != 0) {
+          LOG(FATAL) << "Truncated zstd file: " << filename_;
+        }
+        break;
+      }
+    }
+    return out.pos;
+  }
+#endif
+  return 0;
+}
@@ -0,0 +1,141 @@
+//------------------------------------------------------------------------------
+// Copyright (c) 2018 by contributors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//------------------------------------------------------------------------------
+
+/*
+This file defines the CompressedFile class.
+*/
+
+#ifndef XLEARN_BASE_COMPRESSED_FILE_H_
+#define XLEARN_BASE_COMPRESSED_FILE_H_
+
+#include <stdio.h>
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "src/base/common.h"
+
+//------------------------------------------------------------------------------
+// CompressedFile reads a gzip or zstd compressed file as a stream of
+// plain bytes. The file is decompressed by a background thread into a
+// few chunks of memory, so the decompression overlaps with the work
+// of the caller. We can use it like this:
+//
+//   CompressedFile::Codec codec = CompressedFile::DetectCodec(filename);
+//   if (codec != CompressedFile::kNone) {
+//     CompressedFile file;
+//     file.Open(filename, codec);
+//     size_t ret = 0;
+//     while ((ret = file.Read(buf, buf_size)) > 0) {
+//       ... /* use buf[0, ret) */
+//     }
+//     file.Rewind();  /* read the file again */
+//   }
+//
+// The codec is detected from the magic bytes of the file, and the
+// support of each codec is enabled at build time (XLEARN_USE_ZLIB and
+// XLEARN_USE_ZSTD). Opening a file that has an unsupported codec is a
+// fatal error. Compressed file cannot be read by random access.
+//------------------------------------------------------------------------------
+class CompressedFile {
+ public:
+  enum Codec { kNone, kGzip, kZstd };
+
+  // Size of each chunk and the number of chunks
+  // that can be decompressed ahead of the reader.
+  static const size_t kChunkSize = 4 * 1024 * 1024;  // 4 MB
+  static const int kChunkNumber = 8;
+
+  CompressedFile();
+  ~CompressedFile() { Close(); }
+
+  // Detect the codec of a file from its magic bytes.
+  static Codec DetectCodec(const std::string& filename);
+
+  // Return "gzip", "zstd", or "none".
+  static std::string CodecName(Codec codec);
+
+  // Open the file. The background thread starts at the first Read().
+  void Open(const std::string& filename, Codec codec);
+
+  // Stop the background thread and close the file.
+  void Close();
+
+  // Whether a file is opened.
+  inline bool IsOpen() const { return codec_ != kNone; }
+
+  // Read at most len bytes of the decompressed data to buf.
+  // Return the number of bytes, which is less than len only
+  // when we reach the end of file.
+  size_t Read(char* buf, size_t len);
+
+  // Return to the beginning of the file.
+  void Rewind();
+
+ private:
+  /* Compressed file and its codec */
+  std::string filename_;
+  Codec codec_;
+  /* Decoder state of zlib (gzFile) or zstd */
+  void* gz_file_;
+  FILE* zstd_file_;
+  void* zstd_ctx_;
+  std::vector<char> zstd_in_;
+  size_t zstd_in_pos_;
+  size_t zstd_in_size_;
+  size_t zstd_ret_;
+  /* Chunks of decompressed data */
+  struct Chunk {
+    std::vector<char> data;
+    size_t size;
+    size_t pos;
+  };
+  std::vector<Chunk*> chunk_buf_;
+  std::deque<Chunk*> free_chunk_;
+  std::deque<Chunk*> ready_chunk_;
+  Chunk* current_;
+  /* Background decompression */
+  std::thread thread_;
+  std::mutex mutex_;
+  std::condition_variable cond_;
+  bool started_;
+  bool stop_;
+  bool end_;
+
+  // Open and close the decoder.
+  void open_decoder();
+  void close_decoder();
+
+  // Decompress at most len bytes to buf. Return
+  // the number of bytes, and 0 at the end of file.
+  size_t decode(char* buf, size_t len);
+
+  // Start and stop the background thread.
+  void start();
+  void stop();
+
+  // Decompress the file into free chunks until
+  // the end of file or stop_ is set.
+  void decompress_loop();
+
+  DISALLOW_COPY_AND_ASSIGN(CompressedFile);
+};
+
+#endif  // XLEARN_BASE_COMPRESSED_FILE_H_
@@ -0,0 +1,116 @@
+//------------------------------------------------------------------------------
+// Copyright (c) 2018 by contributors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//------------------------------------------------------------------------------
+
+/*
+This file tests compressed_file.h file.
+*/
+
+#include "gtest/gtest.h"
+
+#include <stdio.h>
+#include <string>
+
+#ifdef XLEARN_USE_ZLIB
+#include <zlib.h>
+#endif
+
+#include "src/base/compressed_file.h"
+
+const std::string kFilename = "./test_compressed_file";
+
+void write_file(const std::string& filename, const std::string& str) {
+  FILE* file = fopen(filename.c_str(), "wb");
+  fwrite(str.data(), 1, str.size(), file);
+  fclose(file);
+}
+
+TEST(CompressedFileTest, DetectCodec) {
+  write_file(kFilename, "1 2:0.5\n");
+  EXPECT_EQ(CompressedFile::DetectCodec(kFilename), CompressedFile::kNone);
+  write_file(kFilename, "\x1f\x8b\x08");
+  EXPECT_EQ(CompressedFile::DetectCodec(kFilename), CompressedFile::kGzip);
+  write_file(kFilename, "\x28\xb5\x2f\xfd\x00");
+  EXPECT_EQ(CompressedFile::DetectCodec(kFilename), CompressedFile::kZstd);
+  write_file(kFilename, "");
+  EXPECT_EQ(CompressedFile::DetectCodec(kFilename), CompressedFile::kNone);
+  EXPECT_EQ(CompressedFile::DetectCodec("./not_exist_file"),
+            CompressedFile::kNone);
+  remove(kFilename.c_str());
+}
+
+#ifdef XLEARN_USE_ZLIB
+
+// Compress str into a gzip file that has num_member members.
+void write_gzip(const std::string& filename,
+                const std::string& str,
+                int num_member) {
+  remove(filename.c_str());
+  size_t len = str.size() / num_member;
+  for (int i = 0; i < num_member; ++i) {
+    size_t end = (i == num_member - 1) ? str.size() : (i + 1) * len;
+    gzFile file = gzopen(filename.c_str(), "ab");
+    gzwrite(file, str.data() + i * len, end - i * len);
+    gzclose(file);
+  }
+}
+
+// Read the whole file by Read(len).
+std::string read_all(CompressedFile& file, size_t len) {
+  std::string result;
+  std::vector<char> buf(len);
+  for (;;) {
+    size_t ret = file.Read(buf.data(), len);
+    EXPECT_LE(ret, len);
+    result.append(buf.data(), ret);
+    if (ret < len) { break; }
+  }
+  // Keep returning 0 at the end of file
+  EXPECT_EQ(file.Read(buf.data(), len), 0);
+  return result;
+}
+
+TEST(CompressedFileTest, ReadGzip) {
+  // Larger than a few chunks
+  std::string str;
+  char line[64];
+  for (int i = 0; str.size() < 3 * CompressedFile::kChunkSize; ++i) {
+    snprintf(line, sizeof(line), "%d 1:%d 2:0.%d\n", i % 2, i, i);
+    str += line;
+  }
+  int member_list[] = {1, 3};
+  for (int m = 0; m < 2; ++m) {
+    write_gzip(kFilename, str, member_list[m]);
+    ASSERT_EQ(CompressedFile::DetectCodec(kFilename),
+              CompressedFile::kGzip);
+    CompressedFile file;
+    file.Open(kFilename, CompressedFile::kGzip);
+    EXPECT_TRUE(file.IsOpen());
+    EXPECT_EQ(read_all(file, 1000003), str);
+    file.Rewind();
+    EXPECT_EQ(read_all(file, CompressedFile::kChunkSize), str);
+    // Rewind in the middle of the file
+    file.Rewind();
+    char buf[100];
+    EXPECT_EQ(file.Read(buf, 100), 100);
+    file.Rewind();
+    EXPECT_EQ(read_all(file, 7777777), str);
+    file.Close();
+    EXPECT_FALSE(file.IsOpen());
+  }
+  remove(kFilename.c_str());
+}
+
+#endif  // XLEARN_USE_ZLIB
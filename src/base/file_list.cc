@@ -0,0 +1,209 @@
+//------------------------------------------------------------------------------
+// Copyright (c) 2018 by contributors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//------------------------------------------------------------------------------
+
+/*
+This file is the implementation of file_list.h
+*/
+
+#include "src/base/file_list.h"
+
+#include <sys/stat.h>
+#ifndef _MSC_VER
+#include <dirent.h>
+#include <glob.h>
+#else
+#include <io.h>
+#endif
+
+#include <algorithm>
+#include <fstream>
+
+#include "src/base/common.h"
+#include "src/base/logging.h"
+
+// Files generated by xLearn in the data directory
+static const char* kDerivedSuffix[] = { ".bin", ".cache", ".stats",
+                                        ".model", ".out" };
+
+// Whether str ends with suffix.
+static bool end_with(const std::string& str, const std::string& suffix) {
+  return str.size() >= suffix.size() &&
+         str.compare(str.size() - suffix.size(),
+                     suffix.size(), suffix) == 0;
+}
+
+// Whether the file should be used as input data.
+static bool is_data_file(const std::string& path) {
+  size_t pos = path.find_last_of("/\\");
+  std::string name = pos == std::string::npos ? path : path.substr(pos + 1);
+  if (name.empty() || name[0] == '.') { return false; }
+  for (size_t i = 0; i < sizeof(kDerivedSuffix) / sizeof(char*); ++i) {
+    if (end_with(name, kDerivedSuffix[i])) { return false; }
+  }
+  return !IsDirectory(path);
+}
+
+// Whether the path contains a wildcard.
+static bool is_glob(const std::string& path) {
+  return path.find_first_of("*?[") != std::string::npos;
+}
+
+// Whether the path is an absolute path.
+static bool is_absolute(const std::string& path) {
+#ifndef _MSC_VER
+  return !path.empty() && path[0] == '/';
+#else
+  return (!path.empty() && (path[0] == '/' || path[0] == '\\')) ||
+         (path.size() > 1 && path[1] == ':');
+#endif
+}
+
+// Match a glob pattern (or list a directory by using
+// "dir/*") and append the data files to the list.
+static void match_files(const std::string& pattern,
+                        std::vector<std::string>* files) {
+  std::vector<std::string> result;
+#ifndef _MSC_VER
+  glob_t glob_result;
+  if (glob(pattern.c_str(), 0, nullptr, &glob_result) == 0) {
+    for (size_t i = 0; i < glob_result.gl_pathc; ++i) {
+      result.push_back(glob_result.gl_pathv[i]);
+    }
+  }
+  globfree(&glob_result);
+#else
+  // _findfirst() only matches the last component of the path
+  size_t pos = pattern.find_last_of("/\\");
+  std::string dir = pos == std::string::npos ? "" : pattern.substr(0, pos+1);
+  struct _finddata_t info;
+  intptr_t handle = _findfirst(pattern.c_str(), &info);
+  if (handle != -1) {
+    do {
+      result.push_back(dir + info.name);
+    } while (_findnext(handle, &info) == 0);
+    _findclose(handle);
+  }
+#endif
+  std::sort(result.begin(), result.end());
+  for (size_t i = 0; i < result.size(); ++i) {
+    if (is_data_file(result[i])) {
+      files->push_back(result[i]);
+    }
+  }
+}
+
+// Read the manifest file and expand each line of it.
+static void read_manifest(const std::string& manifest,
+                          std::vector<std::string>* files) {
+  std::ifstream in(manifest);
+  if (!in.is_open()) {
+    LOG(WARNING) << "Cannot open manifest file: " << manifest;
+    return;
+  }
+  size_t pos = manifest.find_last_of("/\\");
+  std::string dir = pos == std::string::npos ? "" : manifest.substr(0, pos+1);
+  std::string line;
+  while (std::getline(in, line)) {
+    // Trim the blanks
+    size_t begin = line.find_first_not_of(" \t\r");
+    if (begin == std::string::npos || line[begin] == '#') { continue; }
+    size_t end = line.find_last_not_of(" \t\r");
+    std::string path = line.substr(begin, end - begin + 1);
+    if (!is_absolute(path)) { path = dir + path; }
+    std::vector<std::string> list;
+    if (!ExpandFileList(path, &list)) {
+      LOG(WARNING) << "No file is found for " << path 
+                   << " in manifest " << manifest;
+    }
+    files->insert(files->end(), list.begin(), list.end());
+  }
+}
+
+// Whether the path is a directory, a glob pattern, or a manifest.
+bool IsFileList(const std::string& path) {
+  if (path.empty()) { return false; }
+  return path[0] == '@' || is_glob(path) || IsDirectory(path);
+}
+
+// Whether the path is an existing directory.
+bool IsDirectory(const std::string& path) {
+#ifndef _MSC_VER
+  struct stat st;
+  return stat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+#else
+  struct _stat st;
+  return _stat(path.c_str(), &st) == 0 && (st.st_mode & _S_IFDIR);
+#endif
+}
+
+// Whether the path is "-" (stdin), a named pipe, or a device.
+bool IsStream(const std::string& path) {
+  if (path == "-") { return true; }
+#ifndef _MSC_VER
+  struct stat st;
+  return stat(path.c_str(), &st) == 0 &&
+         (S_ISFIFO(st.st_mode) || S_ISCHR(st.st_mode));
+#else
+  return false;
+#endif
+}
+
+// Expand the path into a list of files.
+bool ExpandFileList(const std::string& path,
+                    std::vector<std::string>* files) {
+  CHECK_NOTNULL(files);
+  files->clear();
+  if (path.empty()) { return false; }
+  if (path[0] == '@') {
+    read_manifest(path.substr(1), files);
+  } else if (is_glob(path)) {
+    match_files(path, files);
+  } else if (IsDirectory(path)) {
+    std::string dir = path;
+    if (!end_with(dir, "/") && !end_with(dir, "\\")) { dir += "/"; }
+    match_files(dir + "*", files);
+  } else {
+    std::ifstream in(path);
+    if (in.good()) { files->push_back(path); }
+  }
+  return !files->empty();
+}
+
+// Check whether the path is an existing file, or it
+// can be expanded to a non-empty list of files.
+bool InputExist(const std::string& path) {
+  // Don't open a pipe here, or the data in it could be lost.
+  if (IsStream(path)) { return true; }
+  std::vector<std::string> files;
+  return ExpandFileList(path, &files);
+}
+
+// Return a name for the output files of the given input path.
+std::string FileListName(const std::string& path) {
+  if (path == "-") { return "stdin"; }
+  std::string name = path;
+  if (!name.empty() && name[0] == '@') { name = name.substr(1); }
+  while (name.size() > 1 && (end_with(name, "/") || end_with(name, "\\"))) {
+    name.pop_back();
+  }
+  for (size_t i = 0; i < name.size(); ++i) {
+    if (name[i] == '*' || name[i] == '?' || 
+        name[i] == '[' || name[i] == ']') {
+      name[i] = '_';
+    }
+  }
+  return name;
+}
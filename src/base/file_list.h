@@ -0,0 +1,76 @@
+//------------------------------------------------------------------------------
+// Copyright (c) 2018 by contributors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//------------------------------------------------------------------------------
+
+/*
+This file contains facilitlies to expand an input path into a list of files.
+*/
+
+#ifndef XLEARN_BASE_FILE_LIST_H_
+#define XLEARN_BASE_FILE_LIST_H_
+
+#include <string>
+#include <vector>
+
+//------------------------------------------------------------------------------
+// An input path of xLearn can be a single file, or a list of files
+// given in one of the following ways:
+//
+//   (1) A directory: all the regular files in the directory, except
+//       the hidden files and the files generated by xLearn (.bin,
+//       .cache, .stats, .model and .out). Sub-directories are not
+//       visited.
+//
+//   (2) A glob pattern, e.g., "./data/part-*.txt".
+//
+//   (3) A manifest file with a '@' prefix, e.g., "@./train_list.txt".
+//       Each line of the manifest is a file, a directory or a glob
+//       pattern. Relative paths are relative to the manifest file.
+//       Empty lines and lines starting with '#' are ignored.
+//
+// The files from a directory or a glob pattern are sorted by name.
+// Usage:
+//
+//   std::vector<std::string> files;
+//   if (IsFileList(path)) {
+//     if (!ExpandFileList(path, &files)) { /* no file found */ }
+//   }
+//------------------------------------------------------------------------------
+
+// Whether the path is a directory, a glob pattern, or a manifest.
+bool IsFileList(const std::string& path);
+
+// Whether the path is an existing directory.
+bool IsDirectory(const std::string& path);
+
+// Whether the path is "-" (stdin), a named pipe, or a device,
+// which can only be read once from the beginning to the end.
+bool IsStream(const std::string& path);
+
+// Expand the path into a list of files. A single file is
+// returned as it is. Return false if no file is found.
+bool ExpandFileList(const std::string& path,
+                    std::vector<std::string>* files);
+
+// Check whether the path is an existing file or a stream, or it
+// can be expanded to a non-empty list of files.
+bool InputExist(const std::string& path);
+
+// Return a name that can be used as the prefix of the output
+// files (e.g., the model file) for the given input path. The
+// name of stdin ("-") is "stdin".
+std::string FileListName(const std::string& path);
+
+#endif  // XLEARN_BASE_FILE_LIST_H_
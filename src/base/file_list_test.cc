@@ -0,0 +1,136 @@
+//------------------------------------------------------------------------------
+// Copyright (c) 2018 by contributors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//------------------------------------------------------------------------------
+
+/*
+This file tests file_list.h file.
+*/
+
+#include "gtest/gtest.h"
+
+#include <stdio.h>
+#include <sys/stat.h>
+#ifdef _MSC_VER
+#include <direct.h>
+#endif
+
+#include <string>
+#include <vector>
+
+#include "src/base/file_list.h"
+
+const std::string kDir = "./test_file_list";
+
+void write_file(const std::string& filename, const std::string& str) {
+  FILE* file = fopen(filename.c_str(), "wb");
+  fwrite(str.data(), 1, str.size(), file);
+  fclose(file);
+}
+
+void make_dir(const std::string& dir) {
+#ifndef _MSC_VER
+  mkdir(dir.c_str(), 0755);
+#else
+  _mkdir(dir.c_str());
+#endif
+}
+
+TEST(FileListTest, ExpandFileList) {
+  make_dir(kDir);
+  make_dir(kDir + "/sub");
+  write_file(kDir + "/part-1.txt", "1\n");
+  write_file(kDir + "/part-0.txt", "0\n");
+  write_file(kDir + "/part-10.txt", "10\n");
+  write_file(kDir + "/other.csv", "0\n");
+  // Files generated by xLearn and hidden files are ignored
+  write_file(kDir + "/part-0.txt.bin", "");
+  write_file(kDir + "/part-0.txt.cache", "");
+  write_file(kDir + "/part-0.txt.stats", "");
+  write_file(kDir + "/part-_.txt.model", "");
+  write_file(kDir + "/.hidden", "");
+  write_file(kDir + "/sub/part-2.txt", "2\n");
+  std::vector<std::string> files;
+  // Single file
+  EXPECT_FALSE(IsFileList(kDir + "/part-0.txt"));
+  EXPECT_TRUE(ExpandFileList(kDir + "/part-0.txt", &files));
+  ASSERT_EQ(files.size(), 1);
+  EXPECT_EQ(files[0], kDir + "/part-0.txt");
+  EXPECT_FALSE(ExpandFileList(kDir + "/not_exist.txt", &files));
+  // Directory
+  EXPECT_TRUE(IsFileList(kDir));
+  EXPECT_TRUE(ExpandFileList(kDir, &files));
+  ASSERT_EQ(files.size(), 4);
+  EXPECT_EQ(files[0], kDir + "/other.csv");
+  EXPECT_EQ(files[1], kDir + "/part-0.txt");
+  EXPECT_EQ(files[2], kDir + "/part-1.txt");
+  EXPECT_EQ(files[3], kDir + "/part-10.txt");
+  EXPECT_TRUE(ExpandFileList(kDir + "/", &files));
+  EXPECT_EQ(files.size(), 4);
+  // Glob
+  EXPECT_TRUE(IsFileList(kDir + "/part-*"));
+  EXPECT_TRUE(ExpandFileList(kDir + "/part-?.txt", &files));
+  ASSERT_EQ(files.size(), 2);
+  EXPECT_EQ(files[0], kDir + "/part-0.txt");
+  EXPECT_EQ(files[1], kDir + "/part-1.txt");
+  EXPECT_FALSE(ExpandFileList(kDir + "/*.libsvm", &files));
+  EXPECT_FALSE(InputExist(kDir + "/*.libsvm"));
+  // Manifest
+  write_file(kDir + "/list.txt",
+             "# comment\n part-10.txt \n\nsub\r\n../test_file_list/part-0.txt\n");
+  EXPECT_TRUE(IsFileList("@" + kDir + "/list.txt"));
+  EXPECT_TRUE(ExpandFileList("@" + kDir + "/list.txt", &files));
+  ASSERT_EQ(files.size(), 3);
+  EXPECT_EQ(files[0], kDir + "/part-10.txt");
+  EXPECT_EQ(files[1], kDir + "/sub/part-2.txt");
+  EXPECT_EQ(files[2], kDir + "/../test_file_list/part-0.txt");
+  EXPECT_TRUE(InputExist("@" + kDir + "/list.txt"));
+  EXPECT_FALSE(InputExist("@" + kDir + "/not_exist.txt"));
+  // Clean up
+  const char* names[] = { "part-0.txt", "part-1.txt", "part-10.txt", 
+                          "other.csv", "part-0.txt.bin", "part-0.txt.cache", "part-0.txt.stats", "part-_.txt.model",
+                          ".hidden", "sub/part-2.txt", "list.txt" };
+  for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); ++i) {
+    remove((kDir + "/" + names[i]).c_str());
+  }
+  remove((kDir + "/sub").c_str());
+  remove(kDir.c_str());
+}
+
+TEST(FileListTest, FileListName) {
+  EXPECT_EQ(FileListName("./data/train.txt"), "./data/train.txt");
+  EXPECT_EQ(FileListName("./data/"), "./data");
+  EXPECT_EQ(FileListName("./data//"), "./data");
+  EXPECT_EQ(FileListName("@./list.txt"), "./list.txt");
+  EXPECT_EQ(FileListName("./data/part-*.txt"), "./data/part-_.txt");
+  EXPECT_EQ(FileListName("/"), "/");
+  EXPECT_EQ(FileListName("-"), "stdin");
+}
+
+TEST(FileListTest, IsStream) {
+  EXPECT_TRUE(IsStream("-"));
+  EXPECT_TRUE(InputExist("-"));
+  EXPECT_FALSE(IsStream("./not_exist_file"));
+  write_file("./test_file_list_stream", "1 2:0.5\n");
+  EXPECT_FALSE(IsStream("./test_file_list_stream"));
+  remove("./test_file_list_stream");
+#ifndef _MSC_VER
+  EXPECT_TRUE(IsStream("/dev/null"));
+  ASSERT_EQ(mkfifo("./test_file_list_fifo", 0600), 0);
+  EXPECT_TRUE(IsStream("./test_file_list_fifo"));
+  // The pipe is not opened by InputExist()
+  EXPECT_TRUE(InputExist("./test_file_list_fifo"));
+  remove("./test_file_list_fifo");
+#endif
+}
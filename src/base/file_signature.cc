@@ -0,0 +1,191 @@
+//------------------------------------------------------------------------------
+// Copyright (c) 2018 by contributors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//------------------------------------------------------------------------------
+
+/*
+This file is the implementation of file_signature.h
+*/
+
+#include "src/base/file_signature.h"
+
+#include <sys/stat.h>
+#include <string.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "src/base/file_util.h"
+
+//------------------------------------------------------------------------------
+// Implementation of StreamHash
+//------------------------------------------------------------------------------
+
+static const uint64 kPrime1 = 0x9e3779b185ebca87ULL;
+static const uint64 kPrime2 = 0xc2b2ae3d27d4eb4fULL;
+
+static inline uint64 rotl(uint64 x, int r) {
+  return (x << r) | (x >> (64 - r));
+}
+
+// Mix a word into hash_.
+void StreamHash::update_word(uint64 word) {
+  hash_ ^= rotl(word * kPrime2, 31) * kPrime1;
+  hash_ = rotl(hash_, 27) * kPrime1 + kPrime2;
+}
+
+// Hash the next len bytes of the stream.
+void StreamHash::Update(const char* buf, size_t len) {
+  length_ += len;
+  // Complete the word of the last call
+  if (tail_size_ > 0) {
+    size_t size = std::min(len, 8 - tail_size_);
+    memcpy(tail_ + tail_size_, buf, size);
+    tail_size_ += size;
+    buf += size;
+    len -= size;
+    if (tail_size_ < 8) { return; }
+    uint64 word;
+    memcpy(&word, tail_, 8);
+    update_word(word);
+    tail_size_ = 0;
+  }
+  while (len >= 8) {
+    uint64 word;
+    memcpy(&word, buf, 8);
+    update_word(word);
+    buf += 8;
+    len -= 8;
+  }
+  memcpy(tail_, buf, len);
+  tail_size_ = len;
+}
+
+// Return the hash value of the data so far.
+uint64 StreamHash::Value() const {
+  uint64 hash = hash_ ^ length_;
+  for (size_t i = 0; i < tail_size_; ++i) {
+    hash ^= (uint64)(unsigned char)tail_[i] * kPrime1;
+    hash = rotl(hash, 11) * kPrime2;
+  }
+  // Avalanche
+  hash ^= hash >> 33;
+  hash *= kPrime2;
+  hash ^= hash >> 29;
+  hash *= kPrime1;
+  hash ^= hash >> 32;
+  return hash;
+}
+
+//------------------------------------------------------------------------------
+// Implementation of FileSignature
+//------------------------------------------------------------------------------
+
+// Get the size, the modification time and the inode.
+bool FileSignature::load_stat(const std::string& filename) {
+#ifndef _MSC_VER
+  struct stat st;
+  if (stat(filename.c_str(), &st) != 0) { return false; }
+  size = st.st_size;
+  inode = st.st_ino;
+#if defined(__APPLE__)
+  mtime = (int64)st.st_mtimespec.tv_sec * 1000000000LL +
+          st.st_mtimespec.tv_nsec;
+#else
+  mtime = (int64)st.st_mtim.tv_sec * 1000000000LL +
+          st.st_mtim.tv_nsec;
+#endif
+#else
+  struct _stat64 st;
+  if (_stat64(filename.c_str(), &st) != 0) { return false; }
+  size = st.st_size;
+  inode = 0;
+  mtime = (int64)st.st_mtime * 1000000000LL;
+#endif
+  content_hash = 0;
+  return true;
+}
+
+// Get the signature of a file, except the content_hash.
+bool FileSignature::Load(const std::string& filename) {
+  return load_stat(filename) && load_samples(filename);
+}
+
+// Get the signature of the first length bytes of the file.
+bool FileSignature::Load(const std::string& filename, uint64 length) {
+  if (!load_stat(filename) || length > size) { return false; }
+  size = length;
+  return load_samples(filename);
+}
+
+// Hash the sampled chunks of the first size bytes.
+bool FileSignature::load_samples(const std::string& filename) {
+  FILE* file = fopen(filename.c_str(), "rb");
+  if (file == nullptr) { return false; }
+  // Hash the chunks at the evenly spaced offsets. A small
+  // file is hashed as a whole.
+  StreamHash hash;
+  std::vector<char> buf(kSampleSize);
+  if (size <= kSampleNumber * kSampleSize) {
+    uint64 rest = size;
+    size_t len = 0;
+    while (rest > 0 && (len = fread(buf.data(), 1,
+                        std::min<uint64>(rest, buf.size()), file)) > 0) {
+      hash.Update(buf.data(), len);
+      rest -= len;
+    }
+  } else {
+    uint64 step = (size - kSampleSize) / (kSampleNumber - 1);
+    for (int i = 0; i < kSampleNumber; ++i) {
+      uint64 offset = (i == kSampleNumber - 1) ?
+                      size - kSampleSize : i * step;
+#ifndef _MSC_VER
+      fseeko(file, offset, SEEK_SET);
+#else
+      _fseeki64(file, offset, SEEK_SET);
+#endif
+      size_t len = fread(buf.data(), 1, kSampleSize, file);
+      hash.Update(buf.data(), len);
+    }
+  }
+  fclose(file);
+  sample_hash = hash.Value();
+  return true;
+}
+
+// Whether the two signatures are the same.
+bool FileSignature::Match(const FileSignature& other) const {
+  return size == other.size && mtime == other.mtime &&
+         inode == other.inode && sample_hash == other.sample_hash;
+}
+
+// Write the signature to a binary file.
+void FileSignature::Write(FILE* file) const {
+  WriteDataToDisk(file, (char*)&size, sizeof(size));
+  WriteDataToDisk(file, (char*)&mtime, sizeof(mtime));
+  WriteDataToDisk(file, (char*)&inode, sizeof(inode));
+  WriteDataToDisk(file, (char*)&sample_hash, sizeof(sample_hash));
+  WriteDataToDisk(file, (char*)&content_hash, sizeof(content_hash));
+}
+
+// Read the signature from a binary file.
+bool FileSignature::Read(FILE* file) {
+  size_t len = 0;
+  len += ReadDataFromDisk(file, (char*)&size, sizeof(size));
+  len += ReadDataFromDisk(file, (char*)&mtime, sizeof(mtime));
+  len += ReadDataFromDisk(file, (char*)&inode, sizeof(inode));
+  len += ReadDataFromDisk(file, (char*)&sample_hash, sizeof(sample_hash));
+  len += ReadDataFromDisk(file, (char*)&content_hash, sizeof(content_hash));
+  return len == 5 * sizeof(uint64);
+}
@@ -0,0 +1,135 @@
+//------------------------------------------------------------------------------
+// Copyright (c) 2018 by contributors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//------------------------------------------------------------------------------
+
+/*
+This file defines the FileSignature and StreamHash classes, which are
+used to check whether a cache file is generated from the data file.
+*/
+
+#ifndef XLEARN_BASE_FILE_SIGNATURE_H_
+#define XLEARN_BASE_FILE_SIGNATURE_H_
+
+#include <stdio.h>
+
+#include <string>
+
+#include "src/base/common.h"
+
+//------------------------------------------------------------------------------
+// StreamHash is a 64-bit hash of a stream of bytes. The data can be
+// given in pieces of any size, and the result is the same as hashing
+// the whole data at once. For example:
+//
+//   StreamHash hash;
+//   hash.Update(block_1, size_1);
+//   hash.Update(block_2, size_2);
+//   uint64 value = hash.Value();
+//------------------------------------------------------------------------------
+class StreamHash {
+ public:
+  StreamHash() : hash_(kSeed), length_(0), tail_size_(0) { }
+
+  // Hash the next len bytes of the stream.
+  void Update(const char* buf, size_t len);
+
+  // Return the hash value of the data so far.
+  uint64 Value() const;
+
+ private:
+  static const uint64 kSeed = 0x27d4eb2f165667c5ULL;
+  uint64 hash_;
+  uint64 length_;
+  /* The incomplete word at the end of the data */
+  char tail_[8];
+  size_t tail_size_;
+
+  // Mix a word into hash_.
+  void update_word(uint64 word);
+};
+
+//------------------------------------------------------------------------------
+// FileSignature identifies the content of a data file without reading
+// the whole file. It consists of the size, the modification time, and
+// the inode of the file, as well as the hash of a fixed number of small
+// chunks that are evenly spaced in the file (including the first and
+// the last chunk). Hence, the cost of Load() does not depend on the
+// size of the file. Besides, the hash of the whole content (content_hash)
+// can be recorded by the user of this class, e.g., it is computed when
+// the file is parsed, and it is checked only if a full verification is
+// required. For example:
+//
+//   FileSignature sig;
+//   sig.Load("./train.txt");
+//   sig.Write(cache_file);
+//   ...
+//   FileSignature old_sig, new_sig;
+//   old_sig.Read(cache_file);
+//   new_sig.Load("./train.txt");
+//   if (old_sig.Match(new_sig)) { /* use the cache file */ }
+//
+// If the file has only grown, the signature of its first old_sig.size
+// bytes is the same as the old signature, except the modification time:
+//
+//   FileSignature head;
+//   if (head.Load("./train.txt", old_sig.size) &&
+//       head.sample_hash == old_sig.sample_hash) { /* append the tail */ }
+//------------------------------------------------------------------------------
+struct FileSignature {
+  // Number and size of the sampled chunks.
+  static const int kSampleNumber = 16;
+  static const uint64 kSampleSize = 64 * 1024;  // 64 KB
+
+  /* Size of the file in bytes */
+  uint64 size = 0;
+  /* Modification time in nanoseconds */
+  int64 mtime = 0;
+  /* Inode number (0 on Windows) */
+  uint64 inode = 0;
+  /* Hash of the sampled chunks */
+  uint64 sample_hash = 0;
+  /* Hash of the whole content, 0 for unknown */
+  uint64 content_hash = 0;
+
+  // Get the signature of a file, except the content_hash.
+  // Return false if the file cannot be opened.
+  bool Load(const std::string& filename);
+
+  // Get the signature of the first length bytes of the file, as if
+  // the file were truncated to length. Return false if the file is
+  // shorter. It is used to check whether the data of an old signature
+  // is still the head of a file that has grown, e.g., a log file.
+  bool Load(const std::string& filename, uint64 length);
+
+  // Whether the two signatures are the same, except
+  // the content_hash, which can be checked by the user.
+  bool Match(const FileSignature& other) const;
+
+  // Write the signature to a binary file.
+  void Write(FILE* file) const;
+
+  // Read the signature from a binary file.
+  // Return false if the file is truncated.
+  bool Read(FILE* file);
+
+ private:
+  // Get the size, the modification time and the inode.
+  bool load_stat(const std::string& filename);
+
+  // Hash the sampled chunks of the first size bytes.
+  bool load_samples(const std::string& filename);
+};
+
+#endif  // XLEARN_BASE_FILE_SIGNATURE_H_
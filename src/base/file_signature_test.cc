@@ -0,0 +1,144 @@
+//------------------------------------------------------------------------------
+// Copyright (c) 2018 by contributors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//------------------------------------------------------------------------------
+
+/*
+This file tests file_signature.h file.
+*/
+
+#include "gtest/gtest.h"
+
+#include <stdio.h>
+#include <string>
+
+#include "src/base/file_signature.h"
+
+const std::string kFilename = "./test_file_signature";
+
+void write_file(const std::string& filename, const std::string& str) {
+  FILE* file = fopen(filename.c_str(), "wb");
+  fwrite(str.data(), 1, str.size(), file);
+  fclose(file);
+}
+
+uint64 hash_string(const std::string& str) {
+  StreamHash hash;
+  hash.Update(str.data(), str.size());
+  return hash.Value();
+}
+
+TEST(FileSignatureTest, StreamHash) {
+  std::string str;
+  for (int i = 0; i < 1000; ++i) {
+    str += std::to_string(i) + " 1:0.5 2:0.25\n";
+  }
+  uint64 value = hash_string(str);
+  // The hash value does not depend on the pieces
+  size_t piece_list[] = {1, 3, 7, 8, 13, 4096};
+  for (size_t p = 0; p < 6; ++p) {
+    StreamHash hash;
+    for (size_t pos = 0; pos < str.size(); pos += piece_list[p]) {
+      hash.Update(str.data() + pos,
+                  std::min(piece_list[p], str.size() - pos));
+    }
+    EXPECT_EQ(hash.Value(), value);
+  }
+  // A different byte or a different length
+  std::string other = str;
+  other[str.size() / 2] ^= 1;
+  EXPECT_NE(hash_string(other), value);
+  EXPECT_NE(hash_string(str + '\0'), value);
+  EXPECT_NE(hash_string(""), hash_string(std::string(1, '\0')));
+}
+
+TEST(FileSignatureTest, Load) {
+  FileSignature sig;
+  EXPECT_FALSE(sig.Load("./not_exist_file"));
+  // Larger than the sampled chunks
+  std::string str(FileSignature::kSampleNumber * 
+                  FileSignature::kSampleSize * 3, 'a');
+  write_file(kFilename, str);
+  ASSERT_TRUE(sig.Load(kFilename));
+  EXPECT_EQ(sig.size, str.size());
+  EXPECT_EQ(sig.content_hash, 0);
+  FileSignature same;
+  ASSERT_TRUE(same.Load(kFilename));
+  EXPECT_TRUE(sig.Match(same));
+  // The first and the last chunk are sampled
+  size_t pos_list[] = {0, str.size() - 1};
+  for (int i = 0; i < 2; ++i) {
+    std::string other = str;
+    other[pos_list[i]] = 'b';
+    write_file(kFilename, other);
+    FileSignature changed;
+    ASSERT_TRUE(changed.Load(kFilename));
+    EXPECT_NE(changed.sample_hash, sig.sample_hash);
+    EXPECT_FALSE(changed.Match(sig));
+  }
+  remove(kFilename.c_str());
+}
+
+TEST(FileSignatureTest, LoadPrefix) {
+  // A small file and a file larger than the sampled chunks
+  size_t size_list[] = {1000, FileSignature::kSampleNumber *
+                              FileSignature::kSampleSize * 3};
+  for (int i = 0; i < 2; ++i) {
+    std::string str;
+    for (size_t j = 0; j < size_list[i]; ++j) { str += 'a' + j % 26; }
+    write_file(kFilename, str);
+    FileSignature sig;
+    ASSERT_TRUE(sig.Load(kFilename));
+    // Append some data to the file
+    write_file(kFilename, str + "new data\n");
+    FileSignature head;
+    ASSERT_TRUE(head.Load(kFilename, str.size()));
+    EXPECT_EQ(head.size, sig.size);
+    EXPECT_EQ(head.inode, sig.inode);
+    EXPECT_EQ(head.sample_hash, sig.sample_hash);
+    FileSignature whole;
+    ASSERT_TRUE(whole.Load(kFilename));
+    EXPECT_NE(whole.sample_hash, sig.sample_hash);
+    // Change the head of the file
+    str[0] = 'z';
+    write_file(kFilename, str + "new data\n");
+    ASSERT_TRUE(head.Load(kFilename, str.size()));
+    EXPECT_NE(head.sample_hash, sig.sample_hash);
+    // Longer than the file
+    EXPECT_FALSE(head.Load(kFilename, str.size() + 10));
+  }
+  remove(kFilename.c_str());
+}
+
+TEST(FileSignatureTest, WriteAndRead) {
+  FileSignature sig;
+  sig.size = 1;
+  sig.mtime = -2;
+  sig.inode = 3;
+  sig.sample_hash = 4;
+  sig.content_hash = 5;
+  FILE* file = fopen(kFilename.c_str(), "wb");
+  sig.Write(file);
+  fclose(file);
+  FileSignature new_sig;
+  file = fopen(kFilename.c_str(), "rb");
+  EXPECT_TRUE(new_sig.Read(file));
+  // Truncated file
+  EXPECT_FALSE(new_sig.Read(file));
+  fclose(file);
+  EXPECT_TRUE(new_sig.Match(sig));
+  EXPECT_EQ(new_sig.mtime, -2);
+  EXPECT_EQ(new_sig.content_hash, 5);
+  remove(kFilename.c_str());
+}
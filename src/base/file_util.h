@@ -219,6 +219,26 @@ inline size_t ReadDataFromDisk(FILE *file, char *buf, size_t len) {
   return ret;
 }
 
+// Read at most len bytes that are available now from a pipe.
+// Unlike fread(), it does not wait until the whole buffer is
+// filled, so the data can be used as soon as it is written.
+// If we reach the end of the file, return 0.
+inline size_t ReadDataFromPipe(FILE *file, char *buf, size_t len) {
+  CHECK_NOTNULL(file);
+  CHECK_NOTNULL(buf);
+  for (;;) {
+#ifndef _MSC_VER
+    ssize_t ret = read(fileno(file), buf, len);
+#else
+    int ret = _read(fileno(file), buf, (unsigned)len);
+#endif
+    if (ret >= 0) { return ret; }
+    if (errno != EINTR) {
+      LOG(FATAL) << "Error: invoke read().";
+    }
+  }
+}
+
 // Delete target file from disk.
 inline void RemoveFile(const char *filename) {
   CHECK_NOTNULL(filename);
@@ -0,0 +1,167 @@
+//------------------------------------------------------------------------------
+// Copyright (c) 2018 by contributors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//------------------------------------------------------------------------------
+
+/*
+This file is the implementation of huge_page.h
+*/
+
+#include "src/base/huge_page.h"
+
+#include <stdlib.h>
+#ifdef _MSC_VER
+#include <malloc.h>
+#endif
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+#include <algorithm>
+
+#include "src/base/logging.h"
+
+#ifdef __linux__
+// The page size of MAP_HUGETLB is encoded in the
+// flags, which are missing in the older headers.
+#ifndef MAP_HUGE_SHIFT
+#define MAP_HUGE_SHIFT 26
+#endif
+#endif
+
+static const uint64 kSize2M = 1ULL << 21;
+static const uint64 kSize1G = 1ULL << 30;
+
+// Parse "none", "thp", "2m", or "1g".
+bool ParsePageType(const std::string& name, PageType* type) {
+  CHECK_NOTNULL(type);
+  if (name == "none") {
+    *type = kNormalPage;
+  } else if (name == "thp") {
+    *type = kThpPage;
+  } else if (name == "2m") {
+    *type = kHugePage2M;
+  } else if (name == "1g") {
+    *type = kHugePage1G;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+// Return the name of the page type.
+std::string PageTypeName(PageType type) {
+  switch (type) {
+    case kThpPage: return "thp";
+    case kHugePage2M: return "2m";
+    case kHugePage1G: return "1g";
+    default: return "none";
+  }
+}
+
+// Round size up to a multiple of align.
+static uint64 round_up(uint64 size, uint64 align) {
+  return (size + align - 1) / align * align;
+}
+
+// Allocate an aligned buffer from the heap.
+static void* aligned_alloc_heap(uint64 size, uint64 align) {
+#ifdef _MSC_VER
+  return _aligned_malloc(size, align);
+#else
+  void* ptr = nullptr;
+  if (posix_memalign(&ptr, align, size) != 0) {
+    return nullptr;
+  }
+  return ptr;
+#endif
+}
+
+#ifdef __linux__
+// Map the hugetlb pages of (1 << shift) bytes. Since the
+// mapping is private, the pages are reserved by mmap(), and
+// it fails if there are not enough free huge pages.
+static void* map_huge_pages(uint64 size, int shift) {
+  void* ptr = mmap(NULL, round_up(size, 1ULL << shift),
+                   PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB |
+                   (shift << MAP_HUGE_SHIFT),
+                   -1, 0);
+  return ptr == MAP_FAILED ? nullptr : ptr;
+}
+#endif
+
+// Allocate a buffer on the pages of the given type,
+// or on the pages of a fallback type.
+void* AllocPages(uint64 size, PageType type, PageType* used) {
+  CHECK_NOTNULL(used);
+  size = std::max(size, (uint64)1);
+#ifdef __linux__
+  if (type == kHugePage1G) {
+    void* ptr = map_huge_pages(size, 30);
+    if (ptr != nullptr) {
+      *used = kHugePage1G;
+      return ptr;
+    }
+    LOG(INFO) << "Cannot allocate 1G huge pages, and fall back to 2M.";
+    type = kHugePage2M;
+  }
+  if (type == kHugePage2M) {
+    void* ptr = map_huge_pages(size, 21);
+    if (ptr != nullptr) {
+      *used = kHugePage2M;
+      return ptr;
+    }
+    LOG(INFO) << "Cannot allocate 2M huge pages, and fall back to thp.";
+    type = kThpPage;
+  }
+  if (type == kThpPage) {
+    uint64 len = round_up(size, kSize2M);
+    void* ptr = aligned_alloc_heap(len, kSize2M);
+    if (ptr == nullptr) { return nullptr; }
+#ifdef MADV_HUGEPAGE
+    if (madvise(ptr, len, MADV_HUGEPAGE) == 0) {
+      *used = kThpPage;
+      return ptr;
+    }
+#endif
+    // The buffer is still usable, and it is freed by free()
+    LOG(INFO) << "Transparent huge pages are not supported.";
+    *used = kNormalPage;
+    return ptr;
+  }
+#endif
+  *used = kNormalPage;
+  return aligned_alloc_heap(size, kPageAlignByte);
+}
+
+// Free the buffer that is allocated by AllocPages().
+void FreePages(void* ptr, uint64 size, PageType used) {
+  if (ptr == nullptr) { return; }
+#ifdef __linux__
+  if (used == kHugePage1G) {
+    munmap(ptr, round_up(std::max(size, (uint64)1), kSize1G));
+    return;
+  }
+  if (used == kHugePage2M) {
+    munmap(ptr, round_up(std::max(size, (uint64)1), kSize2M));
+    return;
+  }
+#endif
+#ifdef _MSC_VER
+  _aligned_free(ptr);
+#else
+  free(ptr);
+#endif
+}
@@ -0,0 +1,81 @@
+//------------------------------------------------------------------------------
+// Copyright (c) 2018 by contributors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//------------------------------------------------------------------------------
+
+/*
+This file defines the functions that allocate large buffers
+(e.g., the model parameters) on huge pages.
+*/
+
+#ifndef XLEARN_BASE_HUGE_PAGE_H_
+#define XLEARN_BASE_HUGE_PAGE_H_
+
+#include <string>
+
+#include "src/base/common.h"
+
+//------------------------------------------------------------------------------
+// The model parameters of a large ffm task take several GB, and they
+// are visited in a random order, so almost every visit misses the TLB
+// if they are on 4 KB pages. AllocPages() allocates a buffer on huge
+// pages of the given type:
+//
+//   kNormalPage  : malloc() as usual.
+//   kThpPage     : transparent huge pages (2 MB), i.e., the buffer is
+//                  aligned to 2 MB and advised by madvise(MADV_HUGEPAGE).
+//   kHugePage2M  : the 2 MB pages reserved by hugetlbfs, which are
+//   kHugePage1G  : mapped by mmap(MAP_HUGETLB). The pages must be
+//                  reserved in advance, e.g.,
+//                  echo 2048 > /proc/sys/vm/nr_hugepages
+//
+// If the pages of the given type are not available, AllocPages() falls
+// back to the next type in the order 1G -> 2M -> THP -> normal, and it
+// returns the type that is really used, which must be passed to
+// FreePages(). Huge pages are not supported on Windows and macOS, and
+// the buffers are always on normal pages there. For example:
+//
+//   PageType type;
+//   ParsePageType("2m", &type);
+//   PageType used;
+//   real_t* w = (real_t*)AllocPages(size, type, &used);
+//   ...
+//   FreePages(w, size, used);
+//
+// The buffer is aligned to at least kPageAlignByte bytes.
+//------------------------------------------------------------------------------
+enum PageType {
+  kNormalPage = 0,
+  kThpPage = 1,
+  kHugePage2M = 2,
+  kHugePage1G = 3
+};
+
+const size_t kPageAlignByte = 64;
+
+// Parse "none", "thp", "2m", or "1g". Return false if it is unknown.
+bool ParsePageType(const std::string& name, PageType* type);
+
+// Return the name of the page type, e.g., "2m".
+std::string PageTypeName(PageType type);
+
+// Allocate a buffer of size bytes on the pages of the given type, or
+// on the pages of a fallback type. The type that is really used is
+// stored in used. Return nullptr if the memory is not enough.
+void* AllocPages(uint64 size, PageType type, PageType* used);
+
+// Free the buffer that is allocated by AllocPages().
+void FreePages(void* ptr, uint64 size, PageType used);
+
+#endif  // XLEARN_BASE_HUGE_PAGE_H_
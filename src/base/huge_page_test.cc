@@ -0,0 +1,57 @@
+//------------------------------------------------------------------------------
+// Copyright (c) 2018 by contributors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//------------------------------------------------------------------------------
+
+/*
+This file tests huge_page.h file.
+*/
+
+#include "gtest/gtest.h"
+
+#include <string.h>
+
+#include "src/base/huge_page.h"
+
+TEST(HugePageTest, ParsePageType) {
+  const char* names[] = {"none", "thp", "2m", "1g"};
+  for (int i = 0; i < 4; ++i) {
+    PageType type;
+    EXPECT_TRUE(ParsePageType(names[i], &type));
+    EXPECT_EQ(type, i);
+    EXPECT_EQ(PageTypeName(type), std::string(names[i]));
+  }
+  PageType type;
+  EXPECT_FALSE(ParsePageType("4k", &type));
+  EXPECT_FALSE(ParsePageType("", &type));
+}
+
+TEST(HugePageTest, AllocPages) {
+  // The hugetlb pages are usually not reserved, and then
+  // AllocPages() falls back to the other types.
+  uint64 sizes[] = {0, 100, 3 * 1024 * 1024 + 5};
+  for (int t = kNormalPage; t <= kHugePage1G; ++t) {
+    for (int s = 0; s < 3; ++s) {
+      PageType used;
+      char* ptr = (char*)AllocPages(sizes[s], (PageType)t, &used);
+      ASSERT_TRUE(ptr != nullptr);
+      EXPECT_LE(used, t);
+      EXPECT_EQ((uint64)ptr % kPageAlignByte, 0);
+      memset(ptr, 1, sizes[s]);
+      EXPECT_TRUE(sizes[s] == 0 || ptr[sizes[s]-1] == 1);
+      FreePages(ptr, sizes[s], used);
+    }
+  }
+  FreePages(nullptr, 0, kNormalPage);
+}
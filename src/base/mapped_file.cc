@@ -0,0 +1,129 @@
+//------------------------------------------------------------------------------
+// Copyright (c) 2018 by contributors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//------------------------------------------------------------------------------
+
+/*
+This file is the implementation of the MappedFile class.
+*/
+
+#include "src/base/mapped_file.h"
+
+#ifndef _MSC_VER
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#else
+#include <io.h>
+#include <fcntl.h>
+#include "src/base/mman.h"
+#endif
+
+#include <string.h>
+#include <algorithm>
+
+#include "src/base/logging.h"
+
+// Map the whole file. Return false if failed.
+bool MappedFile::Open(const std::string& filename) {
+  Close();
+#ifndef _MSC_VER
+  int fd = open(filename.c_str(), O_RDONLY);
+  if (fd < 0) { return false; }
+  struct stat st;
+  if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size == 0) {
+    close(fd);
+    return false;
+  }
+#else
+  int fd = _open(filename.c_str(), _O_RDONLY | _O_BINARY);
+  if (fd < 0) { return false; }
+  struct _stat64 st;
+  if (_fstat64(fd, &st) != 0 || st.st_size == 0) {
+    _close(fd);
+    return false;
+  }
+#endif
+  uint64 size = st.st_size;
+  void* ptr = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  // The mapping is still valid after closing the file.
+#ifndef _MSC_VER
+  close(fd);
+#else
+  _close(fd);
+#endif
+  if (ptr == MAP_FAILED) {
+    LOG(INFO) << "Cannot mmap file " << filename
+              << ", and fall back to fread().";
+    return false;
+  }
+  data_ = static_cast<char*>(ptr);
+  size_ = size;
+  return true;
+}
+
+// Unmap the file.
+void MappedFile::Close() {
+  if (data_ != nullptr) {
+    munmap(data_, size_);
+    data_ = nullptr;
+    size_ = 0;
+  }
+}
+
+// Return the end of the block that starts at pos.
+uint64 MappedFile::NextBlock(uint64 pos, uint64 max_size) const {
+  CHECK_LE(pos, size_);
+  if (size_ - pos <= max_size) { return size_; }
+  const char* begin = data_ + pos;
+  const char* ptr = begin + max_size;
+  while (ptr > begin && ptr[-1] != '\n') { --ptr; }
+  if (ptr == begin) {
+    LOG(FATAL) << "Cannot find a line break in the block. "
+               << "Please use a larger block size.";
+  }
+  return ptr - data_;
+}
+
+#ifndef _MSC_VER
+// Call madvise() on the pages that cover [pos, pos + len).
+void MappedFile::advise(uint64 pos, uint64 len, int advice) {
+  if (data_ == nullptr || pos >= size_ || len == 0) { return; }
+  static const uint64 page_size = sysconf(_SC_PAGESIZE);
+  len = std::min(len, size_ - pos);
+  uint64 begin = pos / page_size * page_size;
+  madvise(data_ + begin, pos + len - begin, advice);
+}
+
+void MappedFile::AdviseSequential() {
+  advise(0, size_, MADV_SEQUENTIAL);
+}
+
+void MappedFile::WillNeed(uint64 pos, uint64 len) {
+  advise(pos, len, MADV_WILLNEED);
+}
+
+// The mapping is read-only and private, so MADV_DONTNEED only
+// drops the pages from our address space. The data is still in
+// the page cache, and it will be loaded again if we read it.
+void MappedFile::DontNeed(uint64 pos, uint64 len) {
+  advise(pos, len, MADV_DONTNEED);
+}
+#else
+void MappedFile::advise(uint64 pos, uint64 len, int advice) { }
+void MappedFile::AdviseSequential() { }
+void MappedFile::WillNeed(uint64 pos, uint64 len) { }
+void MappedFile::DontNeed(uint64 pos, uint64 len) { }
+#endif
@@ -0,0 +1,94 @@
+//------------------------------------------------------------------------------
+// Copyright (c) 2018 by contributors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//------------------------------------------------------------------------------
+
+/*
+This file defines the MappedFile class.
+*/
+
+#ifndef XLEARN_BASE_MAPPED_FILE_H_
+#define XLEARN_BASE_MAPPED_FILE_H_
+
+#include <string>
+
+#include "src/base/common.h"
+
+//------------------------------------------------------------------------------
+// MappedFile maps a whole file into memory (read-only) by using mmap(),
+// so that the reader can parse the file without copying it to a block
+// buffer. The pages are loaded by the OS on demand, and they are shared
+// by all the processes that read the same file. We can read a text file
+// block by block like this:
+//
+//   MappedFile file;
+//   if (file.Open(filename)) {
+//     file.AdviseSequential();
+//     uint64 pos = 0;
+//     while (pos < file.Size()) {
+//       uint64 end = file.NextBlock(pos, block_size);
+//       file.WillNeed(end, block_size);  /* readahead */
+//       ... /* parse [file.Data() + pos, file.Data() + end) */
+//       file.DontNeed(pos, end - pos);   /* release the pages */
+//       pos = end;
+//     }
+//   }
+//
+// Open() returns false if the file cannot be mapped (e.g., it is empty,
+// or it is a pipe), and the caller should read the file by fread().
+// The madvise() hints are ignored on Windows.
+//------------------------------------------------------------------------------
+class MappedFile {
+ public:
+  MappedFile() : data_(nullptr), size_(0) { }
+  ~MappedFile() { Close(); }
+
+  // Map the whole file. Return false if failed.
+  bool Open(const std::string& filename);
+
+  // Unmap the file.
+  void Close();
+
+  // Whether a file is mapped.
+  inline bool IsOpen() const { return data_ != nullptr; }
+
+  // Start address and size of the mapped file.
+  inline const char* Data() const { return data_; }
+  inline uint64 Size() const { return size_; }
+
+  // Return the end of the block that starts at pos. The block
+  // ends with the last '\n' in [pos, pos + max_size), or ends
+  // at the end of file if the remaining size <= max_size.
+  uint64 NextBlock(uint64 pos, uint64 max_size) const;
+
+  // We will read the file sequentially.
+  void AdviseSequential();
+
+  // We will read [pos, pos + len) soon.
+  void WillNeed(uint64 pos, uint64 len);
+
+  // We will not read [pos, pos + len) again.
+  void DontNeed(uint64 pos, uint64 len);
+
+ private:
+  char* data_;
+  uint64 size_;
+
+  // Call madvise() on the pages that cover [pos, pos + len).
+  void advise(uint64 pos, uint64 len, int advice);
+
+  DISALLOW_COPY_AND_ASSIGN(MappedFile);
+};
+
+#endif  // XLEARN_BASE_MAPPED_FILE_H_
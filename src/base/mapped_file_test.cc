@@ -0,0 +1,80 @@
+//------------------------------------------------------------------------------
+// Copyright (c) 2018 by contributors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//------------------------------------------------------------------------------
+
+/*
+This file tests mapped_file.h file.
+*/
+
+#include "gtest/gtest.h"
+
+#include <stdio.h>
+#include <string>
+
+#include "src/base/mapped_file.h"
+
+const std::string kFilename = "./test_mapped_file.txt";
+const std::string kEmptyFile = "./test_mapped_file_empty.txt";
+
+void write_file(const std::string& filename, const std::string& str) {
+  FILE* file = fopen(filename.c_str(), "wb");
+  fwrite(str.data(), 1, str.size(), file);
+  fclose(file);
+}
+
+TEST(MappedFileTest, Open) {
+  std::string str = "1 2 3\n4 5\n6\n";
+  write_file(kFilename, str);
+  write_file(kEmptyFile, "");
+  MappedFile file;
+  EXPECT_FALSE(file.Open(kEmptyFile));
+  EXPECT_FALSE(file.IsOpen());
+  EXPECT_FALSE(file.Open("./not_exist_file.txt"));
+  ASSERT_TRUE(file.Open(kFilename));
+  EXPECT_TRUE(file.IsOpen());
+  EXPECT_EQ(file.Size(), str.size());
+  EXPECT_EQ(std::string(file.Data(), file.Size()), str);
+  file.AdviseSequential();
+  file.Close();
+  EXPECT_FALSE(file.IsOpen());
+  remove(kEmptyFile.c_str());
+}
+
+TEST(MappedFileTest, NextBlock) {
+  // The last line has no '\n'
+  std::string str = "1 2 3\n4 5\n6\n7 8";
+  write_file(kFilename, str);
+  MappedFile file;
+  ASSERT_TRUE(file.Open(kFilename));
+  EXPECT_EQ(file.NextBlock(0, 100), str.size());
+  EXPECT_EQ(file.NextBlock(0, 6), 6);
+  EXPECT_EQ(file.NextBlock(0, 9), 6);
+  EXPECT_EQ(file.NextBlock(0, 10), 10);
+  EXPECT_EQ(file.NextBlock(6, 6), 12);
+  EXPECT_EQ(file.NextBlock(12, 3), str.size());
+  // Read all the blocks
+  std::string result;
+  uint64 pos = 0;
+  while (pos < file.Size()) {
+    uint64 end = file.NextBlock(pos, 7);
+    EXPECT_GT(end, pos);
+    file.WillNeed(end, 7);
+    result.append(file.Data() + pos, end - pos);
+    file.DontNeed(pos, end - pos);
+    pos = end;
+  }
+  EXPECT_EQ(result, str);
+  remove(kFilename.c_str());
+}
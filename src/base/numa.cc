@@ -0,0 +1,181 @@
+//------------------------------------------------------------------------------
+// Copyright (c) 2018 by contributors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//------------------------------------------------------------------------------
+
+/*
+This file is the implementation of the NumaTopology class.
+*/
+
+#include "src/base/numa.h"
+
+#ifdef __linux__
+#include <dirent.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#endif
+
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <fstream>
+#include <thread>
+
+#include "src/base/logging.h"
+#include "src/base/split_string.h"
+#include "src/base/stringprintf.h"
+
+#ifdef __linux__
+// The policy of mbind() in <numaif.h>, which is a part
+// of libnuma, so we call the system call directly.
+#ifndef MPOL_INTERLEAVE
+#define MPOL_INTERLEAVE 3
+#endif
+#endif
+
+// Parse a cpulist, e.g., "0-7,16-23".
+static std::vector<int> parse_cpulist(const std::string& str) {
+  std::vector<int> cpus;
+  std::vector<std::string> ranges;
+  SplitStringUsing(str, ",\n", &ranges);
+  for (size_t i = 0; i < ranges.size(); ++i) {
+    std::vector<std::string> bounds;
+    SplitStringUsing(ranges[i], "-", &bounds);
+    if (bounds.empty()) { continue; }
+    int begin = atoi(bounds[0].c_str());
+    int end = bounds.size() > 1 ? atoi(bounds[1].c_str()) : begin;
+    for (int cpu = begin; cpu <= end; ++cpu) {
+      cpus.push_back(cpu);
+    }
+  }
+  return cpus;
+}
+
+// Use one node with all the CPUs.
+void NumaTopology::detect_single_node() {
+  node_id_.assign(1, 0);
+  int num_cpu = std::max(1, (int)std::thread::hardware_concurrency());
+  cpus_.assign(1, std::vector<int>());
+  for (int i = 0; i < num_cpu; ++i) {
+    cpus_[0].push_back(i);
+  }
+  cpulist_.assign(1, num_cpu == 1 ? std::string("0") :
+                     StringPrintf("0-%d", num_cpu - 1));
+}
+
+// Detect the nodes from the node directory of sysfs. Each
+// node has a directory "node<id>" with a file "cpulist".
+void NumaTopology::Detect(const std::string& node_dir) {
+  node_id_.clear();
+  cpus_.clear();
+  cpulist_.clear();
+#ifdef __linux__
+  std::vector<int> ids;
+  DIR* dir = opendir(node_dir.c_str());
+  if (dir != nullptr) {
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != nullptr) {
+      const char* name = entry->d_name;
+      if (strncmp(name, "node", 4) == 0 && isdigit(name[4])) {
+        ids.push_back(atoi(name + 4));
+      }
+    }
+    closedir(dir);
+  }
+  std::sort(ids.begin(), ids.end());
+  for (size_t i = 0; i < ids.size(); ++i) {
+    std::string filename = StringPrintf("%s/node%d/cpulist",
+                                        node_dir.c_str(), ids[i]);
+    std::ifstream file(filename.c_str());
+    std::string line;
+    if (!std::getline(file, line)) { continue; }
+    std::vector<int> cpus = parse_cpulist(line);
+    // The node without CPU (e.g., a memory-only node) is skipped
+    if (cpus.empty()) { continue; }
+    node_id_.push_back(ids[i]);
+    cpus_.push_back(cpus);
+    cpulist_.push_back(line);
+  }
+#endif
+  if (node_id_.empty()) {
+    detect_single_node();
+  }
+}
+
+// Return the node (index) of the id-th of total workers.
+int NumaTopology::NodeOfWorker(size_t id, size_t total) const {
+  CHECK_LT(id, total);
+  return id * NumNodes() / total;
+}
+
+// Pin the calling thread to the CPUs of the i-th node.
+bool NumaTopology::PinThread(int i) const {
+  CHECK_GE(i, 0);
+  CHECK_LT(i, NumNodes());
+#ifdef __linux__
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for (size_t j = 0; j < cpus_[i].size(); ++j) {
+    if (cpus_[i][j] < CPU_SETSIZE) {
+      CPU_SET(cpus_[i][j], &set);
+    }
+  }
+  // The pid 0 is the calling thread
+  return sched_setaffinity(0, sizeof(set), &set) == 0;
+#else
+  return false;
+#endif
+}
+
+// Interleave the pages of [ptr, ptr + size) across all the nodes.
+bool NumaTopology::Interleave(void* ptr, uint64 size) const {
+  if (NumNodes() <= 1 || ptr == nullptr || size == 0) { return false; }
+#ifdef __linux__
+  // mbind() needs the address to be aligned to the page size
+  static const uint64 page_size = sysconf(_SC_PAGESIZE);
+  uint64 addr = (uint64)ptr;
+  uint64 begin = addr / page_size * page_size;
+  uint64 len = addr + size - begin;
+  // The kernel reads maxnode - 1 bits of the mask,
+  // so we leave an unused word at the end.
+  int max_id = *std::max_element(node_id_.begin(), node_id_.end());
+  const int kBits = sizeof(unsigned long) * 8;
+  std::vector<unsigned long> mask(max_id / kBits + 2, 0);
+  for (size_t i = 0; i < node_id_.size(); ++i) {
+    mask[node_id_[i] / kBits] |= 1UL << (node_id_[i] % kBits);
+  }
+  long ret = syscall(SYS_mbind, (void*)begin, len, MPOL_INTERLEAVE,
+                     mask.data(), mask.size() * kBits, 0);
+  if (ret != 0) {
+    LOG(INFO) << "Cannot interleave the memory across the NUMA nodes.";
+    return false;
+  }
+  return true;
+#else
+  return false;
+#endif
+}
+
+// Return a summary, e.g., "2 nodes (0: 0-7, 1: 8-15)".
+std::string NumaTopology::Report() const {
+  std::string str = StringPrintf("%d node%s (", NumNodes(),
+                                 NumNodes() > 1 ? "s" : "");
+  for (int i = 0; i < NumNodes(); ++i) {
+    if (i > 0) { str += ", "; }
+    str += StringPrintf("%d: %s", node_id_[i], cpulist_[i].c_str());
+  }
+  return str + ")";
+}
@@ -0,0 +1,103 @@
+//------------------------------------------------------------------------------
+// Copyright (c) 2018 by contributors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//------------------------------------------------------------------------------
+
+/*
+This file defines the NumaTopology class, which detects the
+NUMA nodes of the machine and places threads and memory on them.
+*/
+
+#ifndef XLEARN_BASE_NUMA_H_
+#define XLEARN_BASE_NUMA_H_
+
+#include <string>
+#include <vector>
+
+#include "src/base/common.h"
+
+//------------------------------------------------------------------------------
+// On a machine with several sockets, each socket (NUMA node) has its
+// own memory, and accessing the memory of another node is slower. The
+// pages are placed on the node of the thread that touches them first,
+// so the model that is initialized by one thread is on one node, and
+// the workers on the other nodes pay the remote latency on every
+// access. NumaTopology detects the nodes and their CPUs from sysfs, so
+// that we can interleave the pages of the model across the nodes and
+// pin the workers to the nodes. For example:
+//
+//   NumaTopology numa;
+//   numa.Detect();
+//   printf("%s\n", numa.Report().c_str());  /* 2 nodes (0: 0-7, 1: 8-15) */
+//
+//   /* Call it before the pages are touched */
+//   numa.Interleave(model_buffer, size);
+//
+//   /* Divide 8 workers into 2 groups, one for each node */
+//   ThreadPool pool(8, [&numa](size_t id) {
+//     numa.PinThread(numa.NodeOfWorker(id, 8));
+//   });
+//
+// If the nodes cannot be detected (e.g., not on Linux), the machine
+// has one node with all the CPUs, and Interleave() and PinThread()
+// do nothing.
+//------------------------------------------------------------------------------
+class NumaTopology {
+ public:
+  // Constructor and Destructor
+  NumaTopology() { }
+  ~NumaTopology() { }
+
+  // Detect the nodes from the node directory of sysfs.
+  void Detect(const std::string& node_dir = "/sys/devices/system/node");
+
+  // Number of nodes.
+  inline int NumNodes() const { return node_id_.size(); }
+
+  // The id and the CPUs of the i-th node.
+  inline int NodeId(int i) const { return node_id_[i]; }
+  inline const std::vector<int>& Cpus(int i) const { return cpus_[i]; }
+
+  // The workers are divided into contiguous groups, one for each
+  // node. Return the node (index) of the id-th of total workers.
+  int NodeOfWorker(size_t id, size_t total) const;
+
+  // Pin the calling thread to the CPUs of the i-th node.
+  // Return false if it is not supported or failed.
+  bool PinThread(int i) const;
+
+  // Interleave the pages of [ptr, ptr + size) across all the nodes.
+  // It must be called before the pages are touched. Return false if
+  // there is only one node, or it is not supported.
+  bool Interleave(void* ptr, uint64 size) const;
+
+  // Return a summary, e.g., "2 nodes (0: 0-7, 1: 8-15)".
+  std::string Report() const;
+
+ protected:
+  /* Id of each node, which may be not contiguous */
+  std::vector<int> node_id_;
+  /* CPUs of each node */
+  std::vector<std::vector<int> > cpus_;
+  /* CPUs of each node in the format of cpulist, e.g., "0-7,16-23" */
+  std::vector<std::string> cpulist_;
+
+  // Use one node with all the CPUs.
+  void detect_single_node();
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(NumaTopology);
+};
+
+#endif  // XLEARN_BASE_NUMA_H_
@@ -0,0 +1,83 @@
+//------------------------------------------------------------------------------
+// Copyright (c) 2018 by contributors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//------------------------------------------------------------------------------
+
+/*
+This file tests numa.h file.
+*/
+
+#include "gtest/gtest.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+#include "src/base/numa.h"
+
+void write_cpulist(const std::string& dir, const std::string& cpulist) {
+  std::string cmd = "mkdir -p " + dir;
+  EXPECT_EQ(system(cmd.c_str()), 0);
+  FILE* file = fopen((dir + "/cpulist").c_str(), "w");
+  fprintf(file, "%s\n", cpulist.c_str());
+  fclose(file);
+}
+
+#ifdef __linux__
+TEST(NumaTest, Detect) {
+  // A fake node directory of sysfs
+  const std::string kNodeDir = "./test_numa_node";
+  write_cpulist(kNodeDir + "/node0", "0-3");
+  write_cpulist(kNodeDir + "/node2", "4-5,8");
+  write_cpulist(kNodeDir + "/node3", "");  // memory-only node
+  write_cpulist(kNodeDir + "/power", "0-9");
+  NumaTopology numa;
+  numa.Detect(kNodeDir);
+  ASSERT_EQ(numa.NumNodes(), 2);
+  EXPECT_EQ(numa.NodeId(0), 0);
+  EXPECT_EQ(numa.NodeId(1), 2);
+  EXPECT_EQ(numa.Cpus(0), std::vector<int>({0, 1, 2, 3}));
+  EXPECT_EQ(numa.Cpus(1), std::vector<int>({4, 5, 8}));
+  EXPECT_EQ(numa.Report(), "2 nodes (0: 0-3, 2: 4-5,8)");
+  // 5 workers in 2 groups
+  EXPECT_EQ(numa.NodeOfWorker(0, 5), 0);
+  EXPECT_EQ(numa.NodeOfWorker(2, 5), 0);
+  EXPECT_EQ(numa.NodeOfWorker(3, 5), 1);
+  EXPECT_EQ(numa.NodeOfWorker(4, 5), 1);
+  std::string cmd = "rm -rf " + kNodeDir;
+  EXPECT_EQ(system(cmd.c_str()), 0);
+}
+#endif
+
+TEST(NumaTest, SingleNode) {
+  NumaTopology numa;
+  numa.Detect("./test_numa_not_exist");
+  ASSERT_EQ(numa.NumNodes(), 1);
+  EXPECT_FALSE(numa.Cpus(0).empty());
+  EXPECT_EQ(numa.NodeOfWorker(3, 4), 0);
+  // Nothing to interleave on one node
+  std::vector<char> buf(1024);
+  EXPECT_FALSE(numa.Interleave(buf.data(), buf.size()));
+}
+
+TEST(NumaTest, System) {
+  NumaTopology numa;
+  numa.Detect();
+  ASSERT_GE(numa.NumNodes(), 1);
+  printf("%s\n", numa.Report().c_str());
+#ifdef __linux__
+  EXPECT_TRUE(numa.PinThread(0));
+#endif
+}
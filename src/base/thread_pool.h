@@ -46,13 +46,18 @@ thread pool that used by xLearn.
 //   auto result = pool.enqueue([](int answer) { return answer; }, 42);
 //   /* Get result from future*/
 //   std::cout << result.get() << std::endl;
+//
+// Each worker can run an init function with its id (0 ~ N-1) before
+// it pulls any job, e.g., to pin itself to some CPUs (see numa.h):
+//
+//   ThreadPool pool(4, [](size_t id) { /* pin worker id */ });
 //  
 // This class requires a number of c++11 features be present in your compiler.
 //------------------------------------------------------------------------------
 class ThreadPool {
  public:
   // Constructor and Destructor
-  ThreadPool(size_t);
+  ThreadPool(size_t, const std::function<void(size_t)>& init = nullptr);
   ~ThreadPool();
 
   // Add task to current queue
@@ -81,12 +86,16 @@ private:
 };
 
 // The constructor just launches some amount of workers
-inline ThreadPool::ThreadPool(size_t threads)
+inline ThreadPool::ThreadPool(size_t threads,
+                              const std::function<void(size_t)>& init)
     : stop(false) {
   for(size_t i = 0; i<threads; ++i)
     workers.emplace_back(
-      [this]
+      [this, i, init]
       {
+        if (init) {
+          init(i);
+        }
         for(;;) {
           std::function<void()> task;
           {
@@ -71,3 +71,15 @@ TEST(ThreadPoolTest, Sum_test) {
   int sum = a1 + a2 + a3 + a4 + a5;
   EXPECT_EQ(sum, 75);
 }
+
+TEST(ThreadPoolTest, Init_test) {
+  std::vector<int> count(4, 0);
+  {
+    ThreadPool pool(4, [&count](size_t id) { count[id]++; });
+    pool.enqueue(std::bind(Sum, &a1));
+    pool.Sync(1);
+  }
+  for (size_t i = 0; i < count.size(); ++i) {
+    EXPECT_EQ(count[i], 1);
+  }
+}
@@ -355,6 +355,12 @@ XL_DLL int XLearnSetStr(XL *out, const char *key, const char *value) {
     xl->GetHyperParam().loss_func = std::string(value);
   } else if (strcmp(key, "opt") == 0) {
     xl->GetHyperParam().opt_type = std::string(value);
+  } else if (strcmp(key, "format") == 0) {
+    xl->GetHyperParam().data_format = std::string(value);
+  } else if (strcmp(key, "field_map") == 0) {
+    xl->GetHyperParam().field_map_file = std::string(value);
+  } else if (strcmp(key, "huge_page") == 0) {
+    xl->GetHyperParam().huge_page = std::string(value);
   }
   API_END();
 }
@@ -373,6 +379,12 @@ XL_DLL int XLearnGetStr(XL *out, const char *key, std::string& value) {
     value = xl->GetHyperParam().loss_func;
   } else if (strcmp(key, "opt") == 0) {
     value = xl->GetHyperParam().opt_type;
+  } else if (strcmp(key, "format") == 0) {
+    value = xl->GetHyperParam().data_format;
+  } else if (strcmp(key, "field_map") == 0) {
+    value = xl->GetHyperParam().field_map_file;
+  } else if (strcmp(key, "huge_page") == 0) {
+    value = xl->GetHyperParam().huge_page;
   }
   API_END();
 }
@@ -395,6 +407,16 @@ XL_DLL int XLearnSetInt(XL *out, const char *key, const int value) {
     xl->GetHyperParam().stop_window = value;
   } else if (strcmp(key, "seed") == 0) {
     xl->GetHyperParam().seed = value;
+  } else if (strcmp(key, "shuffle_chunk") == 0) {
+    xl->GetHyperParam().shuffle_chunk = value;
+  } else if (strcmp(key, "prefetch") == 0) {
+    xl->GetHyperParam().prefetch = value;
+  } else if (strcmp(key, "mem_budget") == 0) {
+    xl->GetHyperParam().mem_budget = value;
+  } else if (strcmp(key, "shuffle_window") == 0) {
+    xl->GetHyperParam().shuffle_window = value;
+  } else if (strcmp(key, "reader_threads") == 0) {
+    xl->GetHyperParam().reader_threads = value;
   }
   API_END();
 }
@@ -415,6 +437,16 @@ XL_DLL int XLearnGetInt(XL *out, const char *key, int *value) {
     *value = xl->GetHyperParam().thread_number;
   } else if (strcmp(key, "stop_window") == 0) {
     *value = xl->GetHyperParam().stop_window;
+  } else if (strcmp(key, "shuffle_chunk") == 0) {
+    *value = xl->GetHyperParam().shuffle_chunk;
+  } else if (strcmp(key, "prefetch") == 0) {
+    *value = xl->GetHyperParam().prefetch;
+  } else if (strcmp(key, "mem_budget") == 0) {
+    *value = xl->GetHyperParam().mem_budget;
+  } else if (strcmp(key, "shuffle_window") == 0) {
+    *value = xl->GetHyperParam().shuffle_window;
+  } else if (strcmp(key, "reader_threads") == 0) {
+    *value = xl->GetHyperParam().reader_threads;
   }
   API_END();
 }
@@ -483,6 +515,22 @@ XL_DLL int XLearnSetBool(XL *out, const char *key, const bool value) {
     xl->GetHyperParam().sigmoid = value;
   } else if (strcmp(key, "bin_out") == 0) {
     xl->GetHyperParam().bin_out = value;
+  } else if (strcmp(key, "verify_bin") == 0) {
+    xl->GetHyperParam().verify_bin = value;
+  } else if (strcmp(key, "bin_compress") == 0) {
+    xl->GetHyperParam().bin_compress = value;
+  } else if (strcmp(key, "compress") == 0) {
+    xl->GetHyperParam().compress = value;
+  } else if (strcmp(key, "quantize") == 0) {
+    xl->GetHyperParam().quantize = value;
+  } else if (strcmp(key, "remap") == 0) {
+    xl->GetHyperParam().remap_feature = value;
+  } else if (strcmp(key, "numa") == 0) {
+    xl->GetHyperParam().numa = value;
+  } else if (strcmp(key, "disk_shuffle") == 0) {
+    xl->GetHyperParam().disk_shuffle = value;
+  } else if (strcmp(key, "shuffle_files") == 0) {
+    xl->GetHyperParam().shuffle_files = value;
   } else if (strcmp(key, "from_file") == 0) {
     xl->GetHyperParam().from_file = value;
   }
@@ -507,6 +555,22 @@ XL_DLL int XLearnGetBool(XL *out, const char *key, bool *value) {
     *value = xl->GetHyperParam().sign = value;
   } else if (strcmp(key, "sigmoid") == 0) {
     *value = xl->GetHyperParam().sigmoid;
+  } else if (strcmp(key, "compress") == 0) {
+    *value = xl->GetHyperParam().compress;
+  } else if (strcmp(key, "quantize") == 0) {
+    *value = xl->GetHyperParam().quantize;
+  } else if (strcmp(key, "remap") == 0) {
+    *value = xl->GetHyperParam().remap_feature;
+  } else if (strcmp(key, "numa") == 0) {
+    *value = xl->GetHyperParam().numa;
+  } else if (strcmp(key, "disk_shuffle") == 0) {
+    *value = xl->GetHyperParam().disk_shuffle;
+  } else if (strcmp(key, "shuffle_files") == 0) {
+    *value = xl->GetHyperParam().shuffle_files;
+  } else if (strcmp(key, "verify_bin") == 0) {
+    *value = xl->GetHyperParam().verify_bin;
+  } else if (strcmp(key, "bin_compress") == 0) {
+    *value = xl->GetHyperParam().bin_compress;
   }
   API_END();
 }
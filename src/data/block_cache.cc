@@ -0,0 +1,304 @@
+//------------------------------------------------------------------------------
+// Copyright (c) 2018 by contributors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//------------------------------------------------------------------------------
+
+/*
+This file is the implementation of block_cache.h
+*/
+
+#include "src/data/block_cache.h"
+
+#include <string.h>
+#ifndef _MSC_VER
+#include <unistd.h>
+#else
+#include "src/base/unistd.h"
+#endif
+
+#include <algorithm>
+
+#include "src/base/file_util.h"
+#include "src/base/stringprintf.h"
+
+namespace xLearn {
+
+// The nodes are copied from the chunk, so their size must not change.
+static_assert(sizeof(Node) == 12, "Node must be 12 bytes");
+
+// Size of the magic number, the version and the signature.
+static const uint64 kPrefixSize = sizeof(uint64) + sizeof(uint32) +
+                                  5 * sizeof(uint64);
+
+// Header of each chunk.
+struct ChunkHead {
+  uint32 row_length;
+  uint32 has_label;
+  uint64 nnz;
+};
+
+// Statistics at the end of the cache file.
+struct Footer {
+  uint64 nnz;
+  uint32 max_feat;
+  uint32 max_field;
+  uint32 has_label;
+  uint32 block_size;
+  uint64 chunk_number;
+  uint64 magic;
+};
+
+// Move the file position to offset, which can be larger than 2 GB.
+static void seek_file(FILE* file, uint64 offset) {
+#ifndef _MSC_VER
+  int ret = fseeko(file, offset, SEEK_SET);
+#else
+  int ret = _fseeki64(file, offset, SEEK_SET);
+#endif
+  if (ret != 0) {
+    LOG(FATAL) << "Error: invoke fseek().";
+  }
+}
+
+// Write len bytes to file, and move the file position cur.
+static void write_data(FILE* file, uint64* cur,
+                       const char* buf, uint64 len) {
+  if (len == 0) { return; }
+  WriteDataToDisk(file, buf, len);
+  *cur += len;
+}
+
+// Write the magic number, the version and the signature.
+static void write_prefix(FILE* file, const FileSignature& signature) {
+  uint64 magic = kCacheMagic;
+  uint32 version = kCacheVersion;
+  WriteDataToDisk(file, (char*)&magic, sizeof(magic));
+  WriteDataToDisk(file, (char*)&version, sizeof(version));
+  signature.Write(file);
+}
+
+// Create a temporary file to write the chunks. The signature
+// is written again by Finish().
+void BlockCache::Create(const std::string& filename) {
+  Close();
+  filename_ = filename;
+  tmp_file_ = StringPrintf("%s.%u.cache", filename.c_str(),
+                           (uint32)getpid());
+  file_ = OpenFileOrDie(tmp_file_.c_str(), "wb");
+  writing_ = true;
+  write_prefix(file_, FileSignature());
+  pos_ = kPrefixSize;
+  offset_.assign(1, pos_);
+}
+
+// Write the matrix as a new chunk.
+void BlockCache::Append(const DMatrix& matrix) {
+  CHECK(writing_);
+  if (matrix.row_length == 0) { return; }
+  ChunkHead head;
+  head.row_length = matrix.row_length;
+  head.has_label = matrix.has_label;
+  head.nnz = 0;
+  std::vector<uint32> size(matrix.row_length, 0);
+  for (index_t i = 0; i < matrix.row_length; ++i) {
+    const SparseRow* row = matrix.row[i];
+    if (row == nullptr) { continue; }
+    size[i] = row->size();
+    head.nnz += row->size();
+    for (SparseRow::const_iterator iter = row->begin();
+         iter != row->end(); ++iter) {
+      max_feat = std::max(max_feat, iter->feat_id);
+      max_field = std::max(max_field, iter->field_id);
+    }
+  }
+  has_label = matrix.has_label;
+  nnz += head.nnz;
+  write_data(file_, &pos_, (char*)&head, sizeof(head));
+  write_data(file_, &pos_, (char*)matrix.Y.data(),
+             matrix.row_length * sizeof(real_t));
+  write_data(file_, &pos_, (char*)matrix.norm.data(),
+             matrix.row_length * sizeof(real_t));
+  write_data(file_, &pos_, (char*)size.data(),
+             size.size() * sizeof(uint32));
+  for (index_t i = 0; i < matrix.row_length; ++i) {
+    const SparseRow* row = matrix.row[i];
+    if (row == nullptr) { continue; }
+    write_data(file_, &pos_, (char*)row->data(),
+               row->size() * sizeof(Node));
+  }
+  offset_.push_back(pos_);
+}
+
+// Write the index and the signature of the text file,
+// and rename the temporary file to the cache file.
+void BlockCache::Finish(const FileSignature& signature) {
+  CHECK(writing_);
+  Footer footer;
+  memset(&footer, 0, sizeof(footer));
+  footer.nnz = nnz;
+  footer.max_feat = max_feat;
+  footer.max_field = max_field;
+  footer.has_label = has_label;
+  footer.block_size = block_size;
+  footer.chunk_number = offset_.size() - 1;
+  footer.magic = kCacheMagic;
+  write_data(file_, &pos_, (char*)offset_.data(),
+             offset_.size() * sizeof(uint64));
+  write_data(file_, &pos_, (char*)&footer, sizeof(footer));
+  seek_file(file_, 0);
+  write_prefix(file_, signature);
+  ::Close(file_);
+  file_ = nullptr;
+  writing_ = false;
+#ifdef _MSC_VER
+  remove(filename_.c_str());
+#endif
+  if (rename(tmp_file_.c_str(), filename_.c_str()) != 0) {
+    remove(tmp_file_.c_str());
+    LOG(FATAL) << "Cannot write the cache file: " << filename_;
+  }
+  Close();
+}
+
+// Open the cache file and read its index.
+bool BlockCache::Open(const std::string& filename) {
+  Close();
+  file_ = fopen(filename.c_str(), "rb");
+  if (file_ == nullptr) { return false; }
+  filename_ = filename;
+  file_size_ = GetFileSize(file_);
+  // Check the magic number, the version and the footer
+  uint64 magic = 0;
+  uint32 version = 0;
+  Footer footer;
+  bool is_valid = file_size_ >= kPrefixSize + sizeof(uint64) +
+                               sizeof(footer) &&
+    ReadDataFromDisk(file_, (char*)&magic, sizeof(magic)) == sizeof(magic) &&
+    magic == kCacheMagic &&
+    ReadDataFromDisk(file_, (char*)&version, sizeof(version)) ==
+      sizeof(version) &&
+    version == kCacheVersion &&
+    signature_.Read(file_);
+  if (is_valid) {
+    seek_file(file_, file_size_ - sizeof(footer));
+    is_valid = ReadDataFromDisk(file_, (char*)&footer, sizeof(footer)) ==
+                 sizeof(footer) &&
+               footer.magic == kCacheMagic &&
+               (footer.chunk_number + 1) * sizeof(uint64) <=
+                 file_size_ - kPrefixSize - sizeof(footer);
+  }
+  if (is_valid) {
+    // Read the index of chunks
+    uint64 index_size = (footer.chunk_number + 1) * sizeof(uint64);
+    offset_.resize(footer.chunk_number + 1);
+    seek_file(file_, file_size_ - sizeof(footer) - index_size);
+    is_valid = ReadDataFromDisk(file_, (char*)offset_.data(), index_size)
+                 == index_size &&
+               offset_.front() == kPrefixSize &&
+               offset_.back() == file_size_ - sizeof(footer) - index_size;
+    for (size_t i = 1; is_valid && i < offset_.size(); ++i) {
+      is_valid = offset_[i-1] + sizeof(ChunkHead) <= offset_[i];
+    }
+  }
+  if (!is_valid) {
+    Close();
+    return false;
+  }
+  mem_chunk_.resize(ChunkNumber());
+  has_label = footer.has_label != 0;
+  block_size = footer.block_size;
+  nnz = footer.nnz;
+  max_feat = footer.max_feat;
+  max_field = footer.max_field;
+  return true;
+}
+
+// Close the file.
+void BlockCache::Close() {
+  if (file_ != nullptr) {
+    ::Close(file_);
+    file_ = nullptr;
+    if (writing_) { remove(tmp_file_.c_str()); }
+  }
+  writing_ = false;
+  pos_ = 0;
+  file_size_ = 0;
+  offset_.clear();
+  signature_ = FileSignature();
+  std::vector<char>().swap(buf_);
+  std::vector<std::vector<char> >().swap(mem_chunk_);
+  mem_used_ = 0;
+  has_label = true;
+  block_size = 0;
+  nnz = 0;
+  max_feat = 0;
+  max_field = 0;
+}
+
+// Read the id-th chunk to the matrix. The chunk is kept in
+// memory if it fits in the rest of the memory budget.
+index_t BlockCache::ReadChunk(index_t id, DMatrix& matrix) {
+  CHECK(IsOpen());
+  CHECK_LT(id, ChunkNumber());
+  uint64 size = offset_[id+1] - offset_[id];
+  std::vector<char>* buf = &mem_chunk_[id];
+  if (buf->empty()) {
+    if (mem_used_ + size <= mem_budget_) {
+      mem_used_ += size;
+    } else {
+      buf = &buf_;
+    }
+    buf->resize(size);
+    seek_file(file_, offset_[id]);
+    CHECK_EQ(ReadDataFromDisk(file_, buf->data(), size), size);
+  }
+  const char* data = buf->data();
+  ChunkHead head;
+  memcpy(&head, data, sizeof(head));
+  uint64 row_length = head.row_length;
+  CHECK_EQ(size, sizeof(head) + row_length * (2 * sizeof(real_t) +
+                 sizeof(uint32)) + head.nnz * sizeof(Node));
+  const real_t* Y = reinterpret_cast<const real_t*>(
+    data + sizeof(head));
+  const real_t* norm = Y + row_length;
+  const uint32* row_size = reinterpret_cast<const uint32*>(
+    norm + row_length);
+  const Node* node = reinterpret_cast<const Node*>(
+    row_size + row_length);
+  matrix.Recycle();
+  matrix.has_label = head.has_label != 0;
+  for (index_t i = 0; i < row_length; ++i) {
+    matrix.AddRow();
+    matrix.Y[i] = Y[i];
+    matrix.norm[i] = norm[i];
+    if (row_size[i] == 0) { continue; }
+    // Get a (recycled) SparseRow from matrix
+    matrix.AddNode(i, 0, 0);
+    matrix.row[i]->assign(node, node + row_size[i]);
+    node += row_size[i];
+  }
+  matrix.UpdateStats();
+  return matrix.row_length;
+}
+
+// Number of the chunks in memory.
+index_t BlockCache::MemoryChunkNumber() const {
+  index_t num = 0;
+  for (size_t i = 0; i < mem_chunk_.size(); ++i) {
+    if (!mem_chunk_[i].empty()) { num++; }
+  }
+  return num;
+}
+
+}  // namespace xLearn
@@ -0,0 +1,184 @@
+//------------------------------------------------------------------------------
+// Copyright (c) 2018 by contributors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//------------------------------------------------------------------------------
+
+/*
+This file defines the BlockCache class, which stores the parsed
+blocks of a text file in a chunked binary (.cache) file.
+*/
+
+#ifndef XLEARN_DATA_BLOCK_CACHE_H_
+#define XLEARN_DATA_BLOCK_CACHE_H_
+
+#include <stdio.h>
+
+#include <string>
+#include <vector>
+
+#include "src/base/common.h"
+#include "src/base/file_signature.h"
+#include "src/data/data_structure.h"
+
+namespace xLearn {
+
+//------------------------------------------------------------------------------
+// BlockCache is the binary cache of the OndiskReader. Unlike the bin
+// file of InmemReader, the whole data never needs to be in memory: the
+// cache is written one block (DMatrix) at a time, and it is read back
+// one block at a time, in any order. The file is laid out as follows
+// (in native byte order):
+//
+//   [kCacheMagic][kCacheVersion][FileSignature]
+//   [chunk 0][chunk 1] ... [chunk n-1]
+//   [offset : uint64 * (n + 1)][statistics][block_size][n][kCacheMagic]
+//
+// Each chunk is a block of rows:
+//
+//   [row_length, has_label : uint32][nnz : uint64]
+//   [Y : real_t * row_length][norm : real_t * row_length]
+//   [size : uint32 * row_length][node : Node * nnz]
+//
+// The index of chunks is written at the end of the file, so a cache
+// that is not finished (e.g., the process is killed) has no valid
+// footer and will not be opened. The data is written to a temporary
+// file, which is renamed to the cache file by Finish().
+//
+// A memory budget can be given to the reader of the cache. The chunks
+// that are read first are kept in memory until their total size reaches
+// the budget, and they are not read from the file again. The other
+// chunks are read from the file each time. Hence, if the data is a bit
+// larger than the memory, most of the chunks are still read from memory,
+// while the page cache of the OS would evict all the chunks in each pass
+// of the file, because the least recently used chunk is always the one
+// to be read next. For example:
+//
+//   BlockCache writer;
+//   writer.Create("./train.txt.cache");
+//   while (reader->Samples(matrix)) {
+//     writer.Append(*matrix);
+//   }
+//   writer.Finish(signature);
+//
+//   BlockCache cache;
+//   cache.SetMemoryBudget(1024 * 1024 * 1024);  /* 1 GB */
+//   if (cache.Open("./train.txt.cache")) {
+//     DMatrix block;
+//     for (index_t i = 0; i < cache.ChunkNumber(); ++i) {
+//       cache.ReadChunk(i, block);
+//     }
+//   }
+//------------------------------------------------------------------------------
+class BlockCache {
+ public:
+  // Constructor and Destructor
+  BlockCache()
+   : has_label(true),
+     block_size(0),
+     nnz(0),
+     max_feat(0),
+     max_field(0),
+     file_(nullptr),
+     writing_(false),
+     pos_(0),
+     file_size_(0),
+     mem_budget_(0),
+     mem_used_(0) { }
+  ~BlockCache() { Close(); }
+
+  // Create a temporary file to write the chunks.
+  void Create(const std::string& filename);
+
+  // Write the matrix as a new chunk. An empty matrix is skipped.
+  void Append(const DMatrix& matrix);
+
+  // Write the index and the signature of the text file,
+  // and rename the temporary file to the cache file.
+  void Finish(const FileSignature& signature);
+
+  // Open the cache file and read its index. Return false if the
+  // file does not exist, or it is truncated, or it is of another
+  // version. The signature is not checked here.
+  bool Open(const std::string& filename);
+
+  // Close the file. The temporary file is removed if
+  // Finish() has not been called.
+  void Close();
+
+  // Whether a cache file is opened for reading.
+  inline bool IsOpen() const { return file_ != nullptr && !writing_; }
+
+  // Signature of the text file that generates the cache.
+  inline const FileSignature& Signature() const { return signature_; }
+
+  // Number of chunks in the cache.
+  inline index_t ChunkNumber() const {
+    return offset_.empty() ? 0 : offset_.size() - 1;
+  }
+
+  // Return the size (byte) of the cache file.
+  inline uint64 FileSize() const {
+    return offset_.empty() ? 0 : file_size_;
+  }
+
+  // Read the id-th chunk to the matrix, whose rows are recycled.
+  // Return the number of rows.
+  index_t ReadChunk(index_t id, DMatrix& matrix);
+
+  // Keep the chunks in memory until their total size reaches
+  // the budget (byte). Using 0 means reading all the chunks 
+  // from the file. The budget is kept after Close().
+  inline void SetMemoryBudget(uint64 budget) { mem_budget_ = budget; }
+
+  // Total size (byte) and number of the chunks in memory.
+  inline uint64 MemoryUsage() const { return mem_used_; }
+  index_t MemoryChunkNumber() const;
+
+  /* If current dataset has label y */
+  bool has_label;
+  /* Size (MB) of the text blocks, which is set by the writer */
+  uint32 block_size;
+  /* Statistics of the data */
+  uint64 nnz;
+  index_t max_feat;
+  index_t max_field;
+
+ protected:
+  /* File name of the cache and the temporary file */
+  std::string filename_;
+  std::string tmp_file_;
+  FILE* file_;
+  /* The file is opened by Create() */
+  bool writing_;
+  /* Current position of the file */
+  uint64 pos_;
+  uint64 file_size_;
+  /* Start offset of each chunk, and the index at the end */
+  std::vector<uint64> offset_;
+  /* Signature of the text file */
+  FileSignature signature_;
+  /* Buffer for a chunk */
+  std::vector<char> buf_;
+  /* Chunks that are kept in memory */
+  std::vector<std::vector<char> > mem_chunk_;
+  uint64 mem_budget_;
+  uint64 mem_used_;
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(BlockCache);
+};
+
+}  // namespace xLearn
+
+#endif  // XLEARN_DATA_BLOCK_CACHE_H_
@@ -0,0 +1,190 @@
+//------------------------------------------------------------------------------
+// Copyright (c) 2018 by contributors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//------------------------------------------------------------------------------
+
+/*
+This file tests block_cache.h file.
+*/
+
+#include "gtest/gtest.h"
+
+#include "src/base/file_util.h"
+#include "src/data/block_cache.h"
+
+namespace xLearn {
+
+const index_t kRowNum = 100;
+const index_t kChunkNum = 5;
+const std::string kCacheFile = "./test_block_cache.cache";
+
+// Build a block with some empty rows. The rows
+// of different blocks have different features.
+void init_block(DMatrix& matrix, index_t block) {
+  matrix.Recycle();
+  for (index_t i = 0; i < kRowNum; ++i) {
+    matrix.AddRow();
+    matrix.Y[i] = (i + block) % 2;
+    matrix.norm[i] = 1.0 / (i + 1);
+    if (i % 10 == 9) { continue; }  // empty row
+    for (index_t j = 0; j < i % 7 + 1; ++j) {
+      matrix.AddNode(i, block * 1000 + i * 10 + j, 0.1 * j, j);
+    }
+  }
+}
+
+// Check whether the two blocks are the same
+void check_block(const DMatrix& origin, const DMatrix& matrix) {
+  ASSERT_EQ(matrix.row_length, origin.row_length);
+  EXPECT_EQ(matrix.nnz, origin.nnz);
+  EXPECT_EQ(matrix.max_feat, origin.max_feat);
+  for (index_t i = 0; i < origin.row_length; ++i) {
+    EXPECT_FLOAT_EQ(matrix.Y[i], origin.Y[i]);
+    EXPECT_FLOAT_EQ(matrix.norm[i], origin.norm[i]);
+    if (origin.row[i] == nullptr) {
+      EXPECT_TRUE(matrix.row[i] == nullptr);
+      continue;
+    }
+    ASSERT_EQ(matrix.row[i]->size(), origin.row[i]->size());
+    for (size_t j = 0; j < origin.row[i]->size(); ++j) {
+      EXPECT_EQ((*matrix.row[i])[j].feat_id, (*origin.row[i])[j].feat_id);
+      EXPECT_EQ((*matrix.row[i])[j].field_id, (*origin.row[i])[j].field_id);
+      EXPECT_FLOAT_EQ((*matrix.row[i])[j].feat_val,
+                      (*origin.row[i])[j].feat_val);
+    }
+  }
+}
+
+// Write kChunkNum blocks to the cache file
+void write_cache(const FileSignature& signature) {
+  BlockCache writer;
+  writer.Create(kCacheFile);
+  DMatrix matrix;
+  for (index_t n = 0; n < kChunkNum; ++n) {
+    init_block(matrix, n);
+    writer.Append(matrix);
+  }
+  // Empty block is skipped
+  matrix.Recycle();
+  writer.Append(matrix);
+  writer.Finish(signature);
+}
+
+TEST(BLOCK_CACHE_TEST, WriteAndRead) {
+  FileSignature signature;
+  signature.size = 123;
+  signature.content_hash = 456;
+  write_cache(signature);
+  BlockCache cache;
+  ASSERT_TRUE(cache.Open(kCacheFile));
+  EXPECT_TRUE(cache.IsOpen());
+  EXPECT_EQ(cache.ChunkNumber(), kChunkNum);
+  EXPECT_EQ(cache.Signature().size, 123);
+  EXPECT_EQ(cache.Signature().content_hash, 456);
+  DMatrix origin, matrix;
+  uint64 nnz = 0;
+  for (index_t n = 0; n < kChunkNum; ++n) {
+    init_block(origin, n);
+    nnz += origin.nnz;
+  }
+  EXPECT_EQ(cache.nnz, nnz);
+  EXPECT_EQ(cache.max_feat, origin.max_feat);
+  EXPECT_EQ(cache.max_field, origin.max_field);
+  // Read the chunks in reverse order, twice
+  for (int epoch = 0; epoch < 2; ++epoch) {
+    for (index_t n = kChunkNum; n > 0; --n) {
+      init_block(origin, n - 1);
+      EXPECT_EQ(cache.ReadChunk(n - 1, matrix), kRowNum);
+      check_block(origin, matrix);
+    }
+  }
+  cache.Close();
+  EXPECT_FALSE(cache.IsOpen());
+  EXPECT_EQ(cache.ChunkNumber(), 0);
+  RemoveFile(kCacheFile.c_str());
+}
+
+TEST(BLOCK_CACHE_TEST, MemoryBudget) {
+  write_cache(FileSignature());
+  BlockCache cache;
+  ASSERT_TRUE(cache.Open(kCacheFile));
+  uint64 chunk_size = (cache.FileSize() - sizeof(uint64)) / kChunkNum;
+  cache.SetMemoryBudget(2 * chunk_size);
+  ASSERT_TRUE(cache.Open(kCacheFile));
+  DMatrix origin, matrix;
+  for (index_t n = 0; n < kChunkNum; ++n) {
+    init_block(origin, n);
+    cache.ReadChunk(n, matrix);
+    check_block(origin, matrix);
+  }
+  EXPECT_EQ(cache.MemoryChunkNumber(), 2);
+  EXPECT_LE(cache.MemoryUsage(), 2 * chunk_size);
+  // The first two chunks are read from memory, even if
+  // the file is overwritten.
+  {
+    FILE* file = OpenFileOrDie(kCacheFile.c_str(), "r+b");
+    std::vector<char> zero(cache.FileSize(), 0);
+    WriteDataToDisk(file, zero.data(), zero.size());
+    Close(file);
+  }
+  for (index_t n = 0; n < 2; ++n) {
+    init_block(origin, n);
+    cache.ReadChunk(n, matrix);
+    check_block(origin, matrix);
+  }
+  cache.Close();
+  EXPECT_EQ(cache.MemoryUsage(), 0);
+  EXPECT_EQ(cache.MemoryChunkNumber(), 0);
+  RemoveFile(kCacheFile.c_str());
+}
+
+TEST(BLOCK_CACHE_TEST, InvalidFile) {
+  BlockCache cache;
+  EXPECT_FALSE(cache.Open(kCacheFile));
+  // The cache is not finished
+  {
+    BlockCache writer;
+    writer.Create(kCacheFile);
+    DMatrix matrix;
+    init_block(matrix, 0);
+    writer.Append(matrix);
+  }
+  EXPECT_FALSE(cache.Open(kCacheFile));
+  // Truncated file
+  write_cache(FileSignature());
+  uint64 size = 0;
+  char* buf = nullptr;
+  {
+    FILE* file = OpenFileOrDie(kCacheFile.c_str(), "rb");
+    size = GetFileSize(file);
+    buf = new char[size];
+    ReadDataFromDisk(file, buf, size);
+    Close(file);
+  }
+  FILE* file = OpenFileOrDie(kCacheFile.c_str(), "wb");
+  WriteDataToDisk(file, buf, size - 1);
+  Close(file);
+  EXPECT_FALSE(cache.Open(kCacheFile));
+  // Another version
+  uint32 version = kCacheVersion + 1;
+  memcpy(buf + sizeof(uint64), &version, sizeof(version));
+  file = OpenFileOrDie(kCacheFile.c_str(), "wb");
+  WriteDataToDisk(file, buf, size);
+  Close(file);
+  EXPECT_FALSE(cache.Open(kCacheFile));
+  delete [] buf;
+  RemoveFile(kCacheFile.c_str());
+}
+
+}  // namespace xLearn
@@ -0,0 +1,204 @@
+//------------------------------------------------------------------------------
+// Copyright (c) 2018 by contributors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//------------------------------------------------------------------------------
+
+/*
+This file is the implementation of the CompressedMatrix class.
+*/
+
+#include "src/data/compressed_matrix.h"
+
+#include <algorithm>
+
+namespace xLearn {
+
+// Flags of each encoded row
+static const uint8 kNoValue = 1;    /* all values are 1.0 */
+static const uint8 kBF16Value = 2;  /* values are bfloat16 */
+static const uint8 kHasField = 4;   /* fields are stored */
+static const uint8 kByteField = 8;  /* fields are stored in one byte */
+
+// Append all the rows of the given matrix.
+void CompressedMatrix::Append(const DMatrix& matrix) {
+  CHECK_EQ(matrix.row_length, matrix.row.size());
+  has_label = matrix.has_label;
+  for (index_t i = 0; i < matrix.row_length; ++i) {
+    AppendRow(matrix.row[i], matrix.Y[i], matrix.norm[i]);
+  }
+}
+
+// Encode one row and append it to current matrix.
+void CompressedMatrix::AppendRow(const SparseRow* row, 
+                                 real_t y, 
+                                 real_t norm_val) {
+  Y.push_back(y);
+  norm.push_back(norm_val);
+  row_length++;
+  size_t nnz = row == nullptr ? 0 : row->size();
+  if (nnz == 0) {
+    buf_.push_back(kNoValue);
+    PutVarint(buf_, 0);
+    offset_.push_back(buf_.size());
+    return;
+  }
+  // Sort nodes by feature id
+  sort_buf_.assign(row->begin(), row->end());
+  std::sort(sort_buf_.begin(), sort_buf_.end(),
+    [](const Node& a, const Node& b) { return a.feat_id < b.feat_id; });
+  // Check how to store fields and values
+  bool all_one = true;
+  index_t max_field = 0;
+  for (size_t j = 0; j < nnz; ++j) {
+    if (sort_buf_[j].feat_val != 1.0f) { all_one = false; }
+    max_field = std::max(max_field, sort_buf_[j].field_id);
+  }
+  this->max_feat = std::max(this->max_feat, sort_buf_[nnz-1].feat_id);
+  this->max_field = std::max(this->max_field, max_field);
+  this->nnz += nnz;
+  uint8 flag = 0;
+  if (all_one) { 
+    flag |= kNoValue; 
+  } else if (quantize_) { 
+    flag |= kBF16Value; 
+  }
+  if (max_field > 0) { flag |= kHasField; }
+  if (max_field < 256) { flag |= kByteField; }
+  buf_.push_back(flag);
+  PutVarint(buf_, nnz);
+  // Feature id (delta)
+  index_t prev = 0;
+  for (size_t j = 0; j < nnz; ++j) {
+    PutVarint(buf_, sort_buf_[j].feat_id - prev);
+    prev = sort_buf_[j].feat_id;
+  }
+  // Field id
+  if (flag & kHasField) {
+    if (flag & kByteField) {
+      for (size_t j = 0; j < nnz; ++j) {
+        buf_.push_back(static_cast<uint8>(sort_buf_[j].field_id));
+      }
+    } else {
+      for (size_t j = 0; j < nnz; ++j) {
+        PutVarint(buf_, sort_buf_[j].field_id);
+      }
+    }
+  }
+  // Feature value
+  if (flag & kBF16Value) {
+    size_t pos = buf_.size();
+    buf_.resize(pos + nnz * sizeof(uint16));
+    for (size_t j = 0; j < nnz; ++j) {
+      uint16 v = FloatToBF16(sort_buf_[j].feat_val);
+      memcpy(&buf_[pos + j * sizeof(uint16)], &v, sizeof(v));
+    }
+  } else if (!(flag & kNoValue)) {
+    size_t pos = buf_.size();
+    buf_.resize(pos + nnz * sizeof(real_t));
+    for (size_t j = 0; j < nnz; ++j) {
+      memcpy(&buf_[pos + j * sizeof(real_t)], 
+             &sort_buf_[j].feat_val, 
+             sizeof(real_t));
+    }
+  }
+  offset_.push_back(buf_.size());
+}
+
+// Decode the id-th row to a Node array.
+size_t CompressedMatrix::DecodeRow(index_t id, 
+                                   std::vector<Node>& nodes) const {
+  CHECK_LT(id, row_length);
+  return DecodeNodes(buf_.data() + offset_[id], nodes);
+}
+
+// Decode the row that is encoded at ptr to a Node array.
+// Each part of the row is decoded in a separated tight 
+// loop, which is friendly to the compiler's vectorization.
+size_t CompressedMatrix::DecodeNodes(const uint8* ptr,
+                                     std::vector<Node>& nodes) {
+  uint8 flag = *ptr++;
+  size_t nnz = GetVarint(ptr);
+  nodes.resize(nnz);
+  if (nnz == 0) { return 0; }
+  Node* node = nodes.data();
+  // Feature id
+  index_t feat = 0;
+  for (size_t j = 0; j < nnz; ++j) {
+    feat += GetVarint(ptr);
+    node[j].feat_id = feat;
+  }
+  // Field id
+  if (!(flag & kHasField)) {
+    for (size_t j = 0; j < nnz; ++j) { node[j].field_id = 0; }
+  } else if (flag & kByteField) {
+    for (size_t j = 0; j < nnz; ++j) { node[j].field_id = ptr[j]; }
+    ptr += nnz;
+  } else {
+    for (size_t j = 0; j < nnz; ++j) { node[j].field_id = GetVarint(ptr); }
+  }
+  // Feature value
+  if (flag & kNoValue) {
+    for (size_t j = 0; j < nnz; ++j) { node[j].feat_val = 1.0; }
+  } else if (flag & kBF16Value) {
+    for (size_t j = 0; j < nnz; ++j) {
+      uint16 v;
+      memcpy(&v, ptr + j * sizeof(uint16), sizeof(v));
+      node[j].feat_val = BF16ToFloat(v);
+    }
+  } else {
+    for (size_t j = 0; j < nnz; ++j) {
+      memcpy(&node[j].feat_val, ptr + j * sizeof(real_t), sizeof(real_t));
+    }
+  }
+  return nnz;
+}
+
+// Decode the id-th row and append it to the given matrix.
+void CompressedMatrix::DecodeRow(index_t id, DMatrix& matrix) const {
+  matrix.AddRow();
+  index_t i = matrix.row_length - 1;
+  matrix.Y[i] = Y[id];
+  matrix.norm[i] = norm[id];
+  // Get a (recycled) SparseRow from matrix
+  const uint8* ptr = buf_.data() + offset_[id] + 1;
+  if (GetVarint(ptr) == 0) { return; }
+  matrix.AddNode(i, 0, 0);
+  SparseRow& sr = *(matrix.row[i]);
+  size_t nnz = DecodeRow(id, sr);
+  // Update the statistics of matrix. Note that the nodes
+  // are sorted by feature id, and AddNode() has already 
+  // counted the first node.
+  matrix.nnz += nnz - 1;
+  matrix.max_feat = std::max(matrix.max_feat, sr[nnz-1].feat_id);
+  for (size_t j = 0; j < nnz; ++j) {
+    matrix.max_field = std::max(matrix.max_field, sr[j].field_id);
+  }
+}
+
+// Free all the memory.
+void CompressedMatrix::Reset() {
+  row_length = 0;
+  has_label = true;
+  max_feat = 0;
+  max_field = 0;
+  nnz = 0;
+  std::vector<uint8>().swap(buf_);
+  std::vector<uint64>().swap(offset_);
+  std::vector<real_t>().swap(Y);
+  std::vector<real_t>().swap(norm);
+  std::vector<Node>().swap(sort_buf_);
+  offset_.push_back(0);
+}
+
+}  // namespace xLearn
@@ -0,0 +1,189 @@
+//------------------------------------------------------------------------------
+// Copyright (c) 2018 by contributors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//------------------------------------------------------------------------------
+
+/*
+This file defines the CompressedMatrix class, which stores
+the rows of a DMatrix in a compact byte format.
+*/
+
+#ifndef XLEARN_DATA_COMPRESSED_MATRIX_H_
+#define XLEARN_DATA_COMPRESSED_MATRIX_H_
+
+#include <string.h>
+#include <vector>
+
+#include "src/base/common.h"
+#include "src/data/data_structure.h"
+
+namespace xLearn {
+
+//------------------------------------------------------------------------------
+// CompressedMatrix stores a dataset in a byte stream instead of the
+// 12-byte Node arrays of DMatrix, which lets a larger dataset fit into
+// the memory of in-memory training. Each row is encoded as:
+//
+//   [flag][nnz][feat delta ...][field ...][value ...]
+//
+//   flag  : one byte that describes how the fields and values are stored.
+//   nnz   : number of nodes, varint encoded.
+//   feat  : feature ids are sorted, and each id is stored as a varint
+//           delta from the previous one.
+//   field : omitted if all fields are zero (linear and fm), one byte
+//           if all fields < 256, and varint otherwise.
+//   value : omitted if all values are 1.0 (one-hot features), bfloat16
+//           if quantization is enabled, and raw float otherwise.
+//
+// Note that the order of nodes in a row is changed (sorted by feature id),
+// which does not change the result of the linear, fm, or ffm score.
+// We can use the CompressedMatrix like this:
+//
+//   DMatrix matrix;
+//   ... /* add data to matrix */
+//
+//   CompressedMatrix cmat;
+//   cmat.SetQuantize(false);  /* lossless */
+//   cmat.Append(matrix);
+//   matrix.Reset();
+//
+//   /* Decode a batch of rows to a DMatrix */
+//   DMatrix batch;
+//   batch.Recycle();
+//   for (index_t i = 0; i < 100; ++i) {
+//     cmat.DecodeRow(i, batch);
+//   }
+//------------------------------------------------------------------------------
+class CompressedMatrix {
+ public:
+  // Constructor and Destructor
+  CompressedMatrix()
+   : row_length(0),
+     has_label(true),
+     max_feat(0),
+     max_field(0),
+     nnz(0),
+     quantize_(false) {
+    offset_.push_back(0);
+  }
+  ~CompressedMatrix() { }
+
+  // Store feature value in bfloat16 format, which is lossy.
+  inline void SetQuantize(bool quantize) { quantize_ = quantize; }
+  inline bool IsQuantized() const { return quantize_; }
+
+  // Append all the rows of the given matrix.
+  void Append(const DMatrix& matrix);
+
+  // Encode one row and append it to current matrix.
+  void AppendRow(const SparseRow* row, real_t y, real_t norm_val);
+
+  // Decode the id-th row and append it to the given matrix.
+  void DecodeRow(index_t id, DMatrix& matrix) const;
+
+  // Decode the id-th row to a Node array.
+  // Return the number of nodes.
+  size_t DecodeRow(index_t id, std::vector<Node>& nodes) const;
+
+  // Decode the row that is encoded at ptr to a Node array.
+  // Return the number of nodes.
+  static size_t DecodeNodes(const uint8* ptr, std::vector<Node>& nodes);
+
+  // The encoded byte stream. The i-th row is stored 
+  // in [Offset()[i], Offset()[i+1]) of Buffer().
+  inline const std::vector<uint8>& Buffer() const { return buf_; }
+  inline const std::vector<uint64>& Offset() const { return offset_; }
+
+  // Free all the memory.
+  void Reset();
+
+  // Return the memory size (byte) of current matrix.
+  uint64 MemorySize() const {
+    return buf_.capacity() +
+           offset_.capacity() * sizeof(uint64) +
+           (Y.capacity() + norm.capacity()) * sizeof(real_t);
+  }
+
+  /* Number of row */
+  index_t row_length;
+  /* Label y */
+  std::vector<real_t> Y;
+  /* Used for instance-wise normalization */
+  std::vector<real_t> norm;
+  /* If current dataset has label y */
+  bool has_label;
+  /* Statistics of the data */
+  index_t max_feat;
+  index_t max_field;
+  uint64 nnz;
+
+ protected:
+  /* Encoded byte stream of all rows */
+  std::vector<uint8> buf_;
+  /* The i-th row is stored in [offset_[i], offset_[i+1]) */
+  std::vector<uint64> offset_;
+  /* Quantize feature value ? */
+  bool quantize_;
+  /* Buffer for sorting nodes in AppendRow() */
+  std::vector<Node> sort_buf_;
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(CompressedMatrix);
+};
+
+//------------------------------------------------------------------------------
+// Varint and bfloat16 helpers
+//------------------------------------------------------------------------------
+
+// Append an unsigned integer to buffer using varint encoding.
+inline void PutVarint(std::vector<uint8>& buf, uint32 value) {
+  while (value >= 0x80) {
+    buf.push_back(static_cast<uint8>(value | 0x80));
+    value >>= 7;
+  }
+  buf.push_back(static_cast<uint8>(value));
+}
+
+// Read a varint from buffer and move the pointer forward.
+inline uint32 GetVarint(const uint8*& ptr) {
+  uint32 value = *ptr++;
+  if (value < 0x80) { return value; }
+  value &= 0x7F;
+  for (int shift = 7; ; shift += 7) {
+    uint32 byte = *ptr++;
+    value |= (byte & 0x7F) << shift;
+    if (byte < 0x80) { break; }
+  }
+  return value;
+}
+
+// Convert float to bfloat16 (round to nearest even).
+inline uint16 FloatToBF16(real_t value) {
+  uint32 bits;
+  memcpy(&bits, &value, sizeof(bits));
+  bits += 0x7FFF + ((bits >> 16) & 1);
+  return static_cast<uint16>(bits >> 16);
+}
+
+// Convert bfloat16 to float.
+inline real_t BF16ToFloat(uint16 value) {
+  uint32 bits = static_cast<uint32>(value) << 16;
+  real_t ret;
+  memcpy(&ret, &bits, sizeof(ret));
+  return ret;
+}
+
+}  // namespace xLearn
+
+#endif  // XLEARN_DATA_COMPRESSED_MATRIX_H_
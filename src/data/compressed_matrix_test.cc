@@ -0,0 +1,154 @@
+//------------------------------------------------------------------------------
+// Copyright (c) 2018 by contributors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//------------------------------------------------------------------------------
+
+
+/*
+This file tests compressed_matrix.h file.
+*/
+
+#include <algorithm>
+
+#include "gtest/gtest.h"
+
+#include "src/data/compressed_matrix.h"
+
+namespace xLearn {
+
+const index_t kRowNum = 100;
+
+// Build a matrix with different kinds of rows
+void init_matrix(DMatrix& matrix) {
+  matrix.Reset();
+  for (index_t i = 0; i < kRowNum; ++i) {
+    matrix.AddRow();
+    matrix.Y[i] = i % 2;
+    matrix.norm[i] = 0.5;
+    if (i % 10 == 9) { continue; }  // empty row
+    for (index_t j = 0; j < 5; ++j) {
+      // Unsorted feature id
+      index_t feat = (5 - j) * (i + 1) * 1000;
+      real_t value = (i % 3 == 0) ? 1.0 : 0.1 * j;
+      index_t field = (i % 4 == 0) ? 0 : j * (i + 1);
+      matrix.AddNode(i, feat, value, field);
+    }
+  }
+}
+
+// Check the decoded row against the original row
+void check_row(const SparseRow* origin, 
+               const std::vector<Node>& nodes,
+               bool quantize) {
+  std::vector<Node> sorted(origin->begin(), origin->end());
+  std::sort(sorted.begin(), sorted.end(),
+    [](const Node& a, const Node& b) { return a.feat_id < b.feat_id; });
+  ASSERT_EQ(sorted.size(), nodes.size());
+  for (size_t j = 0; j < nodes.size(); ++j) {
+    EXPECT_EQ(nodes[j].feat_id, sorted[j].feat_id);
+    EXPECT_EQ(nodes[j].field_id, sorted[j].field_id);
+    if (quantize) {
+      EXPECT_NEAR(nodes[j].feat_val, sorted[j].feat_val, 0.002);
+    } else {
+      EXPECT_FLOAT_EQ(nodes[j].feat_val, sorted[j].feat_val);
+    }
+  }
+}
+
+TEST(COMPRESSED_MATRIX_TEST, Varint) {
+  std::vector<uint8> buf;
+  uint32 values[] = {0, 1, 127, 128, 16383, 16384, kUInt32Max};
+  for (int i = 0; i < 7; ++i) {
+    PutVarint(buf, values[i]);
+  }
+  EXPECT_EQ(buf.size(), 1+1+1+2+2+3+5);
+  const uint8* ptr = buf.data();
+  for (int i = 0; i < 7; ++i) {
+    EXPECT_EQ(GetVarint(ptr), values[i]);
+  }
+  EXPECT_EQ(ptr, buf.data() + buf.size());
+}
+
+TEST(COMPRESSED_MATRIX_TEST, Lossless) {
+  DMatrix matrix;
+  init_matrix(matrix);
+  CompressedMatrix cmat;
+  cmat.Append(matrix);
+  EXPECT_EQ(cmat.row_length, kRowNum);
+  EXPECT_EQ(cmat.nnz, matrix.nnz);
+  EXPECT_EQ(cmat.max_feat, matrix.max_feat);
+  EXPECT_EQ(cmat.max_field, matrix.max_field);
+  std::vector<Node> nodes;
+  for (index_t i = 0; i < kRowNum; ++i) {
+    EXPECT_FLOAT_EQ(cmat.Y[i], matrix.Y[i]);
+    EXPECT_FLOAT_EQ(cmat.norm[i], matrix.norm[i]);
+    if (matrix.row[i] == nullptr) {
+      EXPECT_EQ(cmat.DecodeRow(i, nodes), 0);
+      continue;
+    }
+    EXPECT_EQ(cmat.DecodeRow(i, nodes), 5);
+    check_row(matrix.row[i], nodes, false);
+  }
+  // The compressed data should be much smaller
+  uint64 node_bytes = 0;
+  for (index_t i = 0; i < kRowNum; ++i) {
+    if (matrix.row[i] != nullptr) {
+      node_bytes += matrix.row[i]->size() * sizeof(Node);
+    }
+  }
+  EXPECT_LT(cmat.MemorySize() - 2 * kRowNum * sizeof(real_t), node_bytes);
+}
+
+TEST(COMPRESSED_MATRIX_TEST, Quantize) {
+  DMatrix matrix;
+  init_matrix(matrix);
+  CompressedMatrix cmat;
+  cmat.SetQuantize(true);
+  cmat.Append(matrix);
+  std::vector<Node> nodes;
+  for (index_t i = 0; i < kRowNum; ++i) {
+    if (matrix.row[i] == nullptr) { continue; }
+    cmat.DecodeRow(i, nodes);
+    check_row(matrix.row[i], nodes, true);
+  }
+}
+
+TEST(COMPRESSED_MATRIX_TEST, DecodeToDMatrix) {
+  DMatrix matrix;
+  init_matrix(matrix);
+  CompressedMatrix cmat;
+  cmat.Append(matrix);
+  DMatrix batch;
+  for (int n = 0; n < 2; ++n) {
+    batch.Recycle();
+    for (index_t i = 0; i < kRowNum; ++i) {
+      cmat.DecodeRow(i, batch);
+    }
+    EXPECT_EQ(batch.row_length, kRowNum);
+    for (index_t i = 0; i < kRowNum; ++i) {
+      EXPECT_FLOAT_EQ(batch.Y[i], matrix.Y[i]);
+      EXPECT_FLOAT_EQ(batch.norm[i], matrix.norm[i]);
+      if (matrix.row[i] == nullptr) {
+        EXPECT_TRUE(batch.row[i] == nullptr);
+        continue;
+      }
+      check_row(matrix.row[i], *(batch.row[i]), false);
+    }
+  }
+  cmat.Reset();
+  EXPECT_EQ(cmat.row_length, 0);
+  EXPECT_EQ(cmat.Y.empty(), true);
+}
+
+}  // namespace xLearn
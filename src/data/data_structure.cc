@@ -0,0 +1,184 @@
+//------------------------------------------------------------------------------
+// Copyright (c) 2018 by contributors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//------------------------------------------------------------------------------
+
+
+/*
+This file is the implementation of the parallel 
+DMatrix::Compress() and its helper functions.
+*/
+
+#include "src/data/data_structure.h"
+
+#include "src/base/logging.h"
+#include "src/base/thread_pool.h"
+#include "src/base/timer.h"
+
+namespace xLearn {
+
+// Sort the ids by LSD radix sort (8 bits in each pass)
+// and remove the duplicate ids.
+void RadixSortUnique(std::vector<index_t>& ids) {
+  size_t n = ids.size();
+  if (n == 0) { return; }
+  std::vector<index_t> tmp(n);
+  for (int shift = 0; shift < 32; shift += 8) {
+    size_t count[257] = {0};
+    for (size_t i = 0; i < n; ++i) {
+      count[((ids[i] >> shift) & 0xFF) + 1]++;
+    }
+    // Skip this pass if all ids have the same byte
+    if (count[((ids[0] >> shift) & 0xFF) + 1] == n) { continue; }
+    for (int b = 0; b < 256; ++b) {
+      count[b+1] += count[b];
+    }
+    for (size_t i = 0; i < n; ++i) {
+      tmp[count[(ids[i] >> shift) & 0xFF]++] = ids[i];
+    }
+    ids.swap(tmp);
+  }
+  ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+}
+
+// Collect the sorted and unique feature ids of rows [start, end).
+static void collect_thread(const DMatrix* matrix,
+                           std::vector<index_t>* ids,
+                           size_t* nnz,
+                           size_t start,
+                           size_t end) {
+  CHECK_GE(end, start);
+  size_t count = 0;
+  for (size_t i = start; i < end; ++i) {
+    if (matrix->row[i] != nullptr) {
+      count += matrix->row[i]->size();
+    }
+  }
+  ids->clear();
+  ids->reserve(count);
+  for (size_t i = start; i < end; ++i) {
+    SparseRow* row = matrix->row[i];
+    if (row == nullptr) { continue; }
+    for (SparseRow::iterator iter = row->begin();
+         iter != row->end(); ++iter) {
+      ids->push_back(iter->feat_id);
+    }
+  }
+  *nnz = count;
+  RadixSortUnique(*ids);
+}
+
+// Rewrite the feature ids of rows [start, end) to the position
+// (start from 1) in feature_list. If the rank table is not empty,
+// the new id of feat_id is rank[feat_id - base].
+static void rewrite_thread(DMatrix* matrix,
+                           const std::vector<index_t>* feature_list,
+                           const std::vector<index_t>* rank,
+                           index_t base,
+                           size_t start,
+                           size_t end) {
+  CHECK_GE(end, start);
+  for (size_t i = start; i < end; ++i) {
+    SparseRow* row = matrix->row[i];
+    if (row == nullptr) { continue; }
+    if (!rank->empty()) {
+      for (SparseRow::iterator iter = row->begin();
+           iter != row->end(); ++iter) {
+        iter->feat_id = (*rank)[iter->feat_id - base];
+      }
+    } else {
+      for (SparseRow::iterator iter = row->begin();
+           iter != row->end(); ++iter) {
+        iter->feat_id = std::lower_bound(feature_list->begin(),
+                                         feature_list->end(),
+                                         iter->feat_id) 
+                      - feature_list->begin() + 1;
+      }
+    }
+  }
+}
+
+// Compress current sparse matrix to a dense matrix.
+void DMatrix::Compress(std::vector<index_t>& feature_list,
+                       ThreadPool* pool) {
+  Timer timer;
+  timer.tic();
+  size_t threadNumber = pool == nullptr ? 1 : pool->ThreadNumber();
+  // Collect the feature ids in each thread
+  std::vector<std::vector<index_t>> ids(threadNumber);
+  std::vector<size_t> nnz(threadNumber, 0);
+  if (threadNumber == 1) {
+    collect_thread(this, &ids[0], &nnz[0], 0, row_length);
+  } else {
+    for (size_t i = 0; i < threadNumber; ++i) {
+      size_t start_idx = getStart(row_length, threadNumber, i);
+      size_t end_idx = getEnd(row_length, threadNumber, i);
+      pool->enqueue(std::bind(collect_thread, this, &ids[i], 
+                              &nnz[i], start_idx, end_idx));
+    }
+    pool->Sync(threadNumber);
+  }
+  // Merge the sorted lists
+  feature_list.swap(ids[0]);
+  std::vector<index_t> tmp;
+  for (size_t i = 1; i < threadNumber; ++i) {
+    tmp.clear();
+    tmp.reserve(feature_list.size() + ids[i].size());
+    std::set_union(feature_list.begin(), feature_list.end(),
+                   ids[i].begin(), ids[i].end(),
+                   std::back_inserter(tmp));
+    feature_list.swap(tmp);
+  }
+  // Use a dense rank table if the id range is narrow
+  std::vector<index_t> rank;
+  index_t base = 0;
+  if (!feature_list.empty()) {
+    base = feature_list.front();
+    uint64 span = (uint64)feature_list.back() - base + 1;
+    if (span <= 4 * (uint64)feature_list.size()) {
+      rank.resize(span, 0);
+      for (index_t i = 0; i < feature_list.size(); ++i) {
+        rank[feature_list[i] - base] = i + 1;
+      }
+    }
+  }
+  // Rewrite the feature ids
+  if (threadNumber == 1) {
+    rewrite_thread(this, &feature_list, &rank, base, 0, row_length);
+  } else {
+    for (size_t i = 0; i < threadNumber; ++i) {
+      size_t start_idx = getStart(row_length, threadNumber, i);
+      size_t end_idx = getEnd(row_length, threadNumber, i);
+      pool->enqueue(std::bind(rewrite_thread, this, &feature_list, 
+                              &rank, base, start_idx, end_idx));
+    }
+    pool->Sync(threadNumber);
+  }
+  // New feature ids are in [1, feature_list.size()]
+  max_feat = feature_list.size();
+  // Report throughput
+  size_t node_num = 0;
+  for (size_t i = 0; i < threadNumber; ++i) {
+    node_num += nnz[i];
+  }
+  float time_cost = timer.toc();
+  LOG(INFO) << "Compress " << row_length << " rows, " 
+            << node_num << " nodes, " 
+            << feature_list.size() << " features in " 
+            << time_cost << " sec ("
+            << (time_cost > 0 ? node_num / time_cost / 1e6 : 0)
+            << " M nodes/sec) using " << threadNumber << " threads.";
+}
+
+}  // namespace xLearn
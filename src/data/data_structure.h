@@ -22,7 +22,6 @@ This file defines the basic data structures.
 #define XLEARN_DATA_DATA_STRUCTURE_H_
 
 #include <vector>
-#include <unordered_set>
 #include <unordered_map>
 #include <algorithm>
 
@@ -30,6 +29,8 @@ This file defines the basic data structures.
 #include "src/base/file_util.h"
 #include "src/base/stl-util.h"
 
+class ThreadPool;
+
 namespace xLearn {
 
 //------------------------------------------------------------------------------
@@ -40,10 +41,17 @@ typedef float real_t;
 
 //------------------------------------------------------------------------------
 // We use 32-bits unsigned integer to store the index 
-// of the feature and the model parameters.
+// of the feature and the field.
 //------------------------------------------------------------------------------
 typedef uint32 index_t;
 
+//------------------------------------------------------------------------------
+// We use 64-bits unsigned integer to store the index (and the number)
+// of the model parameters, because an ffm model can have more than
+// 2^32 parameters, e.g., 5M features * 40 fields * 8 (K) * 2 (aux).
+//------------------------------------------------------------------------------
+typedef uint64 param_index_t;
+
 //------------------------------------------------------------------------------
 // Mapping sparse feature to dense feature. Used by distributed computation.
 //------------------------------------------------------------------------------
@@ -56,6 +64,36 @@ typedef std::unordered_map<index_t, index_t> feature_map;
 const int kAlign = 4;
 const int kAlignByte = 16;
 
+//------------------------------------------------------------------------------
+// DMatrix::Recycle() will not keep the SparseRow whose capacity is
+// larger than this value, which avoids holding memory for outliers.
+//------------------------------------------------------------------------------
+const size_t kMaxRecycleNode = 64 * 1024;
+
+//------------------------------------------------------------------------------
+// Magic number in front of the statistics at the tail of binary file.
+//------------------------------------------------------------------------------
+const uint64 kStatsMagic = 0x5354415453584c58;  // "XLXSTATS"
+
+//------------------------------------------------------------------------------
+// Magic number and version in front of the binary (.bin) file of the
+// InmemReader. They are followed by the signature of the text file
+// (see src/base/file_signature.h) and the data in the flat layout of
+// MappedMatrix (see src/data/mapped_matrix.h). The bin file of an old
+// version (1: two hash values of the text file, 2: the serialized 
+// DMatrix) is regenerated by the current version.
+//------------------------------------------------------------------------------
+const uint64 kBinMagic = 0x4e49425f58584c58;  // "XLXX_BIN"
+const uint32 kBinVersion = 3;
+
+//------------------------------------------------------------------------------
+// Magic number and version of the binary cache (.cache) file of the
+// OndiskReader, which stores the parsed blocks of the text file in
+// chunks (see src/data/block_cache.h).
+//------------------------------------------------------------------------------
+const uint64 kCacheMagic = 0x4548434143584c58;  // "XLXCACHE"
+const uint32 kCacheVersion = 1;
+
 //------------------------------------------------------------------------------
 // MetricInfo stores the evaluation metric information, which
 // will be printed for users during the training.
@@ -129,6 +167,10 @@ typedef std::vector<Node> SparseRow;
 //    /* We can also get the max index of feature or field */
 //    index_t max_feat = matrix.MaxFeat();
 //    index_t max_field = matrix.MaxField();
+//
+//    /* Or use the statistics maintained by AddNode() */
+//    index_t max_feat = matrix.max_feat;
+//    index_t max_field = matrix.max_field;
 //------------------------------------------------------------------------------
 // TODO(aksnzhy): Implement incremental adding
 struct DMatrix {
@@ -141,10 +183,14 @@ struct DMatrix {
      Y(0),
      norm(0),
      has_label(false),
-     pos(0) { }
+     pos(0),
+     row_high_water(0),
+     max_feat(0),
+     max_field(0),
+     nnz(0) { }
 
   // Destructor
-  ~DMatrix() { }
+  ~DMatrix() { STLDeleteElementsAndClear(&free_row); }
 
   // ReAlloc memory for the DMatrix.
   // This function will first release the original
@@ -177,17 +223,61 @@ struct DMatrix {
     // Delete Y
     std::vector<real_t>().swap(this->Y);
     // Delete Node
-    for (int i = 0; i < this->row_length; ++i) {
-      if ((this->row)[i] != nullptr) {
-        STLDeleteElementsAndClear(&(this->row));
-      }
-    }
+    STLDeleteElementsAndClear(&(this->row));
     // Delete SparseRow
     std::vector<SparseRow*>().swap(this->row);
     // Delete norm
     std::vector<real_t>().swap(this->norm);
+    // Delete the recycled rows
+    STLDeleteElementsAndClear(&(this->free_row));
+    std::vector<SparseRow*>().swap(this->free_row);
+    this->row_high_water = 0;
+    this->row_length = 0;
+    this->pos = 0;
+    this->ResetStats();
+  }
+
+  // Release all the rows of current matrix, but keep their
+  // memory for the next round of AddRow() and AddNode().
+  // This is used by the on-disk training, which parses a new
+  // block into the same DMatrix again and again, and hence we
+  // don't need to free and re-allocate every SparseRow for each 
+  // block. The number of rows we keep is bounded by a decaying 
+  // high-water mark, so a single huge block cannot pin its memory 
+  // forever. Note that we cannot use Recycle() on a matrix that
+  // shares its rows with another matrix.
+  void Recycle() {
+    this->has_label = true;
+    this->hash_value_1 = 0;
+    this->hash_value_2 = 0;
+    for (index_t i = 0; i < this->row_length; ++i) {
+      SparseRow* sr = this->row[i];
+      if (sr == nullptr) { continue; }
+      if (sr->capacity() > kMaxRecycleNode) {
+        delete sr;
+      } else {
+        sr->clear();
+        this->free_row.push_back(sr);
+      }
+    }
+    // High-water-mark trim
+    this->row_high_water = std::max(this->row_length, 
+                                    this->row_high_water / 2);
+    while (this->free_row.size() > this->row_high_water) {
+      delete this->free_row.back();
+      this->free_row.pop_back();
+    }
+    if (this->row.capacity() > 2 * this->row_high_water) {
+      std::vector<SparseRow*>().swap(this->row);
+      std::vector<real_t>().swap(this->Y);
+      std::vector<real_t>().swap(this->norm);
+    }
+    this->row.clear();
+    this->Y.clear();
+    this->norm.clear();
     this->row_length = 0;
     this->pos = 0;
+    this->ResetStats();
   }
 
   // Dynamically adding new row for current DMatrix.
@@ -207,11 +297,71 @@ struct DMatrix {
                index_t field_id = 0) {
     CHECK_GT(row_length, row_id);
     // Allocate memory for the first adding
-    if (row[row_id] == nullptr) {
-      row[row_id] = new SparseRow;
-    }
+    alloc_row(row_id);
     Node node(field_id, feat_id, feat_val);
     row[row_id]->push_back(node);
+    // Update statistics
+    if (feat_id > max_feat) { max_feat = feat_id; }
+    if (field_id > max_field) { max_field = field_id; }
+    nnz++;
+  }
+
+  // Add the nodes [begin, end) to a row at once, so that the
+  // row is allocated only once, e.g., the columns of a csv line.
+  void AddNodes(index_t row_id, const Node* begin, const Node* end) {
+    CHECK_GT(row_length, row_id);
+    if (begin == end) { return; }
+    alloc_row(row_id);
+    row[row_id]->insert(row[row_id]->end(), begin, end);
+    // Update statistics
+    for (const Node* node = begin; node != end; ++node) {
+      if (node->feat_id > max_feat) { max_feat = node->feat_id; }
+      if (node->field_id > max_field) { max_field = node->field_id; }
+    }
+    nnz += end - begin;
+  }
+
+  // Return the id-th row, or an empty row if it has no node,
+  // e.g., all the columns of a csv line are zero.
+  const SparseRow* GetRow(index_t row_id) const {
+    static const SparseRow kEmptyRow;
+    return row[row_id] == nullptr ? &kEmptyRow : row[row_id];
+  }
+
+  // Get a (recycled) SparseRow for the row if it has none.
+  void alloc_row(index_t row_id) {
+    if (row[row_id] == nullptr) {
+      if (free_row.empty()) {
+        row[row_id] = new SparseRow;
+      } else {
+        row[row_id] = free_row.back();
+        free_row.pop_back();
+      }
+    }
+  }
+
+  // Clear the statistics of the data.
+  void ResetStats() {
+    max_feat = 0;
+    max_field = 0;
+    nnz = 0;
+  }
+
+  // Re-compute the statistics of the data by scanning all the 
+  // nodes. This is only needed when the nodes are not added by 
+  // AddNode(), e.g., reading an old binary file.
+  void UpdateStats() {
+    this->ResetStats();
+    for (index_t i = 0; i < row_length; ++i) {
+      SparseRow* sr = this->row[i];
+      if (sr == nullptr) { continue; }
+      for (SparseRow::const_iterator iter = sr->begin();
+           iter != sr->end(); ++iter) {
+        if (iter->feat_id > max_feat) { max_feat = iter->feat_id; }
+        if (iter->field_id > max_field) { max_field = iter->field_id; }
+      }
+      nnz += sr->size();
+    }
   }
 
   // The hash value is used to identify the difference
@@ -224,6 +374,33 @@ struct DMatrix {
     hash_value_2 = hash_2;
   }
 
+  // Move all the rows of another matrix to the end of this 
+  // matrix without copying the nodes. After that, the other 
+  // matrix is empty, and it takes the recycled rows of this 
+  // matrix, so that both matrices can reuse their memory in 
+  // the next round of parsing.
+  void MoveFrom(DMatrix& other) {
+    for (index_t i = 0; i < other.row_length; ++i) {
+      this->row.push_back(other.row[i]);
+      this->Y.push_back(other.Y[i]);
+      this->norm.push_back(other.norm[i]);
+      if (other.row[i] != nullptr && !this->free_row.empty()) {
+        other.free_row.push_back(this->free_row.back());
+        this->free_row.pop_back();
+      }
+    }
+    this->row_length += other.row_length;
+    this->max_feat = std::max(this->max_feat, other.max_feat);
+    this->max_field = std::max(this->max_field, other.max_field);
+    this->nnz += other.nnz;
+    other.row.clear();
+    other.Y.clear();
+    other.norm.clear();
+    other.row_length = 0;
+    other.pos = 0;
+    other.ResetStats();
+  }
+
   // Copy another data matrix to this matrix.
   // Note that here we do the deep copy and we will
   // allocate memory if current matrix is empty.
@@ -277,39 +454,14 @@ struct DMatrix {
   //  -------------------------------------------------
   //  | 1 | 2 | 3 | 4 | 5 | 7 | 8 | 10 | 11 | 12 | 20 |
   //  -------------------------------------------------
-  void Compress(std::vector<index_t>& feature_list) {
-    // Using a map to store the mapping relations
-    size_t node_num {0};
-    for (auto row : this->row) {
-      node_num += row->size();
-    }
-    std::unordered_set<index_t> feat_set;
-    feat_set.reserve(node_num);
-    for (index_t i = 0; i < this->row_length; ++i) {
-      SparseRow* row = this->row[i];
-      for (SparseRow::iterator iter = row->begin();
-           iter != row->end(); ++iter) {
-        if (feat_set.count(iter->feat_id) == 0) {
-          feat_set.insert(iter->feat_id);
-        }
-      }
-    }
-    feature_list.reserve(feat_set.size());
-    std::copy(feat_set.begin(), feat_set.end(), 
-              std::back_inserter(feature_list));
-    std::sort(begin(feature_list), end(feature_list));
-    feature_map mp;
-    mp.reserve(feature_list.size());
-    for (index_t i = 0; i < feature_list.size(); ++ i) {
-      mp[feature_list[i]] = i + 1;
-    }
-    for (index_t i = 0; i < this->row_length; ++ i) {
-      for (auto &iter: *this->row[i]) {
-        // using map is better than lower_bound
-        iter.feat_id = mp[iter.feat_id];
-      }
-    }
-  }
+  //
+  // Each thread collects and radix-sorts the feature ids of its 
+  // rows, the sorted lists are merged into feature_list, and then
+  // the ids are rewritten in parallel by a dense rank table (for 
+  // a narrow id range) or by binary search. If pool is nullptr, 
+  // Compress() runs in current thread.
+  void Compress(std::vector<index_t>& feature_list,
+                ThreadPool* pool = nullptr);
 
   // Get a mini-batch of data from current data matrix.
   // This method will be used for distributed computation. 
@@ -343,6 +495,17 @@ struct DMatrix {
     // Write hash_value
     WriteDataToDisk(file, (char*)&hash_value_1, sizeof(hash_value_1));
     WriteDataToDisk(file, (char*)&hash_value_2, sizeof(hash_value_2));
+    Serialize(file);
+    Close(file);
+  }
+
+  // Serialize current DMatrix (without the hash value) from 
+  // the current position of file. The file is not closed.
+  void Serialize(FILE* file) {
+    CHECK_NOTNULL(file);
+    CHECK_EQ(row_length, row.size());
+    CHECK_EQ(row_length, Y.size());
+    CHECK_EQ(row_length, norm.size());
     // Write row_length
     WriteDataToDisk(file, (char*)&row_length, sizeof(row_length));
     // Write row
@@ -357,7 +520,12 @@ struct DMatrix {
     WriteDataToDisk(file, (char*)&has_label, sizeof(has_label));
     // Write pos
     WriteDataToDisk(file, (char*)&pos, sizeof(pos));
-    Close(file);
+    // Write statistics
+    uint64 magic = kStatsMagic;
+    WriteDataToDisk(file, (char*)&magic, sizeof(magic));
+    WriteDataToDisk(file, (char*)&max_feat, sizeof(max_feat));
+    WriteDataToDisk(file, (char*)&max_field, sizeof(max_field));
+    WriteDataToDisk(file, (char*)&nnz, sizeof(nnz));
   }
 
   // Deserialize the DMatrix from disk file.
@@ -372,6 +540,20 @@ struct DMatrix {
     // Read hash_value
     ReadDataFromDisk(file, (char*)&hash_value_1, sizeof(hash_value_1));
     ReadDataFromDisk(file, (char*)&hash_value_2, sizeof(hash_value_2));
+    Deserialize(file);
+    Close(file);
+  }
+
+  // Deserialize the DMatrix (without the hash value) from the
+  // current position of file. The file is not closed, and the
+  // hash value of this matrix is not changed.
+  void Deserialize(FILE* file) {
+    CHECK_NOTNULL(file);
+    uint64 hash_1 = hash_value_1;
+    uint64 hash_2 = hash_value_2;
+    this->Reset();
+    hash_value_1 = hash_1;
+    hash_value_2 = hash_2;
     // Read row_length
     ReadDataFromDisk(file, (char*)&row_length, sizeof(row_length));
     CHECK_GE(row_length, 0);
@@ -389,7 +571,17 @@ struct DMatrix {
     ReadDataFromDisk(file, (char*)&has_label, sizeof(has_label));
     // Read pos
     ReadDataFromDisk(file, (char*)&pos, sizeof(pos));
-    Close(file);
+    // Read statistics. The binary file generated by the old 
+    // version does not have them, and we need to scan the data.
+    uint64 magic = 0;
+    if (ReadDataFromDisk(file, (char*)&magic, sizeof(magic)) 
+          == sizeof(magic) && magic == kStatsMagic) {
+      ReadDataFromDisk(file, (char*)&max_feat, sizeof(max_feat));
+      ReadDataFromDisk(file, (char*)&max_field, sizeof(max_field));
+      ReadDataFromDisk(file, (char*)&nnz, sizeof(nnz));
+    } else {
+      this->UpdateStats();
+    }
   }
 
   // We get find the max index of feature or field in current
@@ -434,8 +626,23 @@ struct DMatrix {
   bool has_label;
   /* Current position for GetMiniBatch() */
   index_t pos;
+  /* SparseRow released by Recycle() and waiting for reuse */
+  std::vector<SparseRow*> free_row;
+  /* Decaying high-water mark of row_length, which bounds 
+  the size of free_row */
+  index_t row_high_water;
+  /* Max feature id, max field id, and number of nodes.
+  These statistics are maintained by AddNode(), so the 
+  parser can get them without another pass of the data */
+  index_t max_feat;
+  index_t max_field;
+  uint64 nnz;
 };
 
+// Sort the ids by radix sort and remove the duplicate 
+// ids. This function is used by DMatrix::Compress().
+void RadixSortUnique(std::vector<index_t>& ids);
+
 }  // namespace xLearn
 
 #endif  // XLEARN_DATA_DATA_STRUCTURE_H_
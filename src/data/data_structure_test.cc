@@ -21,6 +21,7 @@ This file tests data_structure.h file.
 #include "gtest/gtest.h"
 
 #include "src/data/data_structure.h"
+#include "src/base/thread_pool.h"
 
 namespace xLearn {
 
@@ -113,6 +114,9 @@ TEST(DMATRIX_TEST, Serialize_and_Deserialize) {
   EXPECT_EQ(matrix.hash_value_1, 1234);
   EXPECT_EQ(matrix.hash_value_2, 5678);
   EXPECT_EQ(matrix.has_label, true);
+  EXPECT_EQ(matrix.max_feat, kLength-1);
+  EXPECT_EQ(matrix.max_field, kLength-1);
+  EXPECT_EQ(matrix.nnz, kLength);
   for (size_t i = 0; i < kLength; ++i) {
     EXPECT_EQ(matrix.Y[i], i);
     EXPECT_EQ(matrix.norm[i], 0.25);
@@ -131,6 +135,82 @@ TEST(DMATRIX_TEST, Serialize_and_Deserialize) {
 #endif
 }
 
+TEST(DMATRIX_TEST, Statistics) {
+  DMatrix matrix;
+  for (size_t i = 0; i < kLength; ++i) {
+    matrix.AddRow();
+    matrix.AddNode(i, i * 2, 1.0, i % 7);
+    matrix.AddNode(i, i, 1.0, 3);
+  }
+  EXPECT_EQ(matrix.max_feat, (kLength-1) * 2);
+  EXPECT_EQ(matrix.max_field, 6);
+  EXPECT_EQ(matrix.nnz, kLength * 2);
+  EXPECT_EQ(matrix.max_feat, matrix.MaxFeat());
+  EXPECT_EQ(matrix.max_field, matrix.MaxField());
+#ifndef _MSC_VER
+  // The binary file of the old version has no statistics
+  matrix.Serialize("/tmp/test.bin");
+  FILE* file = OpenFileOrDie("/tmp/test.bin", "r");
+  uint64 size = GetFileSize(file);
+  Close(file);
+  size -= sizeof(uint64) * 2 + sizeof(index_t) * 2;
+  EXPECT_EQ(truncate("/tmp/test.bin", size), 0);
+  DMatrix new_matrix;
+  new_matrix.Deserialize("/tmp/test.bin");
+  EXPECT_EQ(new_matrix.max_feat, (kLength-1) * 2);
+  EXPECT_EQ(new_matrix.max_field, 6);
+  EXPECT_EQ(new_matrix.nnz, kLength * 2);
+  RemoveFile("/tmp/test.bin");
+#endif
+  matrix.Recycle();
+  EXPECT_EQ(matrix.max_feat, 0);
+  EXPECT_EQ(matrix.max_field, 0);
+  EXPECT_EQ(matrix.nnz, 0);
+}
+
+TEST(DMATRIX_TEST, Recycle) {
+  DMatrix matrix;
+  matrix.Reset();
+  for (size_t i = 0; i < kLength; ++i) {
+    matrix.AddRow();
+    matrix.AddNode(i, i, 2.5, i);
+    matrix.AddNode(i, i, 2.5, i);
+  }
+  std::vector<SparseRow*> old_row = matrix.row;
+  matrix.Recycle();
+  EXPECT_EQ(matrix.row_length, 0);
+  EXPECT_EQ(matrix.row.empty(), true);
+  EXPECT_EQ(matrix.Y.empty(), true);
+  EXPECT_EQ(matrix.norm.empty(), true);
+  EXPECT_EQ(matrix.free_row.size(), kLength);
+  // The new rows reuse the old memory
+  for (size_t i = 0; i < kLength; ++i) {
+    matrix.AddRow();
+    matrix.AddNode(i, i+1, 0.5, i+1);
+  }
+  EXPECT_EQ(matrix.free_row.empty(), true);
+  for (size_t i = 0; i < kLength; ++i) {
+    SparseRow* row = matrix.row[i];
+    EXPECT_NE(std::find(old_row.begin(), old_row.end(), row), 
+              old_row.end());
+    EXPECT_EQ(row->size(), 1);
+    EXPECT_GE(row->capacity(), 2);
+    EXPECT_EQ((*row)[0].feat_id, i+1);
+    EXPECT_EQ((*row)[0].field_id, i+1);
+    EXPECT_FLOAT_EQ((*row)[0].feat_val, 0.5);
+  }
+  // High-water-mark trim for smaller blocks
+  matrix.Recycle();
+  matrix.AddRow();
+  matrix.AddNode(0, 0, 1.0);
+  matrix.Recycle();
+  EXPECT_EQ(matrix.row_high_water, kLength / 2);
+  EXPECT_EQ(matrix.free_row.size(), kLength / 2);
+  matrix.Reset();
+  EXPECT_EQ(matrix.free_row.empty(), true);
+  EXPECT_EQ(matrix.row_high_water, 0);
+}
+
 TEST(DMATRIX_TEST, Find_Max_Feat_and_Field) {
   DMatrix matrix;
   matrix.Reset();
@@ -240,6 +320,58 @@ TEST(DMATRIX_TEST, Compress) {
   EXPECT_EQ(feature_list[10], 20);
 }
 
+TEST(DMATRIX_TEST, RadixSortUnique) {
+  std::vector<index_t> ids;
+  for (index_t i = 0; i < 10000; ++i) {
+    ids.push_back((i * 2654435761u) % 3000 + (i % 7) * 65536 * 256);
+  }
+  std::vector<index_t> expect = ids;
+  std::sort(expect.begin(), expect.end());
+  expect.erase(std::unique(expect.begin(), expect.end()), expect.end());
+  RadixSortUnique(ids);
+  EXPECT_EQ(ids, expect);
+}
+
+void check_compress(index_t max_feat, size_t thread_num) {
+  // Init two same matrix
+  DMatrix matrix_1, matrix_2;
+  for (index_t i = 0; i < 1000; ++i) {
+    matrix_1.AddRow();
+    matrix_2.AddRow();
+    if (i % 100 == 0) { continue; }  // empty row
+    for (index_t j = 0; j < 10; ++j) {
+      index_t feat = (i * 131 + j * 977) % max_feat + 7;
+      matrix_1.AddNode(i, feat, 0.1);
+      matrix_2.AddNode(i, feat, 0.1);
+    }
+  }
+  // Single-thread and multi-thread
+  std::vector<index_t> list_1, list_2;
+  matrix_1.Compress(list_1);
+  ThreadPool pool(thread_num);
+  matrix_2.Compress(list_2, &pool);
+  EXPECT_EQ(list_1, list_2);
+  for (index_t i = 0; i < 1000; ++i) {
+    if (i % 100 == 0) {
+      EXPECT_TRUE(matrix_2.row[i] == nullptr);
+      continue;
+    }
+    for (index_t j = 0; j < 10; ++j) {
+      index_t feat = (i * 131 + j * 977) % max_feat + 7;
+      EXPECT_EQ((*matrix_1.row[i])[j].feat_id,
+                (*matrix_2.row[i])[j].feat_id);
+      EXPECT_EQ(list_2[(*matrix_2.row[i])[j].feat_id - 1], feat);
+    }
+  }
+}
+
+TEST(DMATRIX_TEST, Compress_multi_thread) {
+  // Dense rank table
+  check_compress(500, 4);
+  // Binary search
+  check_compress(100000000, 3);
+}
+
 TEST(DMATRIX_TEST, GetMiniBatch) {
   // Init matrix
   DMatrix matrix;
@@ -0,0 +1,163 @@
+//------------------------------------------------------------------------------
+// Copyright (c) 2018 by contributors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//------------------------------------------------------------------------------
+
+/*
+This file is the implementation of feature_id_map.h
+*/
+
+#include "src/data/feature_id_map.h"
+
+#include <algorithm>
+#include <functional>
+#include <iterator>
+
+#include "src/base/logging.h"
+
+namespace xLearn {
+
+const index_t FeatureIdMap::kNotFound;
+
+// The pending ids are merged when there are more of them than
+// this number, so that the memory of collecting is bounded.
+static const size_t kMaxPendingIds = 16 * 1024 * 1024;
+
+// Add the feature ids of the matrix to the pending list.
+void FeatureIdMap::Collect(const DMatrix& matrix) {
+  for (index_t i = 0; i < matrix.row_length; ++i) {
+    const SparseRow* row = matrix.row[i];
+    if (row == nullptr) { continue; }
+    for (SparseRow::const_iterator iter = row->begin();
+         iter != row->end(); ++iter) {
+      pending_.push_back(iter->feat_id);
+    }
+  }
+  if (pending_.size() > std::max(kMaxPendingIds, feature_list_.size())) {
+    merge_pending();
+  }
+}
+
+// Sort the pending ids, and merge them into feature_list_.
+void FeatureIdMap::merge_pending() {
+  if (pending_.empty()) { return; }
+  RadixSortUnique(pending_);
+  std::vector<index_t> tmp;
+  tmp.reserve(feature_list_.size() + pending_.size());
+  std::set_union(feature_list_.begin(), feature_list_.end(),
+                 pending_.begin(), pending_.end(),
+                 std::back_inserter(tmp));
+  feature_list_.swap(tmp);
+  std::vector<index_t>().swap(pending_);
+}
+
+// Merge the collected ids and build the rank table.
+void FeatureIdMap::Build() {
+  merge_pending();
+  rank_.clear();
+  base_ = 0;
+  if (feature_list_.empty()) { return; }
+  // Use a dense rank table if the id range is narrow
+  base_ = feature_list_.front();
+  uint64 span = (uint64)feature_list_.back() - base_ + 1;
+  if (span <= 4 * (uint64)feature_list_.size()) {
+    rank_.resize(span, 0);
+    for (index_t i = 0; i < feature_list_.size(); ++i) {
+      rank_[feature_list_[i] - base_] = i + 1;
+    }
+  }
+}
+
+// Use the given sorted and unique feature ids.
+void FeatureIdMap::Build(const std::vector<index_t>& feature_list) {
+  for (size_t i = 1; i < feature_list.size(); ++i) {
+    CHECK_LT(feature_list[i-1], feature_list[i]);
+  }
+  feature_list_ = feature_list;
+  pending_.clear();
+  Build();
+}
+
+// Return the new id of feat_id, or kNotFound.
+index_t FeatureIdMap::Find(index_t feat_id) const {
+  if (feature_list_.empty() || feat_id < feature_list_.front() ||
+      feat_id > feature_list_.back()) {
+    return kNotFound;
+  }
+  if (!rank_.empty()) {
+    index_t rank = rank_[feat_id - base_];
+    return rank == 0 ? kNotFound : rank - 1;
+  }
+  std::vector<index_t>::const_iterator iter =
+    std::lower_bound(feature_list_.begin(), feature_list_.end(), feat_id);
+  if (*iter != feat_id) { return kNotFound; }
+  return iter - feature_list_.begin();
+}
+
+// Rewrite the rows [start, end) of the matrix, and
+// remove the features that are not in the map.
+void FeatureIdMap::remap_rows(DMatrix* matrix, size_t start, size_t end,
+                              uint64* dropped) const {
+  CHECK_GE(end, start);
+  uint64 count = 0;
+  for (size_t i = start; i < end; ++i) {
+    SparseRow* row = matrix->row[i];
+    if (row == nullptr) { continue; }
+    SparseRow::iterator out = row->begin();
+    for (SparseRow::iterator iter = row->begin();
+         iter != row->end(); ++iter) {
+      index_t id = Find(iter->feat_id);
+      if (id == kNotFound) { continue; }
+      *out = *iter;
+      out->feat_id = id;
+      ++out;
+    }
+    count += row->end() - out;
+    row->erase(out, row->end());
+  }
+  *dropped = count;
+}
+
+// Rewrite the feature ids of the matrix to the new ids.
+uint64 FeatureIdMap::Remap(DMatrix& matrix, ThreadPool* pool) const {
+  size_t threadNumber = pool == nullptr ? 1 : pool->ThreadNumber();
+  std::vector<uint64> dropped(threadNumber, 0);
+  if (threadNumber == 1) {
+    remap_rows(&matrix, 0, matrix.row_length, &dropped[0]);
+  } else {
+    for (size_t i = 0; i < threadNumber; ++i) {
+      size_t start_idx = getStart(matrix.row_length, threadNumber, i);
+      size_t end_idx = getEnd(matrix.row_length, threadNumber, i);
+      pool->enqueue(std::bind(&FeatureIdMap::remap_rows, this, &matrix,
+                              start_idx, end_idx, &dropped[i]));
+    }
+    pool->Sync(threadNumber);
+  }
+  matrix.UpdateStats();
+  uint64 total = 0;
+  for (size_t i = 0; i < threadNumber; ++i) {
+    total += dropped[i];
+  }
+  return total;
+}
+
+// Remove all the features.
+void FeatureIdMap::Clear() {
+  std::vector<index_t>().swap(feature_list_);
+  std::vector<index_t>().swap(pending_);
+  std::vector<index_t>().swap(rank_);
+  base_ = 0;
+}
+
+}  // namespace xLearn
@@ -0,0 +1,123 @@
+//------------------------------------------------------------------------------
+// Copyright (c) 2018 by contributors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//------------------------------------------------------------------------------
+
+/*
+This file defines the FeatureIdMap class, which maps the sparse
+feature ids of the data to a dense range.
+*/
+
+#ifndef XLEARN_DATA_FEATURE_ID_MAP_H_
+#define XLEARN_DATA_FEATURE_ID_MAP_H_
+
+#include <vector>
+
+#include "src/base/common.h"
+#include "src/base/thread_pool.h"
+#include "src/data/data_structure.h"
+
+namespace xLearn {
+
+//------------------------------------------------------------------------------
+// The model has a parameter for each feature id in [0, max_feat], so
+// sparse ids (e.g., hashed ids) waste most of the model. FeatureIdMap
+// maps the feature ids that are used in the training data to the
+// dense range [0, Size()), in the same way as DMatrix::Compress().
+// The used ids are collected block by block, since the training data
+// may not fit in memory, and then they are kept in a sorted list,
+// which is saved in the model file. The new id of a feature is its
+// position in the list, which is found by a dense rank table (for a
+// narrow id range) or by binary search. The features that are not in
+// the list are dropped, e.g., the new features of the test data.
+// For example:
+//
+//   FeatureIdMap id_map;
+//   while (reader->Samples(matrix)) {
+//     id_map.Collect(*matrix);
+//   }
+//   id_map.Build();
+//   /* The model has id_map.Size() features */
+//
+//   reader->Reset();
+//   while (reader->Samples(matrix)) {
+//     id_map.Remap(*matrix);
+//   }
+//------------------------------------------------------------------------------
+class FeatureIdMap {
+ public:
+  // Constructor and Destructor
+  FeatureIdMap() : base_(0) { }
+  ~FeatureIdMap() { }
+
+  // Add the feature ids of the matrix to the map.
+  // Build() must be called after all the data is collected.
+  void Collect(const DMatrix& matrix);
+
+  // Merge the collected ids and build the rank table.
+  void Build();
+
+  // Use the given sorted and unique feature ids,
+  // e.g., the ids that are saved in the model.
+  void Build(const std::vector<index_t>& feature_list);
+
+  // Rewrite the feature ids of the matrix to the new ids, and drop
+  // the features that are not in the map. The statistics of the
+  // matrix are updated. If pool is nullptr, Remap() runs in current
+  // thread. Return the number of dropped features.
+  uint64 Remap(DMatrix& matrix, ThreadPool* pool = nullptr) const;
+
+  // Return the new id of feat_id, or kNotFound.
+  index_t Find(index_t feat_id) const;
+
+  // Number of features in the map.
+  inline index_t Size() const { return feature_list_.size(); }
+  inline bool Empty() const { return feature_list_.empty(); }
+
+  // The used feature ids in ascending order. The new
+  // id of feature_list[i] is i.
+  inline const std::vector<index_t>& FeatureList() const {
+    return feature_list_;
+  }
+
+  // Remove all the features.
+  void Clear();
+
+  // The return value of Find() if the id is not in the map.
+  static const index_t kNotFound = 0xFFFFFFFF;
+
+ protected:
+  /* Sorted and unique feature ids */
+  std::vector<index_t> feature_list_;
+  /* Collected ids that are not merged yet */
+  std::vector<index_t> pending_;
+  /* rank_[feat_id - base_] = new id + 1, or 0 if the
+  id is not in the map. It is empty for a wide id range */
+  std::vector<index_t> rank_;
+  index_t base_;
+
+  // Merge the pending ids into feature_list_.
+  void merge_pending();
+
+  // Rewrite the rows [start, end) of the matrix.
+  void remap_rows(DMatrix* matrix, size_t start, size_t end,
+                  uint64* dropped) const;
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(FeatureIdMap);
+};
+
+}  // namespace xLearn
+
+#endif  // XLEARN_DATA_FEATURE_ID_MAP_H_
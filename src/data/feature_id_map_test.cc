@@ -0,0 +1,101 @@
+//------------------------------------------------------------------------------
+// Copyright (c) 2018 by contributors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//------------------------------------------------------------------------------
+
+/*
+This file tests feature_id_map.h file.
+*/
+
+#include "gtest/gtest.h"
+
+#include <vector>
+
+#include "src/data/feature_id_map.h"
+
+namespace xLearn {
+
+const index_t kRowNum = 1000;
+
+// Row i has the features i * step and i * step + 1.
+void init_matrix(DMatrix& matrix, index_t step) {
+  matrix.ReAlloc(kRowNum);
+  for (index_t i = 0; i < kRowNum; ++i) {
+    matrix.AddNode(i, i * step, 1.0, i % 3);
+    matrix.AddNode(i, i * step + 1, 2.0, i % 3);
+  }
+}
+
+void check_remap(index_t step, ThreadPool* pool) {
+  DMatrix matrix;
+  init_matrix(matrix, step);
+  FeatureIdMap id_map;
+  // Collect the ids in two parts
+  id_map.Collect(matrix);
+  id_map.Collect(matrix);
+  id_map.Build();
+  ASSERT_EQ(id_map.Size(), kRowNum * 2);
+  EXPECT_EQ(id_map.FeatureList()[1], 1);
+  EXPECT_EQ(id_map.FeatureList()[2], step);
+  EXPECT_EQ(id_map.Remap(matrix, pool), 0);
+  EXPECT_EQ(matrix.max_feat, kRowNum * 2 - 1);
+  EXPECT_EQ(matrix.nnz, kRowNum * 2);
+  for (index_t i = 0; i < kRowNum; ++i) {
+    ASSERT_EQ(matrix.row[i]->size(), 2);
+    EXPECT_EQ((*matrix.row[i])[0].feat_id, i * 2);
+    EXPECT_EQ((*matrix.row[i])[1].feat_id, i * 2 + 1);
+    EXPECT_EQ((*matrix.row[i])[1].field_id, i % 3);
+    EXPECT_FLOAT_EQ((*matrix.row[i])[1].feat_val, 2.0);
+  }
+}
+
+TEST(FEATURE_ID_MAP_TEST, Remap) {
+  // Narrow id range (rank table)
+  check_remap(2, nullptr);
+  // Wide id range (binary search)
+  check_remap(1000000, nullptr);
+  ThreadPool pool(3);
+  check_remap(2, &pool);
+  check_remap(1000000, &pool);
+}
+
+TEST(FEATURE_ID_MAP_TEST, DropUnseen) {
+  FeatureIdMap id_map;
+  std::vector<index_t> feature_list = {5, 9, 100};
+  id_map.Build(feature_list);
+  EXPECT_EQ(id_map.Find(5), 0);
+  EXPECT_EQ(id_map.Find(9), 1);
+  EXPECT_EQ(id_map.Find(100), 2);
+  EXPECT_EQ(id_map.Find(0), FeatureIdMap::kNotFound);
+  EXPECT_EQ(id_map.Find(6), FeatureIdMap::kNotFound);
+  EXPECT_EQ(id_map.Find(101), FeatureIdMap::kNotFound);
+  DMatrix matrix;
+  matrix.ReAlloc(3);
+  matrix.AddNode(0, 9, 1.0);
+  matrix.AddNode(0, 7, 1.0);
+  matrix.AddNode(0, 100, 1.0);
+  matrix.AddNode(1, 1, 1.0);
+  EXPECT_EQ(id_map.Remap(matrix), 2);
+  ASSERT_EQ(matrix.row[0]->size(), 2);
+  EXPECT_EQ((*matrix.row[0])[0].feat_id, 1);
+  EXPECT_EQ((*matrix.row[0])[1].feat_id, 2);
+  EXPECT_EQ(matrix.row[1]->size(), 0);
+  EXPECT_TRUE(matrix.row[2] == nullptr);
+  EXPECT_EQ(matrix.nnz, 2);
+  EXPECT_EQ(matrix.max_feat, 2);
+  id_map.Clear();
+  EXPECT_TRUE(id_map.Empty());
+}
+
+}  // namespace xLearn
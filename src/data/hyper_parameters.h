@@ -83,13 +83,19 @@ struct HyperParam {
   bool norm = true;
   /* Using lock-free AdaGard to accelerate training */
   bool lock_free = true;
+  /* Pages of the model parameters: "none", "thp" 
+  (transparent huge pages), "2m", or "1g" (hugetlb) */
+  std::string huge_page = "none";
+  /* Interleave the model across the NUMA nodes,
+  and pin the worker threads to the nodes */
+  bool numa = false;
 //------------------------------------------------------------------------------
 // Parameters for dataset
 //------------------------------------------------------------------------------
   /* Number of feature */
   index_t num_feature = 0;
   /* Number of total model parameters */
-  index_t num_param = 0;
+  param_index_t num_param = 0;
   /* Number of latent factor for fm and ffm */
   index_t num_K = 4;
   /* Number of field, used by ffm tasks */
@@ -129,10 +135,46 @@ struct HyperParam {
 #endif
   /* Block size for on-disk training */
   int block_size = 500;  // 500 MB
+  /* Number of blocks prefetched in background
+  for on-disk training and prediction */
+  int prefetch = 1;
+  /* Memory budget (MB) for the blocks that are kept
+  in memory for on-disk training */
+  int mem_budget = 0;
   /* If generate bin file */
   bool bin_out = true;
+  /* Hash the whole text file to verify the bin file */
+  bool verify_bin = false;
+  /* Store the bin file in compressed format */
+  bool bin_compress = false;
+  /* Store in-memory data in compressed format */
+  bool compress = false;
+  /* Store feature value in bfloat16 if compress is true */
+  bool quantize = false;
+  /* Map the used feature ids to a dense range */
+  bool remap_feature = false;
   /* Random seed to shuffle data set */
   int seed = 1;
+  /* Chunk size (number of rows) for chunked shuffle.
+  0 means global shuffle */
+  int shuffle_chunk = 0;
+  /* Shuffle the order of blocks for on-disk training */
+  bool disk_shuffle = false;
+  /* Size (number of rows) of the shuffle buffer
+  across blocks for on-disk training */
+  int shuffle_window = 0;
+  /* Number of files that are read at the same time
+  when the input is a list of files */
+  int reader_threads = 1;
+  /* Visit the files in a random order in each epoch */
+  bool shuffle_files = false;
+  /* Declared format of the data: "libsvm", "libffm",
+  or "csv". Detected from the first line if it is empty,
+  and it must be declared for a stream (e.g., stdin) */
+  std::string data_format;
+  /* File of the field id of each column of csv data.
+  All the columns are in field 0 if it is empty */
+  std::string field_map_file;
   /* from file or not? */
   bool from_file = true;
   /* If generate prediction file */
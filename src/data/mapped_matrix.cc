@@ -0,0 +1,366 @@
+//------------------------------------------------------------------------------
+// Copyright (c) 2018 by contributors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//------------------------------------------------------------------------------
+
+/*
+This file is the implementation of mapped_matrix.h
+*/
+
+#include "src/data/mapped_matrix.h"
+
+#include <stdio.h>
+#include <string.h>
+#ifndef _MSC_VER
+#include <unistd.h>
+#else
+#include "src/base/unistd.h"
+#endif
+
+#include <algorithm>
+#include <functional>
+#include <vector>
+
+#include "src/base/file_util.h"
+#include "src/base/stringprintf.h"
+
+namespace xLearn {
+
+// The nodes are used in place, so their size must not change.
+static_assert(sizeof(Node) == 12, "Node must be 12 bytes");
+
+// Alignment of the sections in the binary file.
+static const uint64 kSectionAlign = 64;
+
+// Size of the magic number, the version and the signature.
+static const uint64 kPrefixSize = sizeof(uint64) + sizeof(uint32) +
+                                  5 * sizeof(uint64);
+
+// Flags of the layout
+static const uint32 kCompressedNode = 1;  /* nodes are compressed */
+static const uint32 kQuantizedNode = 2;   /* values are bfloat16 */
+
+// Statistics and offsets of the sections, which
+// follow the signature in the binary file.
+struct Layout {
+  uint64 row_length;
+  uint64 nnz;
+  uint32 max_feat;
+  uint32 max_field;
+  uint32 has_label;
+  uint32 flags;
+  uint64 y_offset;
+  uint64 norm_offset;
+  uint64 row_offset;
+  uint64 node_offset;
+  uint64 file_size;
+};
+
+static inline uint64 align_section(uint64 pos) {
+  return (pos + kSectionAlign - 1) / kSectionAlign * kSectionAlign;
+}
+
+// Write len bytes to file, and move the file position cur.
+static void write_data(FILE* file, uint64* cur,
+                       const char* buf, uint64 len) {
+  if (len == 0) { return; }
+  WriteDataToDisk(file, buf, len);
+  *cur += len;
+}
+
+// Write zeros until the file position reaches pos.
+static void write_padding(FILE* file, uint64* cur, uint64 pos) {
+  static const char kZero[kSectionAlign] = { 0 };
+  CHECK_LE(*cur, pos);
+  write_data(file, cur, kZero, pos - *cur);
+}
+
+// Write the binary file. The statistics and the flags are given in
+// layout, and the section offsets are filled here. The node section
+// (node_size bytes) is written by write_node. The data is written 
+// to a temporary file, which is then renamed to the binary file.
+// Hence, the processes that have mapped the old binary file are 
+// not affected.
+static void write_file(const std::string& filename,
+                       const FileSignature& signature,
+                       Layout& layout,
+                       const real_t* Y,
+                       const real_t* norm,
+                       const std::vector<uint64>& offset,
+                       uint64 node_size,
+                       const std::function<void(FILE*, uint64*)>& write_node) {
+  uint64 row_length = layout.row_length;
+  CHECK_EQ(offset.size(), row_length + 1);
+  layout.y_offset = align_section(kPrefixSize + sizeof(layout));
+  layout.norm_offset = align_section(layout.y_offset +
+                                     row_length * sizeof(real_t));
+  layout.row_offset = align_section(layout.norm_offset +
+                                    row_length * sizeof(real_t));
+  layout.node_offset = align_section(layout.row_offset +
+                                     (row_length + 1) * sizeof(uint64));
+  layout.file_size = layout.node_offset + node_size;
+  // Header
+  std::string tmp_file = StringPrintf("%s.%u.bin", filename.c_str(),
+                                      (uint32)getpid());
+  FILE* file = OpenFileOrDie(tmp_file.c_str(), "wb");
+  uint64 magic = kBinMagic;
+  uint32 version = kBinVersion;
+  WriteDataToDisk(file, (char*)&magic, sizeof(magic));
+  WriteDataToDisk(file, (char*)&version, sizeof(version));
+  signature.Write(file);
+  WriteDataToDisk(file, (char*)&layout, sizeof(layout));
+  uint64 cur = kPrefixSize + sizeof(layout);
+  // Y and norm
+  write_padding(file, &cur, layout.y_offset);
+  write_data(file, &cur, (char*)Y, row_length * sizeof(real_t));
+  write_padding(file, &cur, layout.norm_offset);
+  write_data(file, &cur, (char*)norm, row_length * sizeof(real_t));
+  // Row offsets
+  write_padding(file, &cur, layout.row_offset);
+  write_data(file, &cur, (char*)offset.data(),
+             offset.size() * sizeof(uint64));
+  // Nodes
+  write_padding(file, &cur, layout.node_offset);
+  write_node(file, &cur);
+  CHECK_EQ(cur, layout.file_size);
+  Close(file);
+#ifdef _MSC_VER
+  remove(filename.c_str());
+#endif
+  if (rename(tmp_file.c_str(), filename.c_str()) != 0) {
+    remove(tmp_file.c_str());
+    LOG(FATAL) << "Cannot write the binary file: " << filename;
+  }
+}
+
+// Write the matrix to a binary file, which starts with
+// the magic number, the version, and the given signature.
+void MappedMatrix::Write(const std::string& filename,
+                         const DMatrix& matrix,
+                         const FileSignature& signature) {
+  Layout layout;
+  memset(&layout, 0, sizeof(layout));
+  layout.row_length = matrix.row_length;
+  layout.has_label = matrix.has_label;
+  std::vector<uint64> offset(matrix.row_length + 1, 0);
+  for (index_t i = 0; i < matrix.row_length; ++i) {
+    const SparseRow* row = matrix.row[i];
+    offset[i+1] = offset[i];
+    if (row == nullptr) { continue; }
+    offset[i+1] += row->size();
+    for (SparseRow::const_iterator iter = row->begin();
+         iter != row->end(); ++iter) {
+      layout.max_feat = std::max(layout.max_feat, iter->feat_id);
+      layout.max_field = std::max(layout.max_field, iter->field_id);
+    }
+  }
+  layout.nnz = offset.back();
+  write_file(filename, signature, layout, matrix.Y.data(),
+             matrix.norm.data(), offset, layout.nnz * sizeof(Node),
+    [&matrix](FILE* file, uint64* cur) {
+      for (index_t i = 0; i < matrix.row_length; ++i) {
+        const SparseRow* row = matrix.row[i];
+        if (row == nullptr) { continue; }
+        write_data(file, cur, (char*)row->data(), 
+                   row->size() * sizeof(Node));
+      }
+    });
+}
+
+// Write the compressed matrix to a binary file.
+void MappedMatrix::Write(const std::string& filename,
+                         const CompressedMatrix& cmat,
+                         const FileSignature& signature) {
+  Layout layout;
+  memset(&layout, 0, sizeof(layout));
+  layout.row_length = cmat.row_length;
+  layout.has_label = cmat.has_label;
+  layout.nnz = cmat.nnz;
+  layout.max_feat = cmat.max_feat;
+  layout.max_field = cmat.max_field;
+  layout.flags = kCompressedNode;
+  if (cmat.IsQuantized()) { layout.flags |= kQuantizedNode; }
+  const std::vector<uint8>& buf = cmat.Buffer();
+  write_file(filename, signature, layout, cmat.Y.data(),
+             cmat.norm.data(), cmat.Offset(), buf.size(),
+    [&buf](FILE* file, uint64* cur) {
+      write_data(file, cur, (char*)buf.data(), buf.size());
+    });
+}
+
+// Write the rows of the mapped matrix followed by the rows of tail.
+void MappedMatrix::Append(const std::string& filename,
+                          const MappedMatrix& head,
+                          const DMatrix& tail,
+                          const FileSignature& signature) {
+  CHECK(head.IsOpen());
+  index_t head_length = head.row_length;
+  Layout layout;
+  memset(&layout, 0, sizeof(layout));
+  layout.row_length = head_length + tail.row_length;
+  layout.has_label = head.has_label;
+  layout.nnz = head.nnz;
+  layout.max_feat = head.max_feat;
+  layout.max_field = head.max_field;
+  std::vector<real_t> Y(head.Y_, head.Y_ + head_length);
+  std::vector<real_t> norm(head.norm_, head.norm_ + head_length);
+  Y.insert(Y.end(), tail.Y.begin(), tail.Y.begin() + tail.row_length);
+  norm.insert(norm.end(), tail.norm.begin(),
+              tail.norm.begin() + tail.row_length);
+  std::vector<uint64> offset(head.offset_, head.offset_ + head_length + 1);
+  uint64 head_size = head.compressed_ ? offset.back() :
+                                        offset.back() * sizeof(Node);
+  // The offsets of tail follow the last offset of head.
+  CompressedMatrix cmat;
+  if (head.compressed_) {
+    layout.flags = kCompressedNode;
+    if (head.quantized_) { layout.flags |= kQuantizedNode; }
+    cmat.SetQuantize(head.quantized_);
+    cmat.Append(tail);
+    const std::vector<uint64>& tail_offset = cmat.Offset();
+    for (index_t i = 1; i <= tail.row_length; ++i) {
+      offset.push_back(offset[head_length] + tail_offset[i]);
+    }
+  }
+  for (index_t i = 0; i < tail.row_length; ++i) {
+    const SparseRow* row = tail.row[i];
+    size_t size = row == nullptr ? 0 : row->size();
+    layout.nnz += size;
+    if (!head.compressed_) { offset.push_back(offset.back() + size); }
+    for (size_t j = 0; j < size; ++j) {
+      layout.max_feat = std::max(layout.max_feat, (*row)[j].feat_id);
+      layout.max_field = std::max(layout.max_field, (*row)[j].field_id);
+    }
+  }
+  uint64 tail_size = head.compressed_ ? cmat.Buffer().size() :
+    (offset.back() - offset[head_length]) * sizeof(Node);
+  write_file(filename, signature, layout, Y.data(), norm.data(),
+             offset, head_size + tail_size,
+    [&](FILE* file, uint64* cur) {
+      write_data(file, cur, (const char*)head.data_, head_size);
+      if (head.compressed_) {
+        write_data(file, cur, (const char*)cmat.Buffer().data(),
+                   tail_size);
+        return;
+      }
+      for (index_t i = 0; i < tail.row_length; ++i) {
+        const SparseRow* row = tail.row[i];
+        if (row == nullptr) { continue; }
+        write_data(file, cur, (char*)row->data(),
+                   row->size() * sizeof(Node));
+      }
+    });
+}
+
+// Map the binary file and check its header.
+bool MappedMatrix::Open(const std::string& filename) {
+  Close();
+  if (!file_.Open(filename)) { return false; }
+  const char* data = file_.Data();
+  uint64 magic = 0;
+  uint32 version = 0;
+  Layout layout;
+  if (file_.Size() < kPrefixSize + sizeof(layout)) {
+    Close();
+    return false;
+  }
+  memcpy(&magic, data, sizeof(magic));
+  memcpy(&version, data + sizeof(magic), sizeof(version));
+  memcpy(&layout, data + kPrefixSize, sizeof(layout));
+  if (magic != kBinMagic || version != kBinVersion ||
+      layout.file_size != file_.Size() ||
+      layout.row_offset + (layout.row_length + 1) * sizeof(uint64) >
+      layout.node_offset) {
+    Close();
+    return false;
+  }
+  offset_ = reinterpret_cast<const uint64*>(data + layout.row_offset);
+  // Check the size of the node section
+  compressed_ = (layout.flags & kCompressedNode) != 0;
+  quantized_ = (layout.flags & kQuantizedNode) != 0;
+  uint64 node_size = compressed_ ? offset_[layout.row_length] : 
+                                   layout.nnz * sizeof(Node);
+  if (layout.node_offset + node_size != layout.file_size) {
+    Close();
+    return false;
+  }
+  row_length = layout.row_length;
+  has_label = layout.has_label != 0;
+  nnz = layout.nnz;
+  max_feat = layout.max_feat;
+  max_field = layout.max_field;
+  Y_ = reinterpret_cast<const real_t*>(data + layout.y_offset);
+  norm_ = reinterpret_cast<const real_t*>(data + layout.norm_offset);
+  node_ = reinterpret_cast<const Node*>(data + layout.node_offset);
+  data_ = reinterpret_cast<const uint8*>(data + layout.node_offset);
+  return true;
+}
+
+// Unmap the file.
+void MappedMatrix::Close() {
+  file_.Close();
+  row_length = 0;
+  has_label = true;
+  nnz = 0;
+  max_feat = 0;
+  max_field = 0;
+  compressed_ = false;
+  quantized_ = false;
+  Y_ = nullptr;
+  norm_ = nullptr;
+  offset_ = nullptr;
+  node_ = nullptr;
+  data_ = nullptr;
+}
+
+// Number of nodes of the id-th row.
+size_t MappedMatrix::RowSize(index_t id) const {
+  if (compressed_) {
+    // Skip the flag of the encoded row
+    const uint8* ptr = data_ + offset_[id] + 1;
+    return GetVarint(ptr);
+  }
+  return offset_[id+1] - offset_[id];
+}
+
+// Copy (or decode) the id-th row to a Node array.
+size_t MappedMatrix::GetRow(index_t id, std::vector<Node>& nodes) const {
+  if (compressed_) {
+    return CompressedMatrix::DecodeNodes(data_ + offset_[id], nodes);
+  }
+  nodes.assign(RowBegin(id), RowEnd(id));
+  return nodes.size();
+}
+
+// Copy the id-th row and append it to the given matrix.
+void MappedMatrix::CopyRow(index_t id, DMatrix& matrix) const {
+  matrix.AddRow();
+  index_t i = matrix.row_length - 1;
+  matrix.Y[i] = Y_[id];
+  matrix.norm[i] = norm_[id];
+  if (RowSize(id) == 0) { return; }
+  // Get a (recycled) SparseRow from matrix
+  matrix.AddNode(i, 0, 0);
+  SparseRow& sr = *(matrix.row[i]);
+  size_t size = GetRow(id, sr);
+  // Update the statistics of matrix. Note that
+  // AddNode() has already counted the first node.
+  matrix.nnz += size - 1;
+  for (size_t j = 0; j < size; ++j) {
+    matrix.max_feat = std::max(matrix.max_feat, sr[j].feat_id);
+    matrix.max_field = std::max(matrix.max_field, sr[j].field_id);
+  }
+}
+
+}  // namespace xLearn
@@ -0,0 +1,186 @@
+//------------------------------------------------------------------------------
+// Copyright (c) 2018 by contributors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//------------------------------------------------------------------------------
+
+/*
+This file defines the MappedMatrix class, which reads the binary
+(.bin) file of a DMatrix in place by using mmap().
+*/
+
+#ifndef XLEARN_DATA_MAPPED_MATRIX_H_
+#define XLEARN_DATA_MAPPED_MATRIX_H_
+
+#include <string>
+#include <vector>
+
+#include "src/base/common.h"
+#include "src/base/file_signature.h"
+#include "src/base/mapped_file.h"
+#include "src/data/data_structure.h"
+#include "src/data/compressed_matrix.h"
+
+namespace xLearn {
+
+//------------------------------------------------------------------------------
+// MappedMatrix stores a DMatrix in a flat (CSR) binary file, which can
+// be mapped into memory and used without deserialization. The file is
+// laid out as follows (in native byte order):
+//
+//   [kBinMagic][kBinVersion][FileSignature][layout]
+//   [Y      : real_t * row_length]
+//   [norm   : real_t * row_length]
+//   [offset : uint64 * (row_length + 1)]
+//   [node   : Node * nnz]
+//
+// The layout records the statistics of the matrix and the offset of
+// each section, and every section starts at a 64-byte boundary. The
+// nodes of the i-th row are node[offset[i], offset[i+1]). Opening the
+// file only checks its header, and the pages are loaded by the OS on
+// demand. Since the file is mapped read-only, the processes that map
+// the same file share one copy of it in the page cache, as long as
+// they use it in place rather than copy it out.
+//
+// The node section can also be stored in the encoding of
+// CompressedMatrix, which is usually several times smaller. Then the
+// offsets are byte offsets in the node section, and each row can be
+// decoded independently, e.g., by different threads. For example:
+//
+//   MappedMatrix::Write("./train.txt.bin", matrix, signature);
+//
+//   CompressedMatrix cmat;
+//   cmat.Append(matrix);
+//   MappedMatrix::Write("./train.txt.bin", cmat, signature);
+//
+//   MappedMatrix mmat;
+//   mmat.Open("./train.txt.bin");
+//   MappedMatrix::Append("./train.txt.bin", mmat, new_rows, signature);
+//
+//   MappedMatrix mmat;
+//   if (mmat.Open("./train.txt.bin")) {
+//     DMatrix batch;
+//     batch.Recycle();
+//     for (index_t i = 0; i < 100; ++i) {
+//       mmat.CopyRow(i, batch);
+//     }
+//   }
+//------------------------------------------------------------------------------
+class MappedMatrix {
+ public:
+  // Constructor and Destructor
+  MappedMatrix()
+   : row_length(0),
+     has_label(true),
+     nnz(0),
+     max_feat(0),
+     max_field(0),
+     compressed_(false),
+     quantized_(false),
+     Y_(nullptr),
+     norm_(nullptr),
+     offset_(nullptr),
+     node_(nullptr),
+     data_(nullptr) { }
+  ~MappedMatrix() { Close(); }
+
+  // Write the matrix to a binary file, which starts with
+  // the magic number, the version, and the given signature.
+  static void Write(const std::string& filename,
+                    const DMatrix& matrix,
+                    const FileSignature& signature);
+
+  // Write the compressed matrix to a binary file.
+  static void Write(const std::string& filename,
+                    const CompressedMatrix& cmat,
+                    const FileSignature& signature);
+
+  // Write the rows of the mapped matrix followed by the rows of
+  // tail to a binary file, e.g., the text file has been appended.
+  // The nodes of tail are stored in the encoding of the mapped file.
+  // The binary file to be written can be the mapped one.
+  static void Append(const std::string& filename,
+                     const MappedMatrix& head,
+                     const DMatrix& tail,
+                     const FileSignature& signature);
+
+  // Map the binary file. Return false if the file cannot be
+  // mapped, or it is truncated, or it is of another version.
+  bool Open(const std::string& filename);
+
+  // Unmap the file.
+  void Close();
+
+  // Whether a file is mapped.
+  inline bool IsOpen() const { return file_.IsOpen(); }
+
+  // Whether the nodes are stored in the encoding of 
+  // CompressedMatrix, and whether the values are quantized.
+  inline bool IsCompressed() const { return compressed_; }
+  inline bool IsQuantized() const { return quantized_; }
+
+  // Label and norm of the id-th row.
+  inline real_t Label(index_t id) const { return Y_[id]; }
+  inline real_t Norm(index_t id) const { return norm_[id]; }
+
+  // The nodes of the id-th row are [RowBegin(id), RowEnd(id)).
+  // They can only be used if the file is not compressed.
+  inline const Node* RowBegin(index_t id) const {
+    return node_ + offset_[id];
+  }
+  inline const Node* RowEnd(index_t id) const {
+    return node_ + offset_[id+1];
+  }
+
+  // Number of nodes of the id-th row.
+  size_t RowSize(index_t id) const;
+
+  // Copy (or decode) the id-th row to a Node array.
+  // Return the number of nodes.
+  size_t GetRow(index_t id, std::vector<Node>& nodes) const;
+
+  // Copy the id-th row and append it to the given matrix.
+  void CopyRow(index_t id, DMatrix& matrix) const;
+
+  // Return the size (byte) of the mapped file.
+  inline uint64 FileSize() const { return file_.Size(); }
+
+  /* Number of row */
+  index_t row_length;
+  /* If current dataset has label y */
+  bool has_label;
+  /* Statistics of the data */
+  uint64 nnz;
+  index_t max_feat;
+  index_t max_field;
+
+ protected:
+  /* The mapped binary file */
+  MappedFile file_;
+  /* Encoding of the nodes */
+  bool compressed_;
+  bool quantized_;
+  /* Pointers to the sections of the file */
+  const real_t* Y_;
+  const real_t* norm_;
+  const uint64* offset_;
+  const Node* node_;
+  const uint8* data_;
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(MappedMatrix);
+};
+
+}  // namespace xLearn
+
+#endif  // XLEARN_DATA_MAPPED_MATRIX_H_
@@ -0,0 +1,256 @@
+//------------------------------------------------------------------------------
+// Copyright (c) 2018 by contributors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//------------------------------------------------------------------------------
+
+/*
+This file tests mapped_matrix.h file.
+*/
+
+#include "gtest/gtest.h"
+
+#include "src/base/file_util.h"
+#include "src/data/mapped_matrix.h"
+
+namespace xLearn {
+
+const index_t kRowNum = 100;
+const std::string kBinFile = "./test_mapped_matrix.bin";
+
+// Build a matrix with some empty rows
+void init_matrix(DMatrix& matrix) {
+  matrix.Reset();
+  for (index_t i = 0; i < kRowNum; ++i) {
+    matrix.AddRow();
+    matrix.Y[i] = i % 2;
+    matrix.norm[i] = 1.0 / (i + 1);
+    if (i % 10 == 9) { continue; }  // empty row
+    for (index_t j = 0; j < i % 7 + 1; ++j) {
+      matrix.AddNode(i, i * 10 + j, 0.1 * j, j);
+    }
+  }
+  matrix.has_label = false;
+}
+
+// Check the nodes of a row
+void check_row(const SparseRow* origin, const Node* begin, const Node* end) {
+  if (origin == nullptr) {
+    EXPECT_EQ(begin, end);
+    return;
+  }
+  ASSERT_EQ(origin->size(), end - begin);
+  for (size_t j = 0; j < origin->size(); ++j) {
+    EXPECT_EQ(begin[j].feat_id, (*origin)[j].feat_id);
+    EXPECT_EQ(begin[j].field_id, (*origin)[j].field_id);
+    EXPECT_FLOAT_EQ(begin[j].feat_val, (*origin)[j].feat_val);
+  }
+}
+
+TEST(MAPPED_MATRIX_TEST, WriteAndOpen) {
+  DMatrix matrix;
+  init_matrix(matrix);
+  FileSignature signature;
+  signature.size = 123;
+  MappedMatrix::Write(kBinFile, matrix, signature);
+  MappedMatrix mmat;
+  ASSERT_TRUE(mmat.Open(kBinFile));
+  EXPECT_EQ(mmat.row_length, kRowNum);
+  EXPECT_EQ(mmat.has_label, false);
+  EXPECT_EQ(mmat.nnz, matrix.nnz);
+  EXPECT_EQ(mmat.max_feat, matrix.max_feat);
+  EXPECT_EQ(mmat.max_field, matrix.max_field);
+  for (index_t i = 0; i < kRowNum; ++i) {
+    EXPECT_FLOAT_EQ(mmat.Label(i), matrix.Y[i]);
+    EXPECT_FLOAT_EQ(mmat.Norm(i), matrix.norm[i]);
+    check_row(matrix.row[i], mmat.RowBegin(i), mmat.RowEnd(i));
+  }
+  // The signature follows the magic number and the version
+  FILE* file = OpenFileOrDie(kBinFile.c_str(), "rb");
+  uint64 magic = 0;
+  uint32 version = 0;
+  FileSignature bin_sig;
+  ReadDataFromDisk(file, (char*)&magic, sizeof(magic));
+  ReadDataFromDisk(file, (char*)&version, sizeof(version));
+  EXPECT_TRUE(bin_sig.Read(file));
+  Close(file);
+  EXPECT_EQ(magic, kBinMagic);
+  EXPECT_EQ(version, kBinVersion);
+  EXPECT_EQ(bin_sig.size, 123);
+  mmat.Close();
+  EXPECT_FALSE(mmat.IsOpen());
+  EXPECT_EQ(mmat.row_length, 0);
+  RemoveFile(kBinFile.c_str());
+}
+
+TEST(MAPPED_MATRIX_TEST, CopyRow) {
+  DMatrix matrix;
+  init_matrix(matrix);
+  MappedMatrix::Write(kBinFile, matrix, FileSignature());
+  MappedMatrix mmat;
+  ASSERT_TRUE(mmat.Open(kBinFile));
+  DMatrix batch;
+  for (int n = 0; n < 2; ++n) {
+    batch.Recycle();
+    for (index_t i = 0; i < kRowNum; ++i) {
+      mmat.CopyRow(kRowNum - 1 - i, batch);
+    }
+    EXPECT_EQ(batch.row_length, kRowNum);
+    EXPECT_EQ(batch.nnz, matrix.nnz);
+    EXPECT_EQ(batch.max_feat, matrix.max_feat);
+    EXPECT_EQ(batch.max_field, matrix.max_field);
+    for (index_t i = 0; i < kRowNum; ++i) {
+      index_t id = kRowNum - 1 - i;
+      EXPECT_FLOAT_EQ(batch.Y[i], matrix.Y[id]);
+      EXPECT_FLOAT_EQ(batch.norm[i], matrix.norm[id]);
+      if (batch.row[i] == nullptr) {
+        EXPECT_TRUE(matrix.row[id] == nullptr);
+        continue;
+      }
+      check_row(matrix.row[id], batch.row[i]->data(),
+                batch.row[i]->data() + batch.row[i]->size());
+    }
+  }
+  RemoveFile(kBinFile.c_str());
+}
+
+TEST(MAPPED_MATRIX_TEST, Compressed) {
+  DMatrix matrix;
+  init_matrix(matrix);
+  MappedMatrix::Write(kBinFile, matrix, FileSignature());
+  uint64 raw_size = 0;
+  {
+    MappedMatrix mmat;
+    ASSERT_TRUE(mmat.Open(kBinFile));
+    EXPECT_FALSE(mmat.IsCompressed());
+    raw_size = mmat.FileSize();
+  }
+  for (int quantize = 0; quantize < 2; ++quantize) {
+    CompressedMatrix cmat;
+    cmat.SetQuantize(quantize);
+    cmat.Append(matrix);
+    MappedMatrix::Write(kBinFile, cmat, FileSignature());
+    MappedMatrix mmat;
+    ASSERT_TRUE(mmat.Open(kBinFile));
+    EXPECT_TRUE(mmat.IsCompressed());
+    EXPECT_EQ(mmat.IsQuantized(), quantize == 1);
+    EXPECT_LT(mmat.FileSize(), raw_size);
+    EXPECT_EQ(mmat.row_length, kRowNum);
+    EXPECT_EQ(mmat.has_label, false);
+    EXPECT_EQ(mmat.nnz, matrix.nnz);
+    EXPECT_EQ(mmat.max_feat, matrix.max_feat);
+    EXPECT_EQ(mmat.max_field, matrix.max_field);
+    // The nodes are sorted by feature id in 
+    // both the original and the decoded rows.
+    std::vector<Node> nodes;
+    DMatrix batch;
+    batch.Recycle();
+    for (index_t i = 0; i < kRowNum; ++i) {
+      EXPECT_FLOAT_EQ(mmat.Label(i), matrix.Y[i]);
+      EXPECT_FLOAT_EQ(mmat.Norm(i), matrix.norm[i]);
+      size_t size = matrix.row[i] == nullptr ? 0 : matrix.row[i]->size();
+      EXPECT_EQ(mmat.RowSize(i), size);
+      EXPECT_EQ(mmat.GetRow(i, nodes), size);
+      mmat.CopyRow(i, batch);
+      if (size == 0) { 
+        EXPECT_TRUE(batch.row[i] == nullptr);
+        continue; 
+      }
+      for (size_t j = 0; j < size; ++j) {
+        EXPECT_EQ(nodes[j].feat_id, (*matrix.row[i])[j].feat_id);
+        EXPECT_EQ(nodes[j].field_id, (*matrix.row[i])[j].field_id);
+        EXPECT_NEAR(nodes[j].feat_val, (*matrix.row[i])[j].feat_val, 0.002);
+        EXPECT_EQ((*batch.row[i])[j].feat_id, nodes[j].feat_id);
+      }
+    }
+    EXPECT_EQ(batch.nnz, matrix.nnz);
+  }
+  RemoveFile(kBinFile.c_str());
+}
+
+TEST(MAPPED_MATRIX_TEST, Append) {
+  DMatrix matrix, tail;
+  init_matrix(matrix);
+  init_matrix(tail);
+  for (index_t i = 0; i < kRowNum; ++i) {
+    if (tail.row[i] == nullptr) { continue; }
+    for (size_t j = 0; j < tail.row[i]->size(); ++j) {
+      (*tail.row[i])[j].feat_id += 5000;
+    }
+  }
+  tail.max_feat += 5000;
+  for (int compress = 0; compress < 2; ++compress) {
+    if (compress == 1) {
+      CompressedMatrix cmat;
+      cmat.Append(matrix);
+      MappedMatrix::Write(kBinFile, cmat, FileSignature());
+    } else {
+      MappedMatrix::Write(kBinFile, matrix, FileSignature());
+    }
+    // Append to the mapped file itself
+    MappedMatrix mmat;
+    ASSERT_TRUE(mmat.Open(kBinFile));
+    FileSignature signature;
+    signature.size = 456;
+    MappedMatrix::Append(kBinFile, mmat, tail, signature);
+    ASSERT_TRUE(mmat.Open(kBinFile));
+    EXPECT_EQ(mmat.IsCompressed(), compress == 1);
+    EXPECT_EQ(mmat.row_length, 2 * kRowNum);
+    EXPECT_EQ(mmat.has_label, false);
+    EXPECT_EQ(mmat.nnz, matrix.nnz + tail.nnz);
+    EXPECT_EQ(mmat.max_feat, tail.max_feat);
+    EXPECT_EQ(mmat.max_field, matrix.max_field);
+    std::vector<Node> nodes;
+    for (index_t i = 0; i < 2 * kRowNum; ++i) {
+      const DMatrix& origin = i < kRowNum ? matrix : tail;
+      index_t id = i % kRowNum;
+      EXPECT_FLOAT_EQ(mmat.Label(i), origin.Y[id]);
+      EXPECT_FLOAT_EQ(mmat.Norm(i), origin.norm[id]);
+      mmat.GetRow(i, nodes);
+      check_row(origin.row[id], nodes.data(), nodes.data() + nodes.size());
+    }
+  }
+  RemoveFile(kBinFile.c_str());
+}
+
+TEST(MAPPED_MATRIX_TEST, InvalidFile) {
+  MappedMatrix mmat;
+  EXPECT_FALSE(mmat.Open(kBinFile));
+  // The bin file of an old version
+  DMatrix matrix;
+  matrix.ReAlloc(1);
+  matrix.AddNode(0, 1, 0.5);
+  matrix.Serialize(kBinFile);
+  EXPECT_FALSE(mmat.Open(kBinFile));
+  // Truncated file
+  init_matrix(matrix);
+  MappedMatrix::Write(kBinFile, matrix, FileSignature());
+  uint64 size = 0;
+  char* buf = nullptr;
+  {
+    FILE* file = OpenFileOrDie(kBinFile.c_str(), "rb");
+    size = GetFileSize(file);
+    buf = new char[size];
+    ReadDataFromDisk(file, buf, size);
+    Close(file);
+  }
+  FILE* file = OpenFileOrDie(kBinFile.c_str(), "wb");
+  WriteDataToDisk(file, buf, size - 1);
+  Close(file);
+  delete [] buf;
+  EXPECT_FALSE(mmat.Open(kBinFile));
+  EXPECT_FALSE(mmat.IsOpen());
+  RemoveFile(kBinFile.c_str());
+}
+
+}  // namespace xLearn
@@ -23,6 +23,8 @@ This file is the implementation of the Model class.
 #include <string.h>
 #include <pmmintrin.h>  // for SSE
 
+#include <limits>
+
 #include "src/base/file_util.h"
 #include "src/base/format_print.h"
 #include "src/base/math.h"
@@ -35,6 +37,51 @@ namespace xLearn {
 // The Model class
 //------------------------------------------------------------------------------
 
+// The model parameters are allocated in one block,
+// so its size (byte) must fit in size_t.
+static const param_index_t kMaxNumParameter =
+  std::numeric_limits<size_t>::max() / sizeof(real_t);
+
+// The sizes of w and v are written as 32-bit index_t, which is the
+// format of the older versions. A size that does not fit is written
+// as kLargeSize followed by the 64-bit size.
+static const index_t kLargeSize = 0xFFFFFFFF;
+
+// Return a * b, or die if the model is too large.
+static param_index_t mul_num_param(param_index_t a, param_index_t b) {
+  if (a != 0 && b > kMaxNumParameter / a) {
+    Color::print_error(
+      "The model is too large (overflow). Try to use a smaller k, "
+      "fewer fields, or map the feature ids to a dense range (--remap)."
+    );
+    LOG(FATAL) << "The number of model parameters overflows.";
+  }
+  return a * b;
+}
+
+// Write the size of w or v to disk file.
+static void write_num_param(FILE* file, param_index_t num) {
+  if (num < kLargeSize) {
+    index_t num_32 = num;
+    WriteDataToDisk(file, (char*)&num_32, sizeof(num_32));
+  } else {
+    WriteDataToDisk(file, (char*)&kLargeSize, sizeof(kLargeSize));
+    WriteDataToDisk(file, (char*)&num, sizeof(num));
+  }
+}
+
+// Read the size of w or v from disk file.
+static param_index_t read_num_param(FILE* file) {
+  index_t num_32 = 0;
+  ReadDataFromDisk(file, (char*)&num_32, sizeof(num_32));
+  if (num_32 != kLargeSize) {
+    return num_32;
+  }
+  param_index_t num = 0;
+  ReadDataFromDisk(file, (char*)&num, sizeof(num));
+  return num;
+}
+
 // Basic contributor.
 void Model::Initialize(const std::string& score_func,
                   const std::string& loss_func,
@@ -59,17 +106,21 @@ void Model::Initialize(const std::string& score_func,
   num_K_ = num_K;
   aux_size_ = aux_size;
   scale_ = scale;
-  // Calculate the number of model parameters
-  param_num_w_ = num_feature * aux_size_;
+  // Calculate the number of model parameters in 64 bits
+  param_num_w_ = mul_num_param(num_feature, aux_size_);
   // latent vector
   if (score_func == "linear") {
     param_num_v_ = 0;
   } else if (score_func == "fm") {
     // fm: feature * K
-    param_num_v_ = num_feature * get_aligned_k() * aux_size_;
+    param_num_v_ = mul_num_param(
+      mul_num_param(num_feature, get_aligned_k()), aux_size_);
   } else if (score_func == "ffm") {
     // ffm: feature * K * field
-    param_num_v_ = num_feature * get_aligned_k() * num_field * aux_size_;
+    param_num_v_ = mul_num_param(
+      mul_num_param(
+        mul_num_param(num_feature, get_aligned_k()), num_field),
+      aux_size_);
   } else {
     LOG(FATAL) << "Unknow score function: " << score_func;
   }
@@ -78,30 +129,21 @@ void Model::Initialize(const std::string& score_func,
 
 // To get the best performance for SSE, we need to
 // allocate memory for the model parameters in aligned way.
-// For SSE, the align number should be 16 byte (kAlignByte).
+// For SSE, the align number should be 16 byte (kAlignByte),
+// and AllocPages() aligns the buffer to kPageAlignByte.
 void Model::initial(bool set_val) {
-  try {
-    // Conventional malloc for linear term and bias
-    param_w_ = (real_t*)malloc(param_num_w_ * sizeof(real_t));
-    param_b_ = (real_t*)malloc(aux_size_ * sizeof(real_t));
-    if (score_func_.compare("fm") == 0 ||
-        score_func_.compare("ffm") == 0) {
-      // Aligned malloc for latent factor
-#ifdef _MSC_VER
-      param_v_ = (decltype(param_v_))_aligned_malloc(
-                 param_num_v_ * sizeof(real_t),
-                 kAlignByte);
-#else
-      int ret = posix_memalign(
-                (void**)&param_v_,
-                kAlignByte,
-                param_num_v_ * sizeof(real_t));
-      CHECK_EQ(ret, 0);
-#endif
-    } else {
-      param_v_ = nullptr;
-    }
-  } catch (std::bad_alloc&) {
+  // The linear term and the latent factor are
+  // allocated on the pages of page_type_
+  param_w_ = alloc_param(param_num_w_, &page_w_);
+  param_b_ = (real_t*)malloc(aux_size_ * sizeof(real_t));
+  if (score_func_.compare("fm") == 0 ||
+      score_func_.compare("ffm") == 0) {
+    param_v_ = alloc_param(param_num_v_, &page_v_);
+  } else {
+    param_v_ = nullptr;
+  }
+  if (param_w_ == nullptr || param_b_ == nullptr ||
+      (param_v_ == nullptr && param_num_v_ > 0)) {
     LOG(FATAL) << "Cannot allocate enough memory for current  \
                    model parameters. Parameter size: "
                << GetNumParameter();
@@ -112,6 +154,17 @@ void Model::initial(bool set_val) {
   }
 }
 
+// Allocate num parameters on the pages of page_type_. The pages
+// are interleaved across the NUMA nodes before they are touched.
+real_t* Model::alloc_param(param_index_t num, PageType* used) {
+  uint64 size = num * sizeof(real_t);
+  real_t* ptr = (real_t*)AllocPages(size, page_type_, used);
+  if (ptr != nullptr && numa_ != nullptr) {
+    numa_->Interleave(ptr, size);
+  }
+  return ptr;
+}
+
 // Set value for model
 void Model::set_value() {
   // Use distribution to transform the random unsigned
@@ -121,7 +174,7 @@ void Model::set_value() {
   /*********************************************************
    *  Initialize linear and bias term                      *
    *********************************************************/
-  for (index_t i = 0; i < param_num_w_; i += aux_size_) {
+  for (param_index_t i = 0; i < param_num_w_; i += aux_size_) {
     param_w_[i] = 0.0;        /* model */
     for (index_t j = 1; j < aux_size_; ++j) {
       param_w_[i+j] = 1.0;    /* gradient cache */
@@ -175,30 +228,21 @@ void Model::set_value() {
 
 // Free the allocated memory
 void Model::free_model() {
-  free(param_w_);
-#ifndef _MSC_VER
-  free(param_v_);
-#else
-  _aligned_free(param_v_);
-#endif
+  FreePages(param_w_, param_num_w_ * sizeof(real_t), page_w_);
+  FreePages(param_v_, param_num_v_ * sizeof(real_t), page_v_);
   free(param_b_);
-  if (param_best_w_ != nullptr) {
-    free(param_best_w_);
-  }
-  if (param_best_v_ != nullptr) {
-#ifndef _MSC_VER
-    free(param_best_v_);
-#else
-    _aligned_free(param_best_v_);
-#endif
-  }
+  FreePages(param_best_w_, param_num_w_ * sizeof(real_t), page_best_w_);
+  FreePages(param_best_v_, param_num_v_ * sizeof(real_t), page_best_v_);
   if (param_best_b_ != nullptr) {
     free(param_best_b_);
   }
 }
 
 // Initialize model from a checkpoint file
-Model::Model(const std::string& filename) {
+Model::Model(const std::string& filename,
+             PageType page_type,
+             const NumaTopology* numa)
+  : page_type_(page_type), numa_(numa) {
   CHECK_NE(filename.empty(), true);
   if (this->Deserialize(filename) == false) {
     Color::print_error(
@@ -231,6 +275,10 @@ void Model::Serialize(const std::string& filename) {
   WriteDataToDisk(file, (char*)&aux_size_, sizeof(aux_size_));
   // Write w
   this->serialize_w_v_b(file);
+  // Write the original feature ids
+  if (!feature_list_.empty()) {
+    WriteVectorToFile(file, feature_list_);
+  }
   Close(file);
 }
 
@@ -245,8 +293,8 @@ void Model::SerializeToTXT(const std::string& filename) {
   o_file << "bias: " << param_b_[0] << "\n";
   // linear term
   index_t idx = 0;
-  for (index_t i = 0; i < param_num_w_; i += aux_size_) {
-    o_file << "i_" << idx << ": " << param_w_[i] << "\n";
+  for (param_index_t i = 0; i < param_num_w_; i += aux_size_) {
+    o_file << "i_" << feature_id(idx) << ": " << param_w_[i] << "\n";
     idx++;
   }
   /*********************************************************
@@ -256,7 +304,7 @@ void Model::SerializeToTXT(const std::string& filename) {
     index_t k_aligned = get_aligned_k();
     real_t* w = param_v_;
     for (index_t j = 0; j < num_feat_; ++j) {
-      o_file << "v_" << j << ": ";
+      o_file << "v_" << feature_id(j) << ": ";
       for(index_t d = 0; d < num_K_; d++, w++) {
         o_file << *w;
         if (d != num_K_-1) {
@@ -277,7 +325,7 @@ void Model::SerializeToTXT(const std::string& filename) {
     real_t* w = param_v_;
     for (index_t j = 0; j < num_feat_; ++j) {
       for (index_t f = 0; f < num_field_; ++f) {
-        o_file << "v_" << j << "_" << f << ": ";
+        o_file << "v_" << feature_id(j) << "_" << f << ": ";
         for (index_t d = 0; d < k_aligned; ) {
           for (index_t s = 0; s < kAlign; s++, w++, d++) {
             if (d < num_K_) {
@@ -318,37 +366,33 @@ bool Model::Deserialize(const std::string& filename) {
   ReadDataFromDisk(file, (char*)&aux_size_, sizeof(aux_size_));
   // Read w
   this->deserialize_w_v_b(file);
+  // Read the original feature ids, which are
+  // not in the model files of older versions
+  feature_list_.clear();
+  int c = fgetc(file);
+  if (c != EOF) {
+    ungetc(c, file);
+    ReadVectorFromFile(file, feature_list_);
+  }
   Close(file);
   return true;
 }
 
 // Take a record of the best model during training
 void Model::SetBestModel() {
-  try {
-    if (param_best_w_ == nullptr) {
-        param_best_w_ = (real_t*)malloc(
-        param_num_w_*sizeof(real_t));
-    }
-    if (param_best_v_ == nullptr &&
-        score_func_.compare("linear") != 0) {
-  #ifdef _MSC_VER
-        param_best_v_ = (decltype(param_best_v_))_aligned_malloc(
-        param_num_v_ * sizeof(real_t),
-        kAlignByte);
-  #else
-      int ret = posix_memalign(
-                (void**)&param_best_v_,
-                kAlignByte,
-                param_num_v_ * sizeof(real_t));
-      CHECK_EQ(ret, 0);
-  #endif
-    }
-    if (param_best_b_ == nullptr) {
-        param_best_b_ = (real_t*)malloc(
-         aux_size_ * sizeof(real_t)
-        );
-    }
-  } catch (std::bad_alloc&) {
+  // The best model is on the same type of pages
+  if (param_best_w_ == nullptr) {
+    param_best_w_ = alloc_param(param_num_w_, &page_best_w_);
+  }
+  if (param_best_v_ == nullptr &&
+      score_func_.compare("linear") != 0) {
+    param_best_v_ = alloc_param(param_num_v_, &page_best_v_);
+  }
+  if (param_best_b_ == nullptr) {
+    param_best_b_ = (real_t*)malloc(aux_size_ * sizeof(real_t));
+  }
+  if (param_best_w_ == nullptr || param_best_b_ == nullptr ||
+      (param_best_v_ == nullptr && score_func_.compare("linear") != 0)) {
     LOG(FATAL) << "Cannot allocate enough memory for current  \
                    model parameters. Parameter size: "
                << GetNumParameter();
@@ -376,10 +420,10 @@ void Model::Shrink() {
 // Serialize w,v,b to disk file
 void Model::serialize_w_v_b(FILE* file) {
   // Write size of w
-  WriteDataToDisk(file, (char*)&param_num_w_, sizeof(param_num_w_));
+  write_num_param(file, param_num_w_);
   // Write size of v
   if (score_func_.compare("linear") != 0) {
-    WriteDataToDisk(file, (char*)&param_num_v_, sizeof(param_num_v_));
+    write_num_param(file, param_num_v_);
   }
   // Write w
   WriteDataToDisk(file, (char*)param_w_, sizeof(real_t)*param_num_w_);
@@ -394,10 +438,12 @@ void Model::serialize_w_v_b(FILE* file) {
 // Deserialize w,v,b from disk file
 void Model::deserialize_w_v_b(FILE* file) {
   // Read size of w
-  ReadDataFromDisk(file, (char*)&param_num_w_, sizeof(param_num_w_));
+  param_num_w_ = read_num_param(file);
   // Read size of v
   if (score_func_.compare("linear") != 0) {
-    ReadDataFromDisk(file, (char*)&param_num_v_, sizeof(param_num_v_));
+    param_num_v_ = read_num_param(file);
+  } else {
+    param_num_v_ = 0;
   }
   // Allocate memory. Don't set value here
   this->initial(false);
@@ -22,11 +22,14 @@ This file defines the class of model parameters.
 #define XLEARN_DATA_MODEL_PARAMETERS_H_
 
 #include <string>
+#include <vector>
 
 #include <math.h>
 
 #include "src/base/common.h"
 #include "src/data/data_structure.h"
+#include "src/base/huge_page.h"
+#include "src/base/numa.h"
 #include "src/base/logging.h"
 
 namespace xLearn {
@@ -59,15 +62,15 @@ namespace xLearn {
 //
 //    /* We can get the parameter of the linear term: */
 //    real_t* w = model.GetParameter_w();
-//    index_t w_len = model.GetNumParameter_w();
-//    for (index_t i = 0; i < w_len; ++i) {
+//    param_index_t w_len = model.GetNumParameter_w();
+//    for (param_index_t i = 0; i < w_len; ++i) {
 //      /* access w[i] ... */
 //    }
 //
 //    /* We can also get the parameter of the latent factor */
 //    real_t* v = model.GetParameter_v();
-//    index_t v_len = model.GetNumParameter_v();
-//    for (index_t i = 0; i < v_len; ++i) {
+//    param_index_t v_len = model.GetNumParameter_v();
+//    for (param_index_t i = 0; i < v_len; ++i) {
 //      /* access v[i] ... */
 //    }
 //
@@ -77,6 +80,24 @@ namespace xLearn {
 //    /* Also, we can load model from this file. */
 //    Model new_model("/tmp/model.txt");
 //
+// The number of parameters is a 64-bit param_index_t, since an ffm
+// model can easily have more than 2^32 parameters, and Initialize()
+// checks that the size of the model does not overflow.
+//
+// The linear term and the latent factor can be allocated on huge pages
+// (see huge_page.h) by SetPageType(), which must be called before
+// Initialize(), or by the constructor. It reduces the TLB misses of the
+// random access to a large model, and the best model uses them too.
+// On a NUMA machine, the pages can also be interleaved across the
+// nodes by SetNumaTopology(), so that they are not all on the node of
+// the thread that initializes them.
+//
+// If the feature ids of the data are sparse, they can be mapped to
+// a dense range (see FeatureIdMap), and the model has parameters for
+// the used features only. The original ids are saved at the end of
+// the model file by SetFeatureList(), so the model files without them
+// (i.e., of the older versions) can still be loaded.
+//
 // The Model class can support early-stopping technique. We can set
 // a record for the best model parameter by using SetBestModel() and
 // we can shrink back to find the best model by using Shrink() method.
@@ -87,8 +108,12 @@ class Model {
   Model() { }
   ~Model() { free_model(); }
 
-  // Initialize model from a checkpoint file.
-  explicit Model(const std::string& filename);
+  // Initialize model from a checkpoint file. The parameters are
+  // allocated on the pages of the given type, and interleaved
+  // across the nodes of numa if it is not nullptr.
+  explicit Model(const std::string& filename,
+                 PageType page_type = kNormalPage,
+                 const NumaTopology* numa = nullptr);
 
   // Initialize model parameters to zero or using
   // a random distribution.
@@ -115,6 +140,19 @@ class Model {
   // Shrink back for getting the best model.
   void Shrink();
 
+  // Set the type of the pages of the parameters.
+  inline void SetPageType(PageType page_type) { page_type_ = page_type; }
+
+  // Interleave the parameters across the nodes of numa. It
+  // must be called before Initialize().
+  inline void SetNumaTopology(const NumaTopology* numa) { numa_ = numa; }
+
+  // Get the type of the pages that are really used, which can
+  // be a fallback of the given type (see AllocPages()).
+  inline PageType GetPageType() {
+    return param_v_ != nullptr ? page_v_ : page_w_;
+  }
+
   // Get the size of auxiliary cache size.
   inline real_t GetAuxiliarySize() { return aux_size_; }
 
@@ -128,11 +166,11 @@ class Model {
   inline real_t* GetParameter_b() { return param_b_; }
 
   // Get the size of the linear term.
-  inline index_t GetNumParameter_w() { return param_num_w_; }
+  inline param_index_t GetNumParameter_w() { return param_num_w_; }
 
   // Get the size of the latent factor.
   // For linear score this value equals zero.
-  inline index_t GetNumParameter_v() { return param_num_v_; }
+  inline param_index_t GetNumParameter_v() { return param_num_v_; }
 
   // Reset current model parameters.
   inline void Reset() { set_value(); }
@@ -159,10 +197,24 @@ class Model {
 
   // Get the total size of model parameters.
   // 2 = bias + bias_gradient
-  inline index_t GetNumParameter() {
+  inline param_index_t GetNumParameter() {
     return param_num_w_ + param_num_v_ + 2;
   }
 
+  // Set the original feature ids of the model, if the feature
+  // ids of the data are mapped to a dense range (FeatureIdMap).
+  // The ids are saved in the model file, so that prediction can 
+  // map the feature ids in the same way.
+  inline void SetFeatureList(const std::vector<index_t>& feature_list) {
+    feature_list_ = feature_list;
+  }
+
+  // Get the original feature ids. It is empty if
+  // the model uses the feature ids of the data.
+  inline const std::vector<index_t>& GetFeatureList() {
+    return feature_list_;
+  }
+
  protected:
   /* Score function
   For now it can be 'linear', 'fm', or 'ffm' */
@@ -174,14 +226,14 @@ class Model {
   Note that we store both of the model parameters
   and the gradient cache in param_w_, so
   param_num_w_ = num_feat_ * aux_size_  */
-  index_t param_num_w_;
+  param_index_t param_num_w_;
   /* Size of the latent factor. 
   We store both the model parameters and the gradient 
   cache for adagrad in param_v_. 
   For linear function, param_num_v = 0
   For fm function, param_num_v_ = num_feat * num_K * aux_size_
   For ffm function, param_num_v_ = num_feat * num_field * num_K * aux_size_  */
-  index_t  param_num_v_;
+  param_index_t param_num_v_;
   /* Number of feature
   Feature id is start from 0 */
   index_t  num_feat_;
@@ -207,6 +259,18 @@ class Model {
   real_t* param_best_b_ = nullptr;
   /* Used to init model parameters */
   real_t scale_;
+  /* The type of the pages to allocate, and the types
+  that are really used by param_w_, param_v_, etc */
+  PageType page_type_ = kNormalPage;
+  PageType page_w_ = kNormalPage;
+  PageType page_v_ = kNormalPage;
+  PageType page_best_w_ = kNormalPage;
+  PageType page_best_v_ = kNormalPage;
+  /* Interleave the parameters across the NUMA nodes if not nullptr */
+  const NumaTopology* numa_ = nullptr;
+  /* Original id of each feature if the feature ids are 
+  mapped to a dense range, or empty */
+  std::vector<index_t> feature_list_;
 
   // Initialize the value of model parameters and gradient cache.
   void initial(bool set_value = false);
@@ -214,6 +278,9 @@ class Model {
   // Reset the value of current model parameters.
   void set_value();
 
+  // Allocate num parameters on the pages of page_type_.
+  real_t* alloc_param(param_index_t num, PageType* used);
+
   // Serialize w, v, b to disk file.
   void serialize_w_v_b(FILE* file);
 
@@ -223,6 +290,11 @@ class Model {
   // Free the allocated memory.
   void free_model();
 
+  // Original id of the id-th feature.
+  inline index_t feature_id(index_t id) {
+    return feature_list_.empty() ? id : feature_list_[id];
+  }
+
  private:
   DISALLOW_COPY_AND_ASSIGN(Model);
 };
@@ -197,6 +197,31 @@ TEST(MODEL_TEST, Save_and_Load) {
   RemoveFile(hyper_param.model_file.c_str());
 }
 
+TEST(MODEL_TEST, Save_and_Load_feature_list) {
+  HyperParam hyper_param = Init();
+  Model model_fm;
+  model_fm.Initialize("fm",
+                    hyper_param.loss_func,
+                    hyper_param.num_feature,
+                    hyper_param.num_field,
+                    hyper_param.num_K,
+                    hyper_param.auxiliary_size);
+  // The model file without feature ids
+  model_fm.Serialize(hyper_param.model_file);
+  Model model_1(hyper_param.model_file);
+  EXPECT_TRUE(model_1.GetFeatureList().empty());
+  EXPECT_EQ(model_1.GetNumFeature(), hyper_param.num_feature);
+  // The model file with feature ids
+  std::vector<index_t> feature_list = {3, 70, 1000, 1 << 30};
+  model_fm.SetFeatureList(feature_list);
+  model_fm.Serialize(hyper_param.model_file);
+  Model model_2(hyper_param.model_file);
+  EXPECT_EQ(model_2.GetFeatureList(), feature_list);
+  EXPECT_EQ(model_2.GetNumFeature(), hyper_param.num_feature);
+  EXPECT_EQ(model_2.GetNumParameter(), model_fm.GetNumParameter());
+  RemoveFile(hyper_param.model_file.c_str());
+}
+
 TEST(MODEL_TEST, SerializeToTXT) {
   HyperParam hyper_param = Init();
   // linear
@@ -89,7 +89,7 @@ static void ce_gradient_thread(const DMatrix* matrix,
   CHECK_GE(end_idx, start_idx);
   *sum = 0;
   for (size_t i = start_idx; i < end_idx; ++i) {
-    SparseRow* row = matrix->row[i];
+    const SparseRow* row = matrix->GetRow(i);
     real_t norm = is_norm ? matrix->norm[i] : 1.0;
     real_t pred = score_func->CalcScore(row, *model, norm);
     // partial gradient
@@ -41,7 +41,7 @@ void pred_thread(const DMatrix* matrix,
                  size_t end_idx) {
   CHECK_GE(end_idx, start_idx);
   for (size_t i = start_idx; i < end_idx; ++i) {
-    SparseRow* row = matrix->row[i];
+    const SparseRow* row = matrix->GetRow(i);
     real_t norm = is_norm ? matrix->norm[i] : 1.0;
     (*pred)[i] = score_func_->CalcScore(row, *model, norm);
   }
@@ -91,7 +91,7 @@ void Loss::CalcGradDist(DMatrix* matrix,
     // Compress the sparse data matrix and sparse model
     // parameter to dense format
     std::vector<index_t> feature_list;
-    mini_batch.Compress(feature_list);
+    mini_batch.Compress(feature_list, pool_);
     /*
     // Pull the model parameter from parameter server
     store->pull(feature_list, model);
@@ -86,7 +86,7 @@ void sq_gradient_thread(const DMatrix* matrix,
   CHECK_GE(end, start);
   *sum = 0;
   for (size_t i = start; i < end; ++i) {
-    SparseRow* row = matrix->row[i];
+    const SparseRow* row = matrix->GetRow(i);
     real_t norm = is_norm ? matrix->norm[i] : 1.0;
     real_t pred = score_func->CalcScore(row, *model, norm);
     // loss
@@ -20,16 +20,14 @@ This file is the implementation of Parser class.
 
 #include "src/reader/parser.h"
 
-#include "src/base/split_string.h"
+#include "src/reader/tokenizer.h"
 
-#include <stdlib.h>
+#include <algorithm>
 
 namespace xLearn {
 
-// Max size of one line TXT data
-static const uint32 kMaxLineSize = 10 * 1024 * 1024;  // 10 MB
-
-static char line_buf[kMaxLineSize];
+// Each thread parses at least this size of buffer
+static const uint64 kMinParseSize = 1024 * 1024;  // 1 MB
 
 //------------------------------------------------------------------------------
 // Class register
@@ -39,29 +37,107 @@ REGISTER_PARSER("libsvm", LibsvmParser);
 REGISTER_PARSER("libffm", FFMParser);
 REGISTER_PARSER("csv", CSVParser);
 
-// Get one line from memory buffer
-uint64 Parser::get_line_from_buffer(char* line,
-                                    char* buf,
-                                    uint64 pos,
-                                    uint64 size) {
-  if (pos >= size) { return 0; }
-  uint64 end_pos = pos;
-  while (end_pos < size && buf[end_pos] != '\n') { end_pos++; }
-  uint64 read_size = end_pos - pos + 1;
-  if (read_size > kMaxLineSize) {
-    LOG(FATAL) << "Encountered a too-long line.    \
-                   Please check the data.";
-  }
-  memcpy(line, buf+pos, read_size);
-  line[read_size - 1] = '\0';
-  if (read_size > 1 && line[read_size - 2] == '\r') {
-    // Handle some txt format in windows or DOS.
-    line[read_size - 2] = '\0';
+Parser::~Parser() {
+  free_pool();
+  STLDeleteElementsAndClear(&thread_matrix_);
+}
+
+// Delete the thread pool if it is owned by this parser.
+void Parser::free_pool() {
+  if (own_pool_) {
+    delete pool_;
   }
-  return read_size;
+  pool_ = nullptr;
+  own_pool_ = false;
+}
+
+// Set the number of threads used by Parse(). The thread
+// pool is created when it is needed for the first time.
+void Parser::SetThreadNumber(int thread_number) {
+  CHECK_GT(thread_number, 0);
+  thread_number_ = thread_number;
+  free_pool();
 }
 
+// Parse with a thread pool that is shared with other parsers.
+void Parser::SetThreadPool(ThreadPool* pool) {
+  CHECK_NOTNULL(pool);
+  free_pool();
+  pool_ = pool;
+  thread_number_ = pool->ThreadNumber();
+}
+
+// Each thread parses a part of buffer
+static void parse_thread(Parser* parser,
+                         void (Parser::*func)(const char*, uint64, DMatrix&),
+                         const char* buf,
+                         uint64 size,
+                         DMatrix* matrix) {
+  (parser->*func)(buf, size, *matrix);
+}
+
+// Split the buffer at line boundaries, parse each part
+// in different thread, and then merge them in order.
+void Parser::Parse(const char* buf, 
+                   uint64 size, 
+                   DMatrix& matrix, 
+                   bool reset) {
+  CHECK_NOTNULL(buf);
+  CHECK_GT(size, 0);
+  // Clear the data matrix
+  if (reset) { 
+    matrix.Recycle(); 
+  }
+  uint64 num_part = std::min((uint64)thread_number_, 
+                             size / kMinParseSize);
+  if (num_part <= 1) {
+    parse_block(buf, size, matrix);
+    return;
+  }
+  if (pool_ == nullptr) {
+    pool_ = new ThreadPool(thread_number_);
+    own_pool_ = true;
+  }
+  while (thread_matrix_.size() < num_part) {
+    thread_matrix_.push_back(new DMatrix);
+  }
+  // Split buffer. Each part (except the last) ends with '\n'.
+  std::vector<uint64> start(num_part + 1, size);
+  start[0] = 0;
+  for (uint64 i = 1; i < num_part; ++i) {
+    uint64 pos = std::max(start[i-1], size / num_part * i);
+    while (pos < size && buf[pos] != '\n') { pos++; }
+    start[i] = pos < size ? pos + 1 : size;
+  }
+  // The pool can be shared by several parsers, so we
+  // wait for our own jobs instead of Sync().
+  std::vector<std::future<void> > jobs;
+  for (uint64 i = 0; i < num_part; ++i) {
+    thread_matrix_[i]->Recycle();
+    jobs.push_back(pool_->enqueue(std::bind(parse_thread, 
+                                            this, 
+                                            &Parser::parse_block,
+                                            buf + start[i],
+                                            start[i+1] - start[i],
+                                            thread_matrix_[i])));
+  }
+  for (uint64 i = 0; i < num_part; ++i) {
+    jobs[i].get();
+  }
+  // Merge in order
+  for (uint64 i = 0; i < num_part; ++i) {
+    matrix.MoveFrom(*thread_matrix_[i]);
+  }
+}
 
+// Print the text that cannot be parsed and exit.
+static void parse_error(const char* ptr, 
+                        const char* end, 
+                        const std::string& format) {
+  size_t len = std::min(end - ptr, (ptrdiff_t)32);
+  LOG(FATAL) << "Wrong " << format << " format near: \""
+             << std::string(ptr, len) << "\"";
+}
 
 //------------------------------------------------------------------------------
 // LibsvmParser parses the following data format:
@@ -69,55 +145,39 @@ uint64 Parser::get_line_from_buffer(char* line,
 // [y2 idx:value idx:value ...]
 // idx can start from 0
 //------------------------------------------------------------------------------
-void LibsvmParser::Parse(char* buf, 
-                         uint64 size, 
-                         DMatrix& matrix, 
-                         bool reset) {
-  CHECK_NOTNULL(buf);
-  CHECK_GT(size, 0);
-  // Clear the data matrix
-  if (reset) { 
-    matrix.Reset(); 
-  }
+void LibsvmParser::parse_block(const char* buf, 
+                               uint64 size, 
+                               DMatrix& matrix) {
+  char splitor = splitor_[0];
+  const char* ptr = buf;
+  const char* end = buf + size;
   // Parse every line
-  uint64 pos = 0;
-  for (;;) {
-    uint64 rd_size = get_line_from_buffer(line_buf, buf, pos, size);
-    if (rd_size == 0) break;
-    pos += rd_size;
+  while (ptr < end) {
+    const char* line = ptr;
+    const char* line_end = NextLine(ptr, end);
+    SkipBlank(line, line_end, splitor);
+    if (line == line_end) continue;  // empty line
     matrix.AddRow();
-    int i = matrix.row_length - 1;
-    if (reset == false) {
-    }
+    index_t i = matrix.row_length - 1;
     // Add Y
     if (has_label_) {  // for training task
-      char *y_char = strtok(line_buf, splitor_.c_str());
-      matrix.Y[i] = atof(y_char);
+      matrix.Y[i] = ParseReal(line, line_end);
+      SkipToken(line, line_end, splitor);
     } else {  // for predict task
       matrix.Y[i] = -2;
     }
     // Add features
     real_t norm = 0.0;
-    // The first element
-    if (!has_label_) {
-      char *idx_char = strtok(line_buf, ":");
-      char *value_char = strtok(nullptr, splitor_.c_str());
-      if (idx_char != nullptr && *idx_char != '\n') {
-        index_t idx = atoi(idx_char);
-        real_t value = atof(value_char);
-        matrix.AddNode(i, idx, value);
-        norm += value*value;
-      }
-    }
-    // The remain elements
     for (;;) {
-      char *idx_char = strtok(nullptr, ":");
-      char *value_char = strtok(nullptr, splitor_.c_str());
-      if (idx_char == nullptr || *idx_char == '\n') {
-        break;
+      SkipBlank(line, line_end, splitor);
+      if (line == line_end) break;
+      index_t idx = ParseIndex(line, line_end);
+      if (line == line_end || *line != ':') {
+        parse_error(line, line_end, "libsvm");
       }
-      index_t idx = atoi(idx_char);
-      real_t value = atof(value_char);
+      ++line;
+      real_t value = ParseReal(line, line_end);
+      SkipToken(line, line_end, splitor);
       matrix.AddNode(i, idx, value);
       norm += value*value;
     }
@@ -132,57 +192,44 @@ void LibsvmParser::Parse(char* buf,
 // [y2 field:idx:value field:idx:value ...]
 // idx can start from 0
 //------------------------------------------------------------------------------
-void FFMParser::Parse(char* buf, 
-                      uint64 size, 
-                      DMatrix& matrix,
-                      bool reset) {
-  CHECK_NOTNULL(buf);
-  CHECK_GT(size, 0);
-  // Clear the data matrix
-  if (reset) { 
-    matrix.Reset(); 
-  }
+void FFMParser::parse_block(const char* buf, 
+                            uint64 size, 
+                            DMatrix& matrix) {
+  char splitor = splitor_[0];
+  const char* ptr = buf;
+  const char* end = buf + size;
   // Parse every line
-  uint64 pos = 0;
-  for (;;) {
-    uint64 rd_size = get_line_from_buffer(line_buf, buf, pos, size);
-    if (rd_size == 0) break;
-    pos += rd_size;
+  while (ptr < end) {
+    const char* line = ptr;
+    const char* line_end = NextLine(ptr, end);
+    SkipBlank(line, line_end, splitor);
+    if (line == line_end) continue;  // empty line
     matrix.AddRow();
-    int i = matrix.row_length - 1;
+    index_t i = matrix.row_length - 1;
     // Add Y
     if (has_label_) {  // for training task
-      char *y_char = strtok(line_buf, splitor_.c_str());
-      matrix.Y[i] = atof(y_char);
+      matrix.Y[i] = ParseReal(line, line_end);
+      SkipToken(line, line_end, splitor);
     } else {  // for predict task
       matrix.Y[i] = -2;
     }
     // Add features
     real_t norm = 0.0;
-    // The first element
-    if (!has_label_) {
-      char *field_char = strtok(line_buf, ":");
-      char *idx_char = strtok(nullptr, ":");
-      char *value_char = strtok(nullptr, splitor_.c_str());
-      if (idx_char != nullptr && *idx_char != '\n') {
-        index_t idx = atoi(idx_char);
-        real_t value = atof(value_char);
-        index_t field_id = atoi(field_char);
-        matrix.AddNode(i, idx, value, field_id);
-        norm += value*value;
-      }
-    }
-    // The remain elements
     for (;;) {
-      char *field_char = strtok(nullptr, ":");
-      char *idx_char = strtok(nullptr, ":");
-      char *value_char = strtok(nullptr, splitor_.c_str());
-      if (field_char == nullptr || *field_char == '\n') {
-        break;
+      SkipBlank(line, line_end, splitor);
+      if (line == line_end) break;
+      index_t field_id = ParseIndex(line, line_end);
+      if (line == line_end || *line != ':') {
+        parse_error(line, line_end, "libffm");
       }
-      index_t idx = atoi(idx_char);
-      real_t value = atof(value_char);
-      index_t field_id = atoi(field_char);
+      ++line;
+      index_t idx = ParseIndex(line, line_end);
+      if (line == line_end || *line != ':') {
+        parse_error(line, line_end, "libffm");
+      }
+      ++line;
+      real_t value = ParseReal(line, line_end);
+      SkipToken(line, line_end, splitor);
       matrix.AddNode(i, idx, value, field_id);
       norm += value*value;
     }
@@ -199,39 +246,47 @@ void FFMParser::Parse(char* buf,
 // label y, users should add a placeholder to the dataset
 // by themselves (Also in test data). Otherwise, the parser 
 // will treat the first element as the label y.
+// The zero columns are skipped. The non-zero columns of a line
+// are collected in a local buffer, and then they are added to
+// the row at once, so that each row is allocated only once.
 //------------------------------------------------------------------------------
-void CSVParser::Parse(char* buf, 
-                      uint64 size, 
-                      DMatrix& matrix, 
-                      bool reset) {
-  CHECK_NOTNULL(buf);
-  CHECK_GT(size, 0);
-  // Clear the data matrix
-  if (reset) { 
-    matrix.Reset(); 
-  }
+void CSVParser::parse_block(const char* buf, 
+                            uint64 size, 
+                            DMatrix& matrix) {
+  char splitor = splitor_[0];
+  const char* ptr = buf;
+  const char* end = buf + size;
+  const index_t num_column = field_map_.size();
+  std::vector<Node> nodes;
   // Parse every line
-  uint64 pos = 0;
-  std::vector<std::string> str_vec;
-  for (;;) {
-    uint64 rd_size = get_line_from_buffer(line_buf, buf, pos, size);
-    if (rd_size == 0) break;
-    pos += rd_size;
+  while (ptr < end) {
+    const char* line = ptr;
+    const char* line_end = NextLine(ptr, end);
+    SkipBlank(line, line_end, splitor);
+    if (line == line_end) continue;  // empty line
     matrix.AddRow();
-    int i = matrix.row_length - 1;
-    str_vec.clear();
-    SplitStringUsing(line_buf, splitor_.c_str(), &str_vec);
-    int size = str_vec.size();
+    index_t i = matrix.row_length - 1;
     // Add Y
-    matrix.Y[i] = atof(str_vec[0].c_str());
+    matrix.Y[i] = ParseReal(line, line_end);
+    SkipToken(line, line_end, splitor);
     // Add features
     real_t norm = 0.0;
-    for (int j = 1; j < size; ++j) {
-      index_t idx = j-1;
-      real_t value = atof(str_vec[j].c_str());
-      matrix.AddNode(i, idx, value);
+    nodes.clear();
+    for (index_t idx = 0; ; ++idx) {
+      SkipBlank(line, line_end, splitor);
+      if (line == line_end) break;
+      real_t value = ParseReal(line, line_end);
+      SkipToken(line, line_end, splitor);
+      if (num_column > 0 && idx >= num_column) {
+        LOG(FATAL) << "The field map has " << num_column 
+                   << " columns, but the csv data has more.";
+      }
+      if (value == 0) { continue; }
+      index_t field = num_column > 0 ? field_map_[idx] : 0;
+      nodes.push_back(Node(field, idx, value));
       norm += value*value;
     }
+    matrix.AddNodes(i, nodes.data(), nodes.data() + nodes.size());
     norm = 1.0f / norm;
     matrix.norm[i] = norm;
   }
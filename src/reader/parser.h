@@ -27,6 +27,7 @@ datasets to the DMatrix.
 
 #include "src/base/common.h"
 #include "src/base/class_register.h"
+#include "src/base/thread_pool.h"
 #include "src/data/data_structure.h"
 
 namespace xLearn {
@@ -51,12 +52,21 @@ namespace xLearn {
 //   char* buffer = nullptr;
 //   uint64 size = ReadFileToMemory(filename, buffer);
 //   DMatrix matrix;
+//   parser->SetThreadNumber(4);  // parse with 4 threads
 //   parser->Parse(buffer, size, matrix);
+//
+// The threads are created when the first large buffer is parsed.
+// Several parsers can share one thread pool (SetThreadPool) instead,
+// e.g., the parsers of the shards of a MultiReader.
 //------------------------------------------------------------------------------
 class Parser {
  public:
-  Parser() { }
-  virtual ~Parser() {  }
+  Parser() 
+    : has_label_(true), 
+      thread_number_(1), 
+      pool_(nullptr),
+      own_pool_(false) { }
+  virtual ~Parser();
 
   // Wether this dataset contains label y ?
   inline void setLabel(bool label) {
@@ -68,25 +78,58 @@ class Parser {
     splitor_ = splitor;
   }
 
+  // Set the field of each column of csv data, which
+  // is ignored by the other formats.
+  inline void SetFieldMap(const std::vector<index_t>& field_map) {
+    field_map_ = field_map;
+  }
+
+  // Set the number of threads used by Parse().
+  void SetThreadNumber(int thread_number);
+
+  // Parse with a thread pool that is shared with other
+  // parsers. The pool is not owned by this parser.
+  void SetThreadPool(ThreadPool* pool);
+
   // The real parse function invoked by users.
-  // If reset == true, Parser will invoke matrix.Reset();
-  virtual void Parse(char* buf, 
-                     uint64 size, 
-                     DMatrix& matrix,
-                     bool reset = false) = 0;
+  // If reset == true, Parser will invoke matrix.Recycle(),
+  // which drops the old rows but keeps their memory for reuse.
+  // A large buffer will be split at the line boundaries and
+  // parsed by multiple threads, and then the rows are merged 
+  // to the matrix in their original order.
+  void Parse(const char* buf, 
+             uint64 size, 
+             DMatrix& matrix,
+             bool reset = false);
 
  protected:
-   // Get one line from memory buffer.
-   uint64 get_line_from_buffer(char* line,
-                               char* buf,
-                               uint64 pos,
-                               uint64 size);
+   // Parse all the lines of the buffer and add them to 
+   // the matrix. This function can be invoked by different 
+   // threads at the same time, so it cannot use any state 
+   // that is shared between threads.
+   virtual void parse_block(const char* buf,
+                            uint64 size,
+                            DMatrix& matrix) = 0;
 
    /* True for training task and
    False for prediction task */
    bool has_label_;
    /* Split string for data items */
    std::string splitor_;
+   /* Field of each column of csv data. All the
+   columns are in field 0 if it is empty */
+   std::vector<index_t> field_map_;
+   /* Number of threads for parsing */
+   int thread_number_;
+   /* Thread pool used by Parse() */
+   ThreadPool* pool_;
+   /* Whether pool_ is created (and deleted) by this parser */
+   bool own_pool_;
+   /* Each thread parses its part of buffer to this matrix */
+   std::vector<DMatrix*> thread_matrix_;
+
+   // Delete the thread pool if it is owned by this parser.
+   void free_pool();
 
  private:
   DISALLOW_COPY_AND_ASSIGN(Parser);
@@ -102,11 +145,11 @@ class LibsvmParser : public Parser {
   LibsvmParser() { }
   ~LibsvmParser() {  }
 
+ protected:
   // Parse the libsvm file
-  void Parse(char* buf, 
-             uint64 size, 
-             DMatrix& matrix,
-             bool reset = false);
+  void parse_block(const char* buf, 
+                   uint64 size, 
+                   DMatrix& matrix);
 
  private:
   DISALLOW_COPY_AND_ASSIGN(LibsvmParser);
@@ -122,11 +165,11 @@ class FFMParser : public Parser {
   FFMParser() { }
   ~FFMParser() {  }
 
+ protected:
   // Parse the libffm file
-  void Parse(char* buf, 
-             uint64 size, 
-             DMatrix& matrix,
-             bool reset = false);
+  void parse_block(const char* buf, 
+                   uint64 size, 
+                   DMatrix& matrix);
 
  private:
   DISALLOW_COPY_AND_ASSIGN(FFMParser);
@@ -140,17 +183,20 @@ class FFMParser : public Parser {
 // label y, the user should add a placeholder to the dataset
 // by themselves. Otherwise, the parser will treat the last
 // element as the label y.
+// The zero columns are skipped, since they do not change the 
+// score. The field of each column can be given by a field map
+// (SetFieldMap), so that the csv data can be used by ffm.
 //------------------------------------------------------------------------------
 class CSVParser : public Parser {
  public:
   CSVParser() { }
   ~CSVParser() { }
 
+ protected:
   // Parse the csv file
-  void Parse(char* buf, 
-             uint64 size, 
-             DMatrix& matrix,
-             bool reset = false);
+  void parse_block(const char* buf, 
+                   uint64 size, 
+                   DMatrix& matrix);
 
  private:
   DISALLOW_COPY_AND_ASSIGN(CSVParser);
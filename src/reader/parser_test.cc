@@ -20,7 +20,9 @@ This file tests parser.h file.
 
 #include "gtest/gtest.h"
 
+#include <stdio.h>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include "src/reader/parser.h"
@@ -280,6 +282,159 @@ TEST(PARSER_TEST, Parse_csv_comma) {
   RemoveFile(Kfilename.c_str());
 }
 
+// The zero columns are skipped, and the field of each
+// column is given by the field map.
+TEST(PARSER_TEST, Parse_csv_field_map) {
+  const std::string data = "1,0,0.5,0,0.25\n0,0,0,0,0\n";
+  std::vector<index_t> field_map = {0, 1, 1, 2};
+  DMatrix matrix;
+  CSVParser parser;
+  parser.setLabel(true);
+  parser.setSplitor(",");
+  parser.Parse(data.c_str(), data.size(), matrix, true);
+  ASSERT_EQ(matrix.row_length, 2);
+  ASSERT_EQ(matrix.row[0]->size(), 2);
+  EXPECT_TRUE(matrix.row[1] == nullptr);
+  EXPECT_EQ(matrix.GetRow(1)->size(), 0);
+  EXPECT_EQ(matrix.nnz, 2);
+  EXPECT_EQ(matrix.max_feat, 3);
+  EXPECT_EQ(matrix.max_field, 0);
+  EXPECT_EQ((*matrix.row[0])[0].feat_id, 1);
+  EXPECT_FLOAT_EQ((*matrix.row[0])[0].feat_val, 0.5);
+  EXPECT_EQ((*matrix.row[0])[1].feat_id, 3);
+  EXPECT_FLOAT_EQ((*matrix.row[0])[1].feat_val, 0.25);
+  EXPECT_FLOAT_EQ(matrix.norm[0], 1.0 / (0.5*0.5 + 0.25*0.25));
+  parser.SetFieldMap(field_map);
+  parser.Parse(data.c_str(), data.size(), matrix, true);
+  ASSERT_EQ(matrix.row[0]->size(), 2);
+  EXPECT_EQ((*matrix.row[0])[0].field_id, 1);
+  EXPECT_EQ((*matrix.row[0])[1].field_id, 2);
+  EXPECT_EQ(matrix.max_field, 2);
+}
+
+// Multi-thread parsing should get the same result
+// with single-thread parsing, including the order of rows.
+void check_multi_thread(Parser* parser_1, Parser* parser_2,
+                        const std::string& format) {
+  std::string data;
+  for (int i = 0; i < 200000; ++i) {
+    char line[256];
+    if (format == "libsvm") {
+      snprintf(line, 256, "%d %d:0.5 %d:0.25\n", i % 2, i, i + 1);
+    } else if (format == "libffm") {
+      snprintf(line, 256, "%d %d:%d:0.5 %d:%d:0.25\n", 
+               i % 2, i % 7, i, i % 5, i + 1);
+    } else {
+      snprintf(line, 256, "%d %d 0.5 %d\n", i % 2, i, i % 3);
+    }
+    data += line;
+  }
+  parser_1->setLabel(true);
+  parser_1->setSplitor(" ");
+  parser_2->setLabel(true);
+  parser_2->setSplitor(" ");
+  parser_2->SetThreadNumber(4);
+  DMatrix matrix_1, matrix_2;
+  parser_1->Parse((char*)data.data(), data.size(), matrix_1, true);
+  for (int n = 0; n < 2; ++n) {
+    parser_2->Parse((char*)data.data(), data.size(), matrix_2, true);
+    ASSERT_EQ(matrix_1.row_length, matrix_2.row_length);
+    EXPECT_EQ(matrix_1.max_feat, matrix_2.max_feat);
+    EXPECT_EQ(matrix_1.max_field, matrix_2.max_field);
+    EXPECT_EQ(matrix_1.nnz, matrix_2.nnz);
+    for (index_t i = 0; i < matrix_1.row_length; ++i) {
+      EXPECT_EQ(matrix_1.Y[i], matrix_2.Y[i]);
+      EXPECT_FLOAT_EQ(matrix_1.norm[i], matrix_2.norm[i]);
+      SparseRow* row_1 = matrix_1.row[i];
+      SparseRow* row_2 = matrix_2.row[i];
+      ASSERT_EQ(row_1->size(), row_2->size());
+      for (size_t j = 0; j < row_1->size(); ++j) {
+        EXPECT_EQ((*row_1)[j].field_id, (*row_2)[j].field_id);
+        EXPECT_EQ((*row_1)[j].feat_id, (*row_2)[j].feat_id);
+        EXPECT_FLOAT_EQ((*row_1)[j].feat_val, (*row_2)[j].feat_val);
+      }
+    }
+  }
+  delete parser_1;
+  delete parser_2;
+}
+
+TEST(PARSER_TEST, Parse_multi_thread) {
+  check_multi_thread(new LibsvmParser, new LibsvmParser, "libsvm");
+  check_multi_thread(new FFMParser, new FFMParser, "libffm");
+  check_multi_thread(new CSVParser, new CSVParser, "csv");
+}
+
+// Two parsers share one thread pool and parse at the same time.
+TEST(PARSER_TEST, Parse_shared_pool) {
+  std::string data;
+  for (int i = 0; i < 200000; ++i) {
+    char line[256];
+    snprintf(line, 256, "%d %d:0.5 %d:0.25\n", i % 2, i, i + 1);
+    data += line;
+  }
+  ThreadPool pool(4);
+  LibsvmParser parser[2];
+  DMatrix matrix[2];
+  std::vector<std::thread> threads;
+  for (int n = 0; n < 2; ++n) {
+    parser[n].setSplitor(" ");
+    parser[n].SetThreadPool(&pool);
+    threads.push_back(std::thread([&, n]() {
+      parser[n].Parse(data.data(), data.size(), matrix[n], true);
+    }));
+  }
+  for (int n = 0; n < 2; ++n) {
+    threads[n].join();
+  }
+  for (int n = 0; n < 2; ++n) {
+    ASSERT_EQ(matrix[n].row_length, 200000);
+    EXPECT_EQ(matrix[n].nnz, 400000);
+    for (index_t i = 0; i < matrix[n].row_length; i += 997) {
+      EXPECT_EQ(matrix[n].Y[i], i % 2);
+      EXPECT_EQ((*matrix[n].row[i])[0].feat_id, i);
+    }
+  }
+}
+
+// Parse rows of the given format, which are also used
+// by the parse benchmark (reader_benchmark parse)
+void check_generated(Parser* parser, const std::string& format) {
+  static const int kRows = 1000;
+  static const int kCols = 30;
+  std::string data;
+  char item[64];
+  for (int i = 0; i < kRows; ++i) {
+    data += (i % 2 ? "1" : "-1");
+    for (int j = 0; j < kCols; ++j) {
+      uint32 feat = (i * 7919 + j * 104729) % 1000000;
+      real_t value = (feat % 1000 + 1) / 997.0;  // non-zero
+      if (format == "libsvm") {
+        snprintf(item, 64, " %u:%.6f", feat, value);
+      } else if (format == "libffm") {
+        snprintf(item, 64, " %d:%u:%.6f", j, feat, value);
+      } else {
+        snprintf(item, 64, ",%.6f", value);
+      }
+      data += item;
+    }
+    data += "\n";
+  }
+  parser->setLabel(true);
+  parser->setSplitor(format == "csv" ? "," : " ");
+  DMatrix matrix;
+  parser->Parse((char*)data.data(), data.size(), matrix, true);
+  ASSERT_EQ(matrix.row_length, kRows);
+  EXPECT_EQ(matrix.nnz, kRows * kCols);
+  delete parser;
+}
+
+TEST(PARSER_TEST, Parse_generated) {
+  check_generated(new LibsvmParser, "libsvm");
+  check_generated(new FFMParser, "libffm");
+  check_generated(new CSVParser, "csv");
+}
+
 Parser* CreateParser(const char* format_name) {
   return CREATE_PARSER(format_name);
 }
@@ -24,6 +24,7 @@ This file is the implementation of Reader class.
 #include <algorithm> // for random_shuffle
 
 #include "src/base/file_util.h"
+#include "src/base/file_list.h"
 #include "src/base/split_string.h"
 #include "src/base/format_print.h"
 
@@ -36,21 +37,23 @@ CLASS_REGISTER_IMPLEMENT_REGISTRY(xLearn_reader_registry, Reader);
 REGISTER_READER("memory", InmemReader);
 REGISTER_READER("disk", OndiskReader);
 REGISTER_READER("dmatrix", FromDMReader);
+REGISTER_READER("multi", MultiReader);
+REGISTER_READER("stream", StreamReader);
 
 // Check current file format and
 // return 'libsvm', 'libffm', or 'csv'.
 // This function will also check if current
 // data has the label y.
 std::string Reader::check_file_format() {
-#ifndef _MSC_VER
-  FILE* file = OpenFileOrDie(filename_.c_str(), "r");
-#else
-  FILE* file = OpenFileOrDie(filename_.c_str(), "rb");
-#endif
   // get the first line of data
   std::string data_line;
-  GetLine(file, data_line);
-  Close(file);
+  get_first_line(data_line);
+  return check_line_format(data_line);
+}
+
+// Check the format of a line of data. The declared 
+// format (format_) is used if it is not empty.
+std::string Reader::check_line_format(const std::string& data_line) {
   // Find the split string
   int space_count = 0;
   int table_count = 0;
@@ -86,6 +89,8 @@ std::string Reader::check_file_format() {
   } else {
     has_label_ = true;
   }
+  // The format is declared by user
+  if (!format_.empty()) { return format_; }
   // check file format
   int count = 0;
   for (int i = 0; i < str_list[1].size(); ++i) {
@@ -104,6 +109,42 @@ std::string Reader::check_file_format() {
   exit(0);
 }
 
+// Shuffle the order of rows. For the global shuffle, we shuffle
+// the current order again. For the chunked shuffle, we rebuild the
+// order from the chunks of the sorted rows, so that each chunk is
+// contiguous in memory, and hence the seed is changed in each call
+// to get a different order in each epoch. The rows are those in
+// the order, e.g., [begin, end) for a view of another Reader.
+void Reader::shuffle_order(std::vector<index_t>& order, int seed) {
+  if (shuffle_chunk_ <= 1) {
+    srand(seed);
+    random_shuffle(order.begin(), order.end());
+    return;
+  }
+  srand(seed + shuffle_count_);
+  shuffle_count_++;
+  std::vector<index_t> rows(order);
+  std::sort(rows.begin(), rows.end());
+  size_t len = rows.size();
+  size_t num_chunk = (len + shuffle_chunk_ - 1) / shuffle_chunk_;
+  std::vector<index_t> chunk(num_chunk);
+  for (size_t i = 0; i < num_chunk; ++i) {
+    chunk[i] = i;
+  }
+  random_shuffle(chunk.begin(), chunk.end());
+  size_t pos = 0;
+  for (size_t i = 0; i < num_chunk; ++i) {
+    size_t start = (size_t)chunk[i] * shuffle_chunk_;
+    size_t end = std::min(len, start + shuffle_chunk_);
+    for (size_t j = start; j < end; ++j) {
+      order[pos + j - start] = rows[j];
+    }
+    // Shuffle inside the chunk
+    random_shuffle(order.begin() + pos, order.begin() + pos + end - start);
+    pos += end - start;
+  }
+}
+
 // Find the last '\n' in block, and shrink back file pointer
 void Reader::shrink_block(char* block, size_t* ret, FILE* file) {
   // Find the last '\n'
@@ -115,6 +156,213 @@ void Reader::shrink_block(char* block, size_t* ret, FILE* file) {
   *ret = index + 1;
 }
 
+// Create parser_ for the format of the text file.
+void Reader::init_parser() {
+  create_parser(check_file_format());
+}
+
+// Create parser_ for the given format, and
+// delete the old one if there is any.
+void Reader::create_parser(const std::string& format) {
+  free_parser();
+  parser_ = CreateParser(format.c_str());
+  if (has_label_) parser_->setLabel(true);
+  else parser_->setLabel(false);
+  // Set splitor
+  parser_->setSplitor(this->splitor_);
+  if (parse_pool_ != nullptr) {
+    parser_->SetThreadPool(parse_pool_);
+  } else {
+    parser_->SetThreadNumber(thread_number_);
+  }
+  parser_->SetFieldMap(field_map_);
+}
+
+// Hash the field map into the signature.
+static void sign_field_map(const std::vector<index_t>& field_map,
+                           FileSignature& signature) {
+  if (field_map.empty()) { return; }
+  StreamHash hash;
+  hash.Update((const char*)field_map.data(),
+              field_map.size() * sizeof(index_t));
+  signature.sample_hash ^= hash.Value();
+}
+
+// Get the signature of the text file.
+bool Reader::load_signature(FileSignature& signature) {
+  if (!signature.Load(filename_)) { return false; }
+  sign_field_map(field_map_, signature);
+  return true;
+}
+
+// Get the signature of the first length bytes of the text file.
+bool Reader::load_signature(FileSignature& signature, uint64 length) {
+  if (!signature.Load(filename_, length)) { return false; }
+  sign_field_map(field_map_, signature);
+  return true;
+}
+
+// Get the first line of the text file.
+void Reader::get_first_line(std::string& line) {
+  CompressedFile::Codec codec = CompressedFile::DetectCodec(filename_);
+  if (codec == CompressedFile::kNone) {
+#ifndef _MSC_VER
+    FILE* file = OpenFileOrDie(filename_.c_str(), "r");
+#else
+    FILE* file = OpenFileOrDie(filename_.c_str(), "rb");
+#endif
+    GetLine(file, line);
+    Close(file);
+    return;
+  }
+  CompressedFile stream;
+  stream.Open(filename_, codec);
+  line.clear();
+  char buf[4096];
+  for (;;) {
+    size_t ret = stream.Read(buf, sizeof(buf));
+    char* end = std::find(buf, buf + ret, '\n');
+    line.append(buf, end);
+    if (end != buf + ret || ret < sizeof(buf)) { break; }
+  }
+  // Remove '\r' at the end of line
+  if (!line.empty() && line.back() == '\r') { line.pop_back(); }
+}
+
+// Hash the whole content of the text file in the same
+// way as the file is parsed.
+uint64 Reader::hash_text_file() {
+  open_text_file();
+#ifndef _MSC_VER
+  FILE* file = OpenFileOrDie(filename_.c_str(), "r");
+#else
+  FILE* file = OpenFileOrDie(filename_.c_str(), "rb");
+#endif
+  StreamHash hash;
+  const char* buf = nullptr;
+  size_t ret = 0;
+  while ((ret = next_text_block(file, &buf)) > 0) {
+    hash.Update(buf, ret);
+  }
+  map_.Close();
+  stream_.Close();
+  free(block_);
+  block_ = nullptr;
+  Close(file);
+  return hash.Value();
+}
+
+// Open a compressed file as stream_, or map the text
+// file. Allocate block_ if the file cannot be mapped.
+void Reader::open_text_file() {
+  map_begin_ = 0;
+  map_pos_ = 0;
+  tail_pos_ = 0;
+  tail_size_ = 0;
+  CompressedFile::Codec codec = CompressedFile::DetectCodec(filename_);
+  if (codec != CompressedFile::kNone) {
+    Color::print_info(
+      StringPrintf("Read %s compressed file: %s",
+                   CompressedFile::CodecName(codec).c_str(),
+                   filename_.c_str())
+    );
+    stream_.Open(filename_, codec);
+  } else if (use_mmap_ && map_.Open(filename_)) {
+    map_.AdviseSequential();
+    return;
+  }
+  alloc_block();
+}
+
+// Allocate memory for block_.
+void Reader::alloc_block() {
+  this->block_ = (char*)malloc(block_size_*1024*1024);
+  if (block_ == nullptr) {
+    LOG(FATAL) << "Cannot allocate enough memory for data "
+               << "block. Block size: " 
+               << block_size_ << "MB. "
+               << "You can change the block size via configuration.";
+  }
+}
+
+// Return to the beginning of the text file.
+void Reader::rewind_text_file() {
+  map_begin_ = 0;
+  map_pos_ = 0;
+  tail_pos_ = 0;
+  tail_size_ = 0;
+  if (stream_.IsOpen()) { stream_.Rewind(); }
+}
+
+// Keep the incomplete line at the end of block_[0, ret) for
+// the next block. Return the size of the complete lines.
+size_t Reader::cut_block(size_t ret, bool eof) {
+  if (eof) {
+    tail_pos_ = 0;
+    tail_size_ = 0;
+    return ret;
+  }
+  size_t index = ret;
+  while (index > 0 && block_[index-1] != '\n') { index--; }
+  if (index == 0) {
+    LOG(FATAL) << "Cannot find a line break in the block. "
+               << "Please use a larger block size.";
+  }
+  tail_pos_ = index;
+  tail_size_ = ret - index;
+  return index;
+}
+
+// Get the next block of text file.
+size_t Reader::next_text_block(FILE* file, const char** buf) {
+  // Convert MB to Byte
+  uint64 read_byte = block_size_ * 1024 * 1024;
+  if (stream_.IsOpen()) {
+    // Move the incomplete line of the last block to the head,
+    // and then fill the rest of block_ from the stream.
+    memmove(block_, block_ + tail_pos_, tail_size_);
+    size_t ret = tail_size_ + 
+      stream_.Read(block_ + tail_size_, read_byte - tail_size_);
+    *buf = block_;
+    return cut_block(ret, ret < read_byte);
+  }
+  if (read_pipe_) {
+    // Don't wait for a full block. We return the complete
+    // lines as soon as we get them from the pipe.
+    memmove(block_, block_ + tail_pos_, tail_size_);
+    size_t ret = tail_size_;
+    bool eof = false;
+    while (ret < read_byte) {
+      size_t size = ReadDataFromPipe(file, block_ + ret, read_byte - ret);
+      if (size == 0) { eof = true; break; }
+      ret += size;
+      if (memchr(block_ + ret - size, '\n', size) != nullptr) { break; }
+    }
+    *buf = block_;
+    return cut_block(ret, eof);
+  }
+  if (map_.IsOpen()) {
+    // The last block has been parsed, and we don't
+    // need its pages in our address space.
+    map_.DontNeed(map_begin_, map_pos_ - map_begin_);
+    if (map_pos_ >= map_.Size()) { return 0; }
+    map_begin_ = map_pos_;
+    map_pos_ = map_.NextBlock(map_begin_, read_byte);
+    // Readahead the next block
+    map_.WillNeed(map_pos_, read_byte);
+    *buf = map_.Data() + map_begin_;
+    return map_pos_ - map_begin_;
+  }
+  // Read a block of data from disk file
+  size_t ret = ReadDataFromDisk(file, block_, read_byte);
+  if (ret == read_byte) {
+    // Find the last '\n', and shrink back file pointer
+    shrink_block(block_, &ret, file);
+  } // else ret < read_byte: we don't need shrink_block()
+  *buf = block_;
+  return ret;
+}
+
 //------------------------------------------------------------------------------
 // Implementation of InmemReader
 //------------------------------------------------------------------------------
@@ -128,138 +376,498 @@ void InmemReader::Initialize(const std::string& filename) {
   filename_ = filename;
   Color::print_info("First check if the text file has been already "
                     "converted to binary format.");
-  // HashBinary() will read the first two hash value
-  // and then check it whether equal to the hash value generated
-  // by HashFile() function from current txt file.
-  if (hash_binary(filename_)) {
+  // hash_binary() will read the signature of the text file
+  // from the header of the binary file, and then check whether
+  // it is equal to the signature of current text file.
+  if (hash_binary(filename_) && init_from_binary()) {
     Color::print_info(
       StringPrintf("Binary file (%s.bin) found. "
                    "Skip converting text to binary.",
                    filename_.c_str())
     );
-    filename_ += ".bin";
-    init_from_binary();
+    use_binary();
+  } else if (append_binary() && init_from_binary()) {
+    // The text file has only grown, and its new lines
+    // have been appended to the binary file.
+    use_binary();
   } else {
     Color::print_info(
       StringPrintf("Binary file (%s.bin) NOT found. Convert text "
                    "file to binary file.",
                    filename_.c_str())
     );
-    // Allocate memory for block
-    try {
-      this->block_ = (char*)malloc(block_size_*1024*1024);
-    } catch (std::bad_alloc&) {
-      LOG(FATAL) << "Cannot allocate enough memory for data  \
-                     block. Block size: " 
-                 << block_size_ << "MB. "
-                 << "You set change the block size via configuration.";
-    }
     init_from_txt();
   }
 }
 
-// Check whether current path has a binary file.
-// We use double check here, that is, we first check 
-// the hash value of a small data block, then check the whole file.
+// Sample the rows [begin, end) of another InmemReader. The
+// view has its own order_ and data_samples_, and it reads the
+// data (mmat_, cmat_ or data_buf_) of the base Reader.
+void InmemReader::InitializeView(InmemReader* base,
+                                 index_t begin,
+                                 index_t end) {
+  CHECK_NOTNULL(base);
+  CHECK_LE(begin, end);
+  CHECK_LE(end, base->RowNumber());
+  base_ = base->base_;
+  filename_ = base->filename_;
+  has_label_ = base->has_label_;
+  compress_ = base->compress_;
+  quantize_ = base->quantize_;
+  // The statistics are those of the whole data, so
+  // that the model is the same for all the views.
+  max_feat_ = base->max_feat_;
+  max_field_ = base->max_field_;
+  nnz_ = base->nnz_;
+  id_map_ = base->id_map_;
+  order_.clear();
+  for (index_t i = begin; i < end; ++i) {
+    order_.push_back(i);
+  }
+  pos_ = 0;
+  if (base_->mmat_.IsOpen() || compress_) {
+    num_samples_ = kCompressBatchSize;
+  } else {
+    num_samples_ = end - begin;
+    data_samples_.ReAlloc(num_samples_, has_label_);
+  }
+}
+
+// Number of rows of the data.
+index_t InmemReader::RowNumber() const {
+  if (base_->mmat_.IsOpen()) { return base_->mmat_.row_length; }
+  if (compress_) { return base_->cmat_.row_length; }
+  return base_->data_buf_.row_length;
+}
+
+// Read the signature of the text file from the header of the
+// binary file. Return false if the file cannot be opened, or
+// it is generated by another version.
+static bool read_bin_signature(const std::string& bin_file,
+                               FileSignature* signature) {
+  FILE* file = fopen(bin_file.c_str(), "rb");
+  if (file == nullptr) { return false; }
+  // Check the magic number and the version
+  uint64 magic = 0;
+  uint32 version = 0;
+  bool is_valid = 
+    ReadDataFromDisk(file, (char*)&magic, sizeof(magic)) == sizeof(magic) &&
+    magic == kBinMagic &&
+    ReadDataFromDisk(file, (char*)&version, sizeof(version)) == sizeof(version) &&
+    version == kBinVersion &&
+    signature->Read(file);
+  Close(file);
+  return is_valid;
+}
+
+// Move the position of the file, which can be larger than 2 GB.
+static void seek_text_file(FILE* file, uint64 offset) {
+#ifndef _MSC_VER
+  int ret = fseeko(file, offset, SEEK_SET);
+#else
+  int ret = _fseeki64(file, offset, SEEK_SET);
+#endif
+  if (ret != 0) {
+    LOG(FATAL) << "Error: invoke fseek().";
+  }
+}
+
+// Use the mapped data, which is decoded or
+// compressed for the current options.
+void InmemReader::use_binary() {
+  Color::print_info(
+    StringPrintf("Map the binary file: %d rows, %.2f MB.",
+                 mmat_.row_length,
+                 mmat_.FileSize() / (1024.0 * 1024.0))
+  );
+  if (!compress_) {
+    // The rows are decoded once, and then the samples share
+    // them in every epoch, instead of copying each batch 
+    // out of the mapped file again and again.
+    decode_mapped();
+  } else if (!mmat_.IsCompressed()) { 
+    compress_mapped(); 
+  }
+  // Otherwise, the compressed nodes are decoded from the 
+  // mapped file in place, just like the rows of cmat_.
+}
+
+// Check whether current path has a binary file. The check does
+// not depend on the size of the text file, unless verify_bin_
+// is set, and then we also hash the whole text file.
 bool InmemReader::hash_binary(const std::string& filename) {
   std::string bin_file = filename + ".bin";
   // If the ".bin" file does not exists, return false.
   if (!FileExist(bin_file.c_str())) { return false; }
+  FileSignature bin_sig;
+  if (!read_bin_signature(bin_file, &bin_sig)) {
+    Color::print_info(
+      StringPrintf("Binary file (%s) is generated by an old version "
+                   "of xLearn.", bin_file.c_str())
+    );
+    return false;
+  }
+  // Check the size, the modification time, and the sampled
+  // chunks of the text file, which does not read the whole file.
+  FileSignature sig;
+  if (!load_signature(sig) || !sig.Match(bin_sig)) { return false; }
+  if (verify_bin_) {
+    Color::print_info(
+      StringPrintf("Verify the binary file by hashing %s.",
+                   filename.c_str())
+    );
+    if (hash_text_file() != bin_sig.content_hash) { return false; }
+  }
+  return true;
+}
+
+// Write data_buf_ (or cmat_ in compressed mode) to the binary
+// file, which starts with the magic number, the version, and 
+// the signature of text file.
+void InmemReader::write_binary(const FileSignature& signature) {
+  std::string bin_file = filename_ + ".bin";
+  if (compress_) {
+    MappedMatrix::Write(bin_file, cmat_, signature);
+  } else if (bin_compress_) {
+    CompressedMatrix cmat;
+    cmat.Append(data_buf_);
+    MappedMatrix::Write(bin_file, cmat, signature);
+  } else {
+    MappedMatrix::Write(bin_file, data_buf_, signature);
+  }
+}
+
+// If the text file has only grown since the binary file was
+// generated, e.g., it is a log file, we only parse the new lines
+// and append them to the binary file. The signature of the binary
+// file records the size and the sampled chunks of the old text,
+// which must be the same as the head of the current text file.
+bool InmemReader::append_binary() {
+  // The compressed text file cannot be read from the middle.
+  if (!bin_out_ || read_pipe_ ||
+      CompressedFile::DetectCodec(filename_) != CompressedFile::kNone) {
+    return false;
+  }
+  std::string bin_file = filename_ + ".bin";
+  FileSignature bin_sig, head, signature;
+  if (!read_bin_signature(bin_file, &bin_sig) || bin_sig.size == 0 ||
+      !load_signature(signature) || signature.size <= bin_sig.size ||
+      !load_signature(head, bin_sig.size) || head.inode != bin_sig.inode ||
+      head.sample_hash != bin_sig.sample_hash) {
+    return false;
+  }
+  MappedMatrix mmat;
+  if (!mmat.Open(bin_file) || !match_binary(mmat)) { return false; }
 #ifndef _MSC_VER
-  FILE* file = OpenFileOrDie(bin_file.c_str(), "r");
+  FILE* file = OpenFileOrDie(filename_.c_str(), "r");
 #else
-  FILE* file = OpenFileOrDie(bin_file.c_str(), "rb");
+  FILE* file = OpenFileOrDie(filename_.c_str(), "rb");
 #endif
-  // Check the first hash value
-  uint64 hash_1 = 0;
-  ReadDataFromDisk(file, (char*)&hash_1, sizeof(hash_1));
-  if (hash_1 != HashFile(filename, true)) {
-    Close(file);
-    return false;
+  alloc_block();
+  // The last line of the old text must be complete. If verify_bin_
+  // is set, the old text is hashed and checked as well.
+  uint64 read_byte = block_size_ * 1024 * 1024;
+  uint64 pos = verify_bin_ ? 0 : bin_sig.size - 1;
+  seek_text_file(file, pos);
+  StreamHash content_hash;
+  char last = 0;
+  while (pos < bin_sig.size) {
+    size_t ret = ReadDataFromDisk(file, block_,
+      std::min(read_byte, bin_sig.size - pos));
+    if (ret == 0) { break; }
+    if (verify_bin_) { content_hash.Update(block_, ret); }
+    last = block_[ret-1];
+    pos += ret;
   }
-  // Check the second hash value
-  uint64 hash_2 = 0;
-  ReadDataFromDisk(file, (char*)&hash_2, sizeof(hash_2));
-  if (hash_2 != HashFile(filename, false)) {
+  if (pos != bin_sig.size || last != '\n' ||
+      (verify_bin_ && content_hash.Value() != bin_sig.content_hash)) {
+    free(block_);
+    block_ = nullptr;
     Close(file);
     return false;
   }
+  // Parse the new lines until the size of the signature, 
+  // which is loaded before the file is read.
+  init_parser();
+  DMatrix tail;
+  while (pos < signature.size) {
+    size_t ret = ReadDataFromDisk(file, block_,
+      std::min(read_byte, signature.size - pos));
+    if (ret == 0) { break; }
+    if (pos + ret < signature.size) {
+      // Find the last '\n', and shrink back file pointer
+      shrink_block(block_, &ret, file);
+    }
+    if (verify_bin_) { content_hash.Update(block_, ret); }
+    parser_->Parse(block_, ret, tail, false);
+    pos += ret;
+  }
+  free(block_);
+  block_ = nullptr;
   Close(file);
+  // The content hash is unknown if the old text is not hashed.
+  signature.content_hash = verify_bin_ ? content_hash.Value() : 0;
+  MappedMatrix::Append(bin_file, mmat, tail, signature);
+  Color::print_info(
+    StringPrintf("Text file has grown by %.2f MB. Append %d rows "
+                 "to the binary file (%s.bin).",
+                 (signature.size - bin_sig.size) / (1024.0 * 1024.0),
+                 tail.row_length, filename_.c_str())
+  );
   return true;
 }
 
-// In-memory Reader can be initialized from binary file.
-void InmemReader::init_from_binary() {
-  // Init data_buf_                               
-  data_buf_.Deserialize(filename_);
-  has_label_ = data_buf_.has_label;
-  // Init data_samples_
-  num_samples_ = data_buf_.row_length;
-  data_samples_.ReAlloc(num_samples_);
-  // for shuffle
-  order_.resize(num_samples_);
-  for (int i = 0; i < order_.size(); ++i) {
-    order_[i] = i;
+// Whether the options of the mapped file are the same as ours.
+// The quantized data is only used in the quantized mode, and 
+// the bin file is regenerated if it should be compressed.
+bool InmemReader::match_binary(const MappedMatrix& mmat) {
+  bool compress_bin = bin_compress_ || compress_;
+  return !(mmat.IsQuantized() && !quantize_) &&
+         !(compress_bin && !mmat.IsCompressed());
+}
+
+// In-memory Reader can be initialized from binary file, which
+// is mapped without parsing the text. The header has been 
+// checked by hash_binary().
+bool InmemReader::init_from_binary() {
+  if (!mmat_.Open(filename_ + ".bin")) { return false; }
+  if (!match_binary(mmat_)) {
+    Color::print_info("Binary file is generated with different options.");
+    mmat_.Close();
+    return false;
   }
+  has_label_ = mmat_.has_label;
+  max_feat_ = std::max(max_feat_, mmat_.max_feat);
+  max_field_ = std::max(max_field_, mmat_.max_field);
+  nnz_ += mmat_.nnz;
+  // In compressed mode, the rows are decoded from the mapped
+  // file to data_samples_ batch by batch in Samples().
+  num_samples_ = kCompressBatchSize;
+  // for shuffle
+  init_order(mmat_.row_length);
+  return true;
 }
 
 // Pre-load all the data to memory buffer from txt file.
 void InmemReader::init_from_txt() {
-  // Init parser_                       
-  parser_ = CreateParser(check_file_format().c_str());
-  if (has_label_) parser_->setLabel(true);
-  else parser_->setLabel(false);
-  // Set splitor
-  parser_->setSplitor(this->splitor_);
-  // Convert MB to Byte
-  uint64 read_byte = block_size_ * 1024 * 1024;
+  init_parser();
   // Open file
 #ifndef _MSC_VER
   FILE* file = OpenFileOrDie(filename_.c_str(), "r");
 #else
   FILE* file = OpenFileOrDie(filename_.c_str(), "rb");
 #endif
+  // The signature is loaded before reading the file, and the
+  // content is hashed when it is parsed for the bin file.
+  FileSignature signature;
+  bool write_bin = bin_out_ && load_signature(signature);
+  StreamHash content_hash;
+  open_text_file();
+  cmat_.SetQuantize(quantize_);
   // Read until the end of file
   for (;;) {
-    // Read a block of data from disk file
-    size_t ret = ReadDataFromDisk(file, block_, read_byte);
-    if (ret == 0) {
-      break;
-    } else if (ret == read_byte) {
-      // Find the last '\n', and shrink back file pointer
-      this->shrink_block(block_, &ret, file);
-    } // else ret < read_byte: we don't need shrink_block()
-    parser_->Parse(block_, ret, data_buf_, false);
+    const char* buf = nullptr;
+    size_t ret = next_text_block(file, &buf);
+    if (ret == 0) { break; }
+    if (write_bin) { content_hash.Update(buf, ret); }
+    if (compress_) {
+      // Parse each block into a small buffer, and then
+      // compress it, so that the uncompressed data never
+      // stays in memory.
+      parser_->Parse(buf, ret, data_samples_, true);
+      update_stats(data_samples_);
+      cmat_.Append(data_samples_);
+    } else {
+      parser_->Parse(buf, ret, data_buf_, false);
+    }
+  }
+  map_.Close();
+  stream_.Close();
+  if (compress_) {
+    data_samples_.Reset();
+    cmat_.has_label = has_label_;
+    num_samples_ = kCompressBatchSize;
+    init_order(cmat_.row_length);
+    print_compress_info();
+    // The bin file is written from the compressed data.
+    if (write_bin) {
+      signature.content_hash = content_hash.Value();
+      write_binary(signature);
+    }
+    free(block_);
+    block_ = nullptr;
+    Close(file);
+    return;
   }
-  data_buf_.SetHash(HashFile(filename_, true),
-                    HashFile(filename_, false));
   data_buf_.has_label = has_label_;
+  update_stats(data_buf_);
   // Init data_samples_ 
   num_samples_ = data_buf_.row_length;
   data_samples_.ReAlloc(num_samples_, has_label_);
   // for shuffle
-  order_.resize(num_samples_);
-  for (int i = 0; i < order_.size(); ++i) {
-    order_[i] = i;
-  }
+  init_order(num_samples_);
   // Deserialize in-memory buffer to disk file.
-  if (bin_out_) {
-    std::string bin_file = filename_ + ".bin";
-    data_buf_.Serialize(bin_file);
+  if (write_bin) {
+    signature.content_hash = content_hash.Value();
+    write_binary(signature);
   }
-  delete [] block_;
+  free(block_);
+  block_ = nullptr;
   Close(file);
 }
 
+// Move the mapped data into the compressed matrix. The rows
+// are copied and compressed batch by batch, so that the
+// uncompressed data never stays in memory.
+void InmemReader::compress_mapped() {
+  cmat_.SetQuantize(quantize_);
+  for (index_t i = 0; i < mmat_.row_length; i += kCompressBatchSize) {
+    data_samples_.Recycle();
+    index_t end = std::min(mmat_.row_length, i + kCompressBatchSize);
+    for (index_t j = i; j < end; ++j) {
+      mmat_.CopyRow(j, data_samples_);
+    }
+    cmat_.Append(data_samples_);
+  }
+  cmat_.has_label = mmat_.has_label;
+  mmat_.Close();
+  data_samples_.Reset();
+  num_samples_ = kCompressBatchSize;
+  print_compress_info();
+}
+
+// Minimal number of rows that are decoded by a thread.
+static const index_t kMinDecodeRows = 10000;
+
+// Decode (or copy) the mapped data into data_buf_. Each row
+// can be decoded independently, and hence the rows are split 
+// into parts, which are decoded in parallel.
+void InmemReader::decode_mapped() {
+  index_t row_length = mmat_.row_length;
+  data_buf_.ReAlloc(row_length, has_label_);
+  for (index_t i = 0; i < row_length; ++i) {
+    data_buf_.Y[i] = mmat_.Label(i);
+    data_buf_.norm[i] = mmat_.Norm(i);
+  }
+  auto decode_rows = [this](index_t begin, index_t end) {
+    for (index_t i = begin; i < end; ++i) {
+      if (mmat_.RowSize(i) == 0) { continue; }
+      data_buf_.row[i] = new SparseRow;
+      mmat_.GetRow(i, *(data_buf_.row[i]));
+    }
+  };
+  index_t num_part = std::min((index_t)thread_number_,
+                              row_length / kMinDecodeRows);
+  if (num_part <= 1) {
+    decode_rows(0, row_length);
+  } else {
+    ThreadPool pool(num_part);
+    index_t part_size = (row_length + num_part - 1) / num_part;
+    for (index_t p = 0; p < num_part; ++p) {
+      index_t begin = p * part_size;
+      index_t end = std::min(row_length, begin + part_size);
+      pool.enqueue(decode_rows, begin, end);
+    }
+    pool.Sync(num_part);
+  }
+  data_buf_.max_feat = mmat_.max_feat;
+  data_buf_.max_field = mmat_.max_field;
+  data_buf_.nnz = mmat_.nnz;
+  mmat_.Close();
+  // Init data_samples_
+  num_samples_ = data_buf_.row_length;
+  data_samples_.ReAlloc(num_samples_, has_label_);
+}
+
+// Map the feature ids of data_buf_ in place, in parallel. The rows
+// of data_buf_ are shared by the samples and by the views, so they
+// must be mapped only once. The rows of the compressed data are 
+// decoded in each batch, and they are mapped in Samples().
+void InmemReader::SetFeatureMap(const FeatureIdMap* id_map) {
+  if (id_map == id_map_) { return; }
+  CHECK(id_map_ == nullptr);
+  id_map_ = id_map;
+  if (base_ != this || mmat_.IsOpen() || compress_) { return; }
+  index_t num_thread = std::min((index_t)thread_number_,
+                                data_buf_.row_length / kMinDecodeRows);
+  uint64 dropped = 0;
+  if (num_thread <= 1) {
+    dropped = id_map_->Remap(data_buf_);
+  } else {
+    ThreadPool pool(num_thread);
+    dropped = id_map_->Remap(data_buf_, &pool);
+  }
+  LOG(INFO) << "Map the feature ids of " << data_buf_.row_length
+            << " rows, and drop " << dropped << " features.";
+}
+
+// Print the memory size of the compressed matrix.
+void InmemReader::print_compress_info() {
+  Color::print_info(
+    StringPrintf("Compressed data: %d rows, %.2f MB.",
+                 cmat_.row_length,
+                 cmat_.MemorySize() / (1024.0 * 1024.0))
+  );
+}
+
+// Decode the next batch of rows in order_ from the
+// compressed matrix. The SparseRow in data_samples_ are
+// recycled between batches, so that decoding does not
+// allocate memory after the first batch.
+index_t InmemReader::samples_from_compressed(DMatrix* &matrix) {
+  if (pos_ >= order_.size()) {
+    // End of the data buffer
+    if (shuffle_) {
+      shuffle_order(order_, this->seed_+1);
+    }
+    matrix = nullptr;
+    return 0;
+  }
+  data_samples_.Recycle();
+  index_t end = std::min((index_t)order_.size(), pos_ + num_samples_);
+  for (; pos_ < end; ++pos_) {
+    base_->cmat_.DecodeRow(order_[pos_], data_samples_);
+  }
+  if (id_map_ != nullptr) { id_map_->Remap(data_samples_); }
+  data_samples_.has_label = has_label_;
+  matrix = &data_samples_;
+  return data_samples_.row_length;
+}
+
+// Copy the next batch of rows in order_ from the mapped
+// binary file. Like samples_from_compressed(), the SparseRow 
+// in data_samples_ are recycled between batches.
+index_t InmemReader::samples_from_mapped(DMatrix* &matrix) {
+  if (pos_ >= order_.size()) {
+    // End of the data buffer
+    if (shuffle_) {
+      shuffle_order(order_, this->seed_+1);
+    }
+    matrix = nullptr;
+    return 0;
+  }
+  data_samples_.Recycle();
+  index_t end = std::min((index_t)order_.size(), pos_ + num_samples_);
+  for (; pos_ < end; ++pos_) {
+    base_->mmat_.CopyRow(order_[pos_], data_samples_);
+  }
+  if (id_map_ != nullptr) { id_map_->Remap(data_samples_); }
+  data_samples_.has_label = has_label_;
+  matrix = &data_samples_;
+  return data_samples_.row_length;
+}
+
 // Sample data from memory buffer.
 index_t InmemReader::Samples(DMatrix* &matrix) {
+  if (base_->mmat_.IsOpen()) { return samples_from_mapped(matrix); }
+  if (compress_) { return samples_from_compressed(matrix); }
+  const DMatrix& data_buf = base_->data_buf_;
   for (int i = 0; i < num_samples_; ++i) {
-    if (pos_ >= data_buf_.row_length) {
+    if (pos_ >= order_.size()) {
       // End of the data buffer
       if (i == 0) {
         if (shuffle_) {
-          srand(this->seed_+1);
-          random_shuffle(order_.begin(), order_.end());
+          shuffle_order(order_, this->seed_+1);
         }
         matrix = nullptr;
         return 0;
@@ -267,9 +875,9 @@ index_t InmemReader::Samples(DMatrix* &matrix) {
       break;
     }
     // Copy data between different DMatrix.
-    data_samples_.row[i] = data_buf_.row[order_[pos_]];
-    data_samples_.Y[i] = data_buf_.Y[order_[pos_]];
-    data_samples_.norm[i] = data_buf_.norm[order_[pos_]];
+    data_samples_.row[i] = data_buf.row[order_[pos_]];
+    data_samples_.Y[i] = data_buf.Y[order_[pos_]];
+    data_samples_.norm[i] = data_buf.norm[order_[pos_]];
     pos_++;
   }
   matrix = &data_samples_;
@@ -287,59 +895,388 @@ void InmemReader::Reset() { pos_ = 0; }
 void OndiskReader::Initialize(const std::string& filename) {
   CHECK_NE(filename.empty(), true);
   this->filename_ = filename;
-  // Init parser_                                 
-  parser_ = CreateParser(check_file_format().c_str());
-  if (has_label_) parser_->setLabel(true);
-  else parser_->setLabel(false);
-  // Set splitor
-  parser_->setSplitor(this->splitor_);
-  // Allocate memory for block
-  try {
-    this->block_ = (char*)malloc(block_size_*1024*1024);
-  } catch (std::bad_alloc&) {
-    LOG(FATAL) << "Cannot allocate enough memory for data  \
-                   block. Block size: " 
-               << block_size_ << "MB. "
-               << "You set change the block size via configuration.";
-  }
+  init_parser();
+  cache_.SetMemoryBudget((uint64)mem_budget_ * 1024 * 1024);
+  // Check the binary cache before the text file is opened, 
+  // because verifying the cache needs to hash the text file.
+  bool use_cache = load_cache();
+  // Map the file or allocate memory for block
+  open_text_file();
   // Open file
 #ifndef _MSC_VER
   file_ptr_ = OpenFileOrDie(filename_.c_str(), "r");
 #else
   file_ptr_ = OpenFileOrDie(filename_.c_str(), "rb");
 #endif
+  Reset();
+  // Get the statistics of data from the binary cache, or
+  // parse the whole file once and generate the cache. The
+  // prediction does not need them, and reads the file once.
+  if (use_cache) {
+    Color::print_info(
+      StringPrintf("Load the binary cache: %d blocks, %.2f MB.",
+                   cache_.ChunkNumber(),
+                   cache_.FileSize() / (1024.0 * 1024.0))
+    );
+  } else if (need_stats_) {
+    scan_file(bin_out_);
+  }
+  if (need_stats_ && mem_budget_ > 0 && !cache_.IsOpen()) {
+    Color::print_warning(
+      "The memory budget (-mem_budget) needs the binary cache "
+      "of on-disk training, which is disabled by --no-bin."
+    );
+  }
+}
+
+// Open the binary cache. Like the bin file of InmemReader, the
+// cache is checked by the signature of the text file, and the 
+// whole text file is hashed only if verify_bin_ is set. Since
+// each chunk is a block, the block size must not change.
+bool OndiskReader::load_cache() {
+  std::string cache_file = CacheFile();
+  if (!cache_.Open(cache_file)) { return false; }
+  FileSignature sig;
+  if (cache_.block_size != block_size_ ||
+      !load_signature(sig) || !sig.Match(cache_.Signature())) {
+    cache_.Close();
+    return false;
+  }
+  if (verify_bin_) {
+    Color::print_info(
+      StringPrintf("Verify the binary cache by hashing %s.",
+                   filename_.c_str())
+    );
+    if (hash_text_file() != cache_.Signature().content_hash) {
+      cache_.Close();
+      return false;
+    }
+  }
+  max_feat_ = cache_.max_feat;
+  max_field_ = cache_.max_field;
+  nnz_ = cache_.nnz;
+  return true;
+}
+
+// Parse the whole file once to get the statistics, which are
+// needed to allocate the model before the first epoch. Since the
+// text is parsed here anyway, this pass (instead of the first 
+// epoch) fills the binary cache, and all the epochs read the 
+// cache. The signature is loaded before parsing, so a file that
+// is modified during the pass does not match the cache.
+void OndiskReader::scan_file(bool write_cache) {
+  BlockCache writer;
+  FileSignature signature;
+  StreamHash hash;
+  if (write_cache && load_signature(signature)) {
+    writer.Create(CacheFile());
+    writer.block_size = block_size_;
+    text_hash_ = &hash;
+  } else {
+    write_cache = false;
+  }
+  DMatrix* matrix = nullptr;
+  while (Samples(matrix)) {
+    update_stats(*matrix);
+    if (write_cache) { writer.Append(*matrix); }
+  }
+  stop_prefetch();
+  text_hash_ = nullptr;
+  if (write_cache) {
+    signature.content_hash = hash.Value();
+    writer.Finish(signature);
+    cache_.Open(CacheFile());
+  }
+  Reset();
 }
 
 // Return to the beginning of the file
 void OndiskReader::Reset() {
+  stop_prefetch();
   int ret = fseek(file_ptr_, 0, SEEK_SET);
   if (ret != 0) {
     LOG(FATAL) << "Fail to return to the head of file.";
   }
+  window_.Reset();
+  block_pos_ = 0;
+  rewind_text_file();
+  if (shuffle_) {
+    int seed = seed_ + shuffle_count_++;
+    window_rng_.seed(seed);
+    if (!shuffle_block()) { return; }
+    if (cache_.IsOpen()) {
+      block_order_.resize(cache_.ChunkNumber());
+    } else {
+      if (block_offset_.empty()) { build_block_index(); }
+      block_order_.resize(block_offset_.size() - 1);
+    }
+    for (index_t i = 0; i < block_order_.size(); ++i) {
+      block_order_[i] = i;
+    }
+    std::mt19937 rng(seed);
+    std::shuffle(block_order_.begin(), block_order_.end(), rng);
+  }
+}
+
+// Split the file into blocks in the same way as shrink_block(),
+// i.e., each block ends with the last '\n' within block_size_.
+// We only read a small chunk at the end of each block, so 
+// building the index is much cheaper than a pass of the data.
+void OndiskReader::build_block_index() {
+  static const uint64 kScanSize = 64 * 1024;  // 64 KB
+  std::vector<char> buf(kScanSize);
+  uint64 file_size = GetFileSize(file_ptr_);
+  uint64 read_byte = block_size_ * 1024 * 1024;
+  uint64 pos = 0;
+  block_offset_.clear();
+  while (pos < file_size) {
+    block_offset_.push_back(pos);
+    if (file_size - pos <= read_byte) { break; }
+    // Find the last '\n' in [pos, pos + read_byte)
+    uint64 end = pos + read_byte;
+    uint64 next = pos;
+    while (end > pos && next == pos) {
+      uint64 begin = end - std::min(kScanSize, end - pos);
+      seek_text_file(file_ptr_, begin);
+      ReadDataFromDisk(file_ptr_, buf.data(), end - begin);
+      for (uint64 i = end - begin; i > 0; --i) {
+        if (buf[i-1] == '\n') {
+          next = begin + i;
+          break;
+        }
+      }
+      end = begin;
+    }
+    if (next == pos) {
+      LOG(FATAL) << "Cannot find a line break in the block. "
+                 << "Please use a larger block size.";
+    }
+    pos = next;
+  }
+  block_offset_.push_back(file_size);
+  seek_text_file(file_ptr_, 0);
+  LOG(INFO) << "Number of blocks in " << filename_ << ": " 
+            << block_offset_.size() - 1;
+}
+
+// Read the next block from file and parse it to the matrix.
+index_t OndiskReader::read_raw_block(DMatrix& matrix) {
+  // Read the chunks of the binary cache, which are never empty.
+  if (cache_.IsOpen()) {
+    index_t id = block_pos_;
+    if (shuffle_block()) {
+      if (block_pos_ >= block_order_.size()) { return 0; }
+      id = block_order_[block_pos_];
+    } else if (block_pos_ >= cache_.ChunkNumber()) {
+      return 0;
+    }
+    block_pos_++;
+    cache_.ReadChunk(id, matrix);
+    if (id_map_ != nullptr) { id_map_->Remap(matrix); }
+    return matrix.row_length;
+  }
+  // A block of empty lines has no row, so we read the next one.
+  do {
+    const char* buf = nullptr;
+    size_t ret = 0;
+    if (shuffle_block()) {
+      if (block_pos_ >= block_order_.size()) { return 0; }
+      index_t id = block_order_[block_pos_++];
+      uint64 size = block_offset_[id+1] - block_offset_[id];
+      if (map_.IsOpen()) {
+        buf = map_.Data() + block_offset_[id];
+      } else {
+        seek_text_file(file_ptr_, block_offset_[id]);
+        CHECK_EQ(ReadDataFromDisk(file_ptr_, block_, size), size);
+        buf = block_;
+      }
+      ret = size;
+    } else {
+      ret = next_text_block(file_ptr_, &buf);
+      if (ret == 0) { return 0; }
+      if (text_hash_ != nullptr) { text_hash_->Update(buf, ret); }
+    }
+    // Parse block to matrix
+    parser_->Parse(buf, ret, matrix, true);
+    if (shuffle_block() && map_.IsOpen()) {
+      map_.DontNeed(buf - map_.Data(), ret);
+    }
+  } while (matrix.row_length == 0);
+  if (id_map_ != nullptr) { id_map_->Remap(matrix); }
+  return matrix.row_length;
+}
+
+// Read a block from file and pass it through the shuffle buffer.
+index_t OndiskReader::read_block(DMatrix& matrix) {
+  if (!shuffle_ || shuffle_window_ == 0) {
+    return read_raw_block(matrix);
+  }
+  for (;;) {
+    if (read_raw_block(matrix) == 0) {
+      return flush_window(matrix);
+    }
+    shuffle_window(matrix);
+    if (matrix.row_length > 0) {
+      matrix.UpdateStats();
+      return matrix.row_length;
+    }
+  }
+}
+
+// The first shuffle_window_ rows fill the buffer. After that, each
+// new row replaces a random row of the buffer, and the replaced row
+// is returned in the matrix. The rows are moved, not copied.
+void OndiskReader::shuffle_window(DMatrix& matrix) {
+  index_t out = 0;
+  for (index_t i = 0; i < matrix.row_length; ++i) {
+    if (window_.row_length < shuffle_window_) {
+      window_.row.push_back(matrix.row[i]);
+      window_.Y.push_back(matrix.Y[i]);
+      window_.norm.push_back(matrix.norm[i]);
+      window_.row_length++;
+      continue;
+    }
+    index_t j = window_rng_() % shuffle_window_;
+    std::swap(matrix.row[i], window_.row[j]);
+    std::swap(matrix.Y[i], window_.Y[j]);
+    std::swap(matrix.norm[i], window_.norm[j]);
+    matrix.row[out] = matrix.row[i];
+    matrix.Y[out] = matrix.Y[i];
+    matrix.norm[out] = matrix.norm[i];
+    out++;
+  }
+  // The rows after 'out' have been moved to the buffer
+  // or to the front of the matrix.
+  matrix.row.resize(out);
+  matrix.Y.resize(out);
+  matrix.norm.resize(out);
+  matrix.row_length = out;
+}
+
+// Return the remaining rows in the buffer at the end of file.
+index_t OndiskReader::flush_window(DMatrix& matrix) {
+  index_t num = window_.row_length;
+  if (num == 0) { return 0; }
+  for (index_t i = num - 1; i > 0; --i) {
+    index_t j = window_rng_() % (i + 1);
+    std::swap(window_.row[i], window_.row[j]);
+    std::swap(window_.Y[i], window_.Y[j]);
+    std::swap(window_.norm[i], window_.norm[j]);
+  }
+  matrix.Recycle();
+  matrix.MoveFrom(window_);
+  matrix.UpdateStats();
+  return num;
+}
+
+// Free the prefetch buffers and their rows. The destructor
+// of DMatrix only frees the recycled rows, so we have to
+// Reset() each buffer before it is deleted.
+void OndiskReader::free_prefetch_buf() {
+  for (size_t i = 0; i < prefetch_buf_.size(); ++i) {
+    prefetch_buf_[i]->Reset();
+  }
+  STLDeleteElementsAndClear(&prefetch_buf_);
+}
+
+// Start the prefetch thread from current file position.
+void OndiskReader::start_prefetch() {
+  if (prefetch_buf_.size() != prefetch_ + 1) {
+    free_prefetch_buf();
+    for (int i = 0; i < prefetch_ + 1; ++i) {
+      prefetch_buf_.push_back(new DMatrix);
+    }
+  }
+  // All the buffers are free now
+  free_buf_ = std::queue<DMatrix*>();
+  ready_buf_ = std::queue<DMatrix*>();
+  for (size_t i = 0; i < prefetch_buf_.size(); ++i) {
+    free_buf_.push(prefetch_buf_[i]);
+  }
+  current_ = nullptr;
+  prefetch_stop_ = false;
+  prefetch_end_ = false;
+  prefetch_thread_ = std::thread(&OndiskReader::prefetch_loop, this);
+}
+
+// Stop the prefetch thread. The thread will finish 
+// the block it is parsing before exit.
+void OndiskReader::stop_prefetch() {
+  if (!prefetch_thread_.joinable()) { return; }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    prefetch_stop_ = true;
+  }
+  cond_.notify_all();
+  prefetch_thread_.join();
+  current_ = nullptr;
+}
+
+// The prefetch thread fills the free buffers until it
+// reaches the end of file or it is stopped by Reset().
+void OndiskReader::prefetch_loop() {
+  for (;;) {
+    DMatrix* matrix = nullptr;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      cond_.wait(lock, [this] { 
+        return prefetch_stop_ || !free_buf_.empty(); 
+      });
+      if (prefetch_stop_) { return; }
+      matrix = free_buf_.front();
+      free_buf_.pop();
+    }
+    index_t num = read_block(*matrix);
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (num == 0) {
+        prefetch_end_ = true;
+      } else {
+        ready_buf_.push(matrix);
+      }
+    }
+    cond_.notify_all();
+    if (num == 0) { return; }
+  }
 }
 
 // Sample data from disk file.
 index_t OndiskReader::Samples(DMatrix* &matrix) {
-  // Convert MB to Byte
-  uint64 read_byte = block_size_ * 1024 * 1024;
-  // Read a block of data from disk file
-  size_t ret = ReadDataFromDisk(file_ptr_, block_, read_byte);
-  if (ret == 0) {
+  if (prefetch_ == 0) {
+    if (read_block(data_samples_) == 0) {
+      matrix = nullptr;
+      return 0;
+    }
+    matrix = &data_samples_;
+    return data_samples_.row_length;
+  }
+  if (!prefetch_thread_.joinable()) {
+    start_prefetch();
+  }
+  std::unique_lock<std::mutex> lock(mutex_);
+  // The last block has been used
+  if (current_ != nullptr) {
+    free_buf_.push(current_);
+    current_ = nullptr;
+    cond_.notify_all();
+  }
+  cond_.wait(lock, [this] { 
+    return !ready_buf_.empty() || prefetch_end_; 
+  });
+  if (ready_buf_.empty()) {  // end of file
     matrix = nullptr;
     return 0;
-  } else if (ret == read_byte) {
-    // Find the last '\n', and shrink back file pointer
-    shrink_block(block_, &ret, file_ptr_);
-  } // else ret < read_byte: we don't need shrink_block()
-  // Parse block to data_sample_
-  parser_->Parse(block_, ret, data_samples_, true);
-  matrix = &data_samples_;
-  return data_samples_.row_length;
+  }
+  current_ = ready_buf_.front();
+  ready_buf_.pop();
+  matrix = current_;
+  return current_->row_length;
 }
 
 void FromDMReader::Initialize(xLearn::DMatrix* &dmatrix) { 
   this->data_ptr_ = dmatrix;
   has_label_ = this->data_ptr_->has_label;
+  update_stats(*data_ptr_);
   num_samples_ = this->data_ptr_->row_length;
   data_samples_.ReAlloc(num_samples_, has_label_);
   // for shuffle
@@ -349,6 +1286,26 @@ void FromDMReader::Initialize(xLearn::DMatrix* &dmatrix) {
   }
 }
 
+// The DMatrix belongs to the caller, and it may be used
+// again, so its rows are copied before they are mapped.
+void FromDMReader::SetFeatureMap(const FeatureIdMap* id_map) {
+  if (id_map == id_map_) { return; }
+  CHECK(id_map_ == nullptr);
+  id_map_ = id_map;
+  if (id_map_ == nullptr) { return; }
+  const DMatrix* origin = data_ptr_;
+  data_copy_.ReAlloc(origin->row_length, origin->has_label);
+  for (index_t i = 0; i < origin->row_length; ++i) {
+    data_copy_.Y[i] = origin->Y[i];
+    data_copy_.norm[i] = origin->norm[i];
+    const SparseRow* row = origin->row[i];
+    if (row == nullptr) { continue; }
+    data_copy_.AddNodes(i, row->data(), row->data() + row->size());
+  }
+  id_map_->Remap(data_copy_);
+  data_ptr_ = &data_copy_;
+}
+
 // Sample data from memory buffer.
 index_t FromDMReader::Samples(DMatrix* &matrix) {
   for (int i = 0; i < num_samples_; ++i) {
@@ -356,8 +1313,7 @@ index_t FromDMReader::Samples(DMatrix* &matrix) {
       // End of the data buffer
       if (i == 0) {
         if (shuffle_) {
-          srand(this->seed_+1);
-          random_shuffle(order_.begin(), order_.end());
+          shuffle_order(order_, this->seed_+1);
         }
         matrix = nullptr;
         return 0;
@@ -374,4 +1330,226 @@ index_t FromDMReader::Samples(DMatrix* &matrix) {
   return num_samples_;
 }
 
-}  // namespace xLearn
+//------------------------------------------------------------------------------
+// Implementation of StreamReader.
+//------------------------------------------------------------------------------
+
+// Open the pipe and read the first block, which is 
+// used to check the split string and the label.
+void StreamReader::Initialize(const std::string& filename) {
+  CHECK_NE(filename.empty(), true);
+  if (format_.empty()) {
+    LOG(FATAL) << "The format of the stream " << filename 
+               << " must be declared, e.g., -format libsvm.";
+  }
+  filename_ = filename;
+  if (filename_ == "-") {
+    file_ptr_ = stdin;
+#ifdef _MSC_VER
+    _setmode(_fileno(stdin), _O_BINARY);
+#endif
+  } else {
+    file_ptr_ = OpenFileOrDie(filename_.c_str(), "rb");
+  }
+  read_pipe_ = true;
+  tail_pos_ = 0;
+  tail_size_ = 0;
+  alloc_block();
+  first_size_ = next_text_block(file_ptr_, &first_buf_);
+  started_ = false;
+  // Empty stream
+  has_label_ = false;
+  if (first_size_ == 0) { return; }
+  // Init parser_
+  const char* end = std::find(first_buf_, first_buf_ + first_size_, '\n');
+  std::string line(first_buf_, end);
+  if (!line.empty() && line.back() == '\r') { line.pop_back(); }
+  create_parser(check_line_format(line));
+}
+
+// Sample data from the pipe. The first block has 
+// been read in Initialize().
+index_t StreamReader::Samples(DMatrix* &matrix) {
+  CHECK_NOTNULL(file_ptr_);
+  for (;;) {
+    const char* buf = first_buf_;
+    size_t size = first_size_;
+    if (started_) {
+      size = next_text_block(file_ptr_, &buf);
+    }
+    started_ = true;
+    if (size == 0) {
+      matrix = nullptr;
+      return 0;
+    }
+    parser_->Parse(buf, size, data_samples_, true);
+    // Skip the blocks of empty lines
+    if (data_samples_.row_length > 0) {
+      if (id_map_ != nullptr) { id_map_->Remap(data_samples_); }
+      matrix = &data_samples_;
+      return data_samples_.row_length;
+    }
+  }
+}
+
+// The pipe cannot return to the beginning.
+void StreamReader::Reset() {
+  if (started_) {
+    LOG(FATAL) << "The stream " << filename_ << " can be read "
+               << "only once.";
+  }
+}
+
+// Close the pipe and free the memory.
+void StreamReader::Clear() {
+  data_samples_.Reset();
+  free_parser();
+  if (file_ptr_ != nullptr && file_ptr_ != stdin) {
+    Close(file_ptr_);
+  }
+  file_ptr_ = nullptr;
+  free(block_);
+  block_ = nullptr;
+}
+
+//------------------------------------------------------------------------------
+// Implementation of MultiReader.
+//------------------------------------------------------------------------------
+
+// Expand the file list and initialize the reader of each shard.
+void MultiReader::Initialize(const std::string& filename) {
+  CHECK_NE(filename.empty(), true);
+  filename_ = filename;
+  if (!ExpandFileList(filename_, &file_list_)) {
+    LOG(FATAL) << "No data file is found in " << filename_;
+  }
+  Color::print_info(
+    StringPrintf("Read %d files from %s", 
+                 (int)file_list_.size(), filename_.c_str())
+  );
+  size_t num_shard = file_list_.size();
+  // The shards parse their text with the same threads, so
+  // the number of threads does not grow with the shards.
+  if (thread_number_ > 1 && shard_pool_ == nullptr) {
+    shard_pool_ = new ThreadPool(thread_number_);
+  }
+  reader_list_.resize(num_shard, nullptr);
+  for (size_t i = 0; i < num_shard; ++i) {
+    reader_list_[i] = CREATE_READER(type_.c_str());
+    init_shard(reader_list_[i]);
+  }
+  // Initialize the shards in parallel
+  ThreadPool pool(std::min(reader_threads_, (int)num_shard));
+  for (size_t i = 0; i < num_shard; ++i) {
+    pool.enqueue([this, i]() {
+      reader_list_[i]->Initialize(file_list_[i]);
+    });
+  }
+  pool.Sync(num_shard);
+  // Merge the statistics
+  has_label_ = reader_list_[0]->has_label();
+  max_feat_ = 0;
+  max_field_ = 0;
+  nnz_ = 0;
+  for (size_t i = 0; i < num_shard; ++i) {
+    if (reader_list_[i]->has_label() != has_label_) {
+      LOG(FATAL) << file_list_[i] << " and " << file_list_[0]
+                 << " should both have (or not have) the label y.";
+    }
+    max_feat_ = std::max(max_feat_, reader_list_[i]->MaxFeat());
+    max_field_ = std::max(max_field_, reader_list_[i]->MaxField());
+    nnz_ += reader_list_[i]->NNZ();
+  }
+  Reset();
+}
+
+// Set the options of this reader to a shard.
+void MultiReader::init_shard(Reader* reader) {
+  CHECK_NOTNULL(reader);
+  reader->SetBlockSize(block_size_);
+  reader->SetPrefetch(prefetch_);
+  // The memory budget is shared by the shards
+  reader->SetMemoryBudget(mem_budget_ / file_list_.size());
+  reader->SetSeed(seed_);
+  reader->SetShuffleChunk(shuffle_chunk_);
+  reader->SetShuffleWindow(shuffle_window_);
+  reader->SetMmap(use_mmap_);
+  // The parse threads are shared by all the shards
+  reader->SetThreadNumber(thread_number_);
+  if (shard_pool_ != nullptr) { reader->SetParsePool(shard_pool_); }
+  if (!bin_out_) { reader->SetNoBin(); }
+  reader->SetNeedStats(need_stats_);
+  if (compress_) { reader->SetCompress(true, quantize_); }
+  reader->SetVerifyBin(verify_bin_);
+  reader->SetBinCompress(bin_compress_);
+  reader->SetFormat(format_);
+  reader->SetFieldMap(field_map_);
+  reader->SetFeatureMap(id_map_);
+}
+
+// Sample data from the shards. The active shards are 
+// sampled in turn until all of them reach the end.
+index_t MultiReader::Samples(DMatrix* &matrix) {
+  for (;;) {
+    while (active_.size() < reader_threads_ && next_ < order_.size()) {
+      active_.push_back(order_[next_++]);
+    }
+    if (active_.empty()) { break; }
+    turn_ %= active_.size();
+    index_t ret = reader_list_[active_[turn_]]->Samples(matrix);
+    if (ret > 0) {
+      turn_++;
+      return ret;
+    }
+    // The shard reaches the end, and we open the next one.
+    active_.erase(active_.begin() + turn_);
+  }
+  matrix = nullptr;
+  return 0;
+}
+
+// Return to the beginning of the data.
+void MultiReader::Reset() {
+  for (size_t i = 0; i < reader_list_.size(); ++i) {
+    reader_list_[i]->Reset();
+  }
+  order_.resize(reader_list_.size());
+  for (size_t i = 0; i < order_.size(); ++i) {
+    order_[i] = i;
+  }
+  if (shuffle_files_) {
+    std::mt19937 rng(seed_ + shuffle_count_++);
+    std::shuffle(order_.begin(), order_.end(), rng);
+  }
+  active_.clear();
+  next_ = 0;
+  turn_ = 0;
+}
+
+// Free the memory of all the shards.
+void MultiReader::Clear() {
+  // The parsers of the shards use shard_pool_
+  STLDeleteElementsAndClear(&reader_list_);
+  delete shard_pool_;
+  shard_pool_ = nullptr;
+  order_.clear();
+  active_.clear();
+}
+
+// Set the map of feature ids to all the shards.
+void MultiReader::SetFeatureMap(const FeatureIdMap* id_map) {
+  id_map_ = id_map;
+  for (size_t i = 0; i < reader_list_.size(); ++i) {
+    reader_list_[i]->SetFeatureMap(id_map);
+  }
+}
+
+// If shuffle data ?
+void MultiReader::SetShuffle(bool shuffle) {
+  shuffle_ = shuffle;
+  for (size_t i = 0; i < reader_list_.size(); ++i) {
+    reader_list_[i]->SetShuffle(shuffle);
+  }
+}
+
+} // namespace xLearn
@@ -25,18 +25,31 @@ reading data from data source.
 #include <string>
 #include <vector>
 #include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <queue>
+#include <random>
 #include <algorithm>
 
 #include "src/base/common.h"
 #include "src/base/class_register.h"
 #include "src/base/scoped_ptr.h"
+#include "src/base/mapped_file.h"
+#include "src/base/compressed_file.h"
+#include "src/base/file_signature.h"
+#include "src/base/format_print.h"
 #include "src/base/thread_pool.h"
 #include "src/data/data_structure.h"
+#include "src/data/block_cache.h"
+#include "src/data/compressed_matrix.h"
+#include "src/data/feature_id_map.h"
+#include "src/data/mapped_matrix.h"
 #include "src/reader/parser.h"
 
 namespace xLearn {
 
 const size_t kDefautBlockSize = 500;  // 500 MB
+const index_t kCompressBatchSize = 100000;  // rows in each Samples()
 
 //------------------------------------------------------------------------------
 // Reader is an abstract class which can be implemented in different way,
@@ -77,10 +90,15 @@ class Reader {
  public:
   // Constructor and Destructor
   Reader() : 
+    parser_(nullptr),
     shuffle_(false), 
     bin_out_(true),
+    compress_(false),
+    quantize_(false),
+    use_mmap_(true),
+    block_(nullptr),
     block_size_(kDefautBlockSize) {  }
-  virtual ~Reader() {  }
+  virtual ~Reader() { free_parser(); }
 
   // We need to invoke the Initialize() function before
   // we start to sample data. We can shuffle data before 
@@ -117,16 +135,125 @@ class Reader {
     bin_out_ = false;  
   }
 
+  // Whether the statistics of data (MaxFeat(), MaxField() and
+  // NNZ()) are needed, e.g., they are not needed in prediction,
+  // since the model fixes the sizes. Then the on-disk Reader 
+  // does not parse the whole file in Initialize().
+  void SetNeedStats(bool need_stats) {
+    need_stats_ = need_stats;
+  }
+
+  // Verify the bin file by hashing the whole text file. On
+  // default, we only check the size, the modification time,
+  // and a few sampled chunks of the text file.
+  void SetVerifyBin(bool verify_bin) {
+    verify_bin_ = verify_bin;
+  }
+
+  // Store the nodes of the bin file in compressed format, which
+  // is several times smaller, and it is decoded in parallel when 
+  // it is loaded. In compressed mode (SetCompress), the bin file 
+  // is always compressed.
+  void SetBinCompress(bool bin_compress) {
+    bin_compress_ = bin_compress;
+  }
+
   // Set random see
   void SetSeed(int seed) {
     seed_ = seed;
   }
 
+  // Set the number of threads for parsing text data.
+  void SetThreadNumber(int thread_number) {
+    CHECK_GT(thread_number, 0);
+    thread_number_ = thread_number;
+  }
+
+  // Parse text data with a thread pool that is shared with
+  // other readers, instead of the threads of our own parser.
+  void SetParsePool(ThreadPool* pool) {
+    parse_pool_ = pool;
+  }
+
   // If shuffle data ?
   virtual void SetShuffle(bool shuffle) {
     shuffle_ = shuffle;
   }
 
+  // Shuffle data in chunks of contiguous rows. The reader
+  // permutes the chunks, and then shuffles the rows inside 
+  // each chunk, so that an epoch visits the memory in a 
+  // nearly sequential way. Using 0 or 1 means global shuffle.
+  void SetShuffleChunk(index_t chunk) {
+    shuffle_chunk_ = chunk;
+  }
+
+  // Statistics of the whole dataset, which are collected
+  // in Initialize() and used to initialize the model.
+  inline index_t MaxFeat() const { return max_feat_; }
+  inline index_t MaxField() const { return max_field_; }
+  inline uint64 NNZ() const { return nnz_; }
+
+  // Size (number of rows) of the shuffle buffer across blocks.
+  // Only the OndiskReader uses this option when shuffle is
+  // enabled. Using 0 means we only shuffle the order of blocks.
+  void SetShuffleWindow(index_t window) {
+    shuffle_window_ = window;
+  }
+
+  // Read text file by mmap() instead of fread(). This is
+  // used by default, and the reader falls back to fread() 
+  // if the file cannot be mapped.
+  void SetMmap(bool use_mmap) {
+    use_mmap_ = use_mmap;
+  }
+
+  // Number of blocks that are read and parsed in background 
+  // before they are sampled. Only the OndiskReader uses this 
+  // option. Using 0 means reading data synchronously.
+  void SetPrefetch(int depth) {
+    CHECK_GE(depth, 0);
+    prefetch_ = depth;
+  }
+
+  // Memory budget (MB) for the parsed blocks that are kept in
+  // memory across epochs. Only the OndiskReader uses this option,
+  // and the other blocks are read from its binary cache in each 
+  // epoch. Using 0 means all the blocks are read from disk.
+  void SetMemoryBudget(size_t budget) {
+    mem_budget_ = budget;
+  }
+
+  // Declare the format of the data: "libsvm", "libffm", or
+  // "csv". The format is detected from the first line of the
+  // data if it is not declared.
+  void SetFormat(const std::string& format) {
+    CHECK(format.empty() || format == "libsvm" ||
+          format == "libffm" || format == "csv");
+    format_ = format;
+  }
+
+  // Set the field of each column of csv data, so that it can
+  // be used by ffm. All the columns are in field 0 by default.
+  void SetFieldMap(const std::vector<index_t>& field_map) {
+    field_map_ = field_map;
+  }
+
+  // Map the feature ids of the samples to a dense range, and drop
+  // the features that are not in the map. It is set after
+  // Initialize(), and the map must outlive the Reader.
+  virtual void SetFeatureMap(const FeatureIdMap* id_map) {
+    id_map_ = id_map;
+  }
+
+  // Store data in compressed format. Only the
+  // InmemReader uses this option. If quantize is true,
+  // the feature value will be stored in bfloat16.
+  void SetCompress(bool compress, bool quantize = false) {
+    compress_ = compress;
+    quantize_ = quantize;
+  }
+
  protected:
   /* Input file name */
   std::string filename_;
@@ -142,14 +269,70 @@ class Reader {
   bool shuffle_;
   /* Generate bin file ? */
   bool bin_out_;
+  /* Get the statistics of data in Initialize() ? */
+  bool need_stats_ = true;
+  /* Hash the whole text file to verify the bin file ? */
+  bool verify_bin_ = false;
+  /* Store the bin file in compressed format ? */
+  bool bin_compress_ = false;
+  /* Store data in compressed format ? */
+  bool compress_;
+  /* Quantize feature value in compressed format ? */
+  bool quantize_;
   /* Split string for data items */
   std::string splitor_;
+  /* Declared format of the data */
+  std::string format_;
+  /* Field of each column of csv data */
+  std::vector<index_t> field_map_;
+  /* Map of the feature ids, or nullptr */
+  const FeatureIdMap* id_map_ = nullptr;
+  /* Read text file by mmap() ? */
+  bool use_mmap_;
+  /* The mapped text file */
+  MappedFile map_;
+  /* [map_begin_, map_pos_) is the last block of map_ */
+  uint64 map_begin_ = 0;
+  uint64 map_pos_ = 0;
+  /* The decompressed stream of a gzip or zstd file */
+  CompressedFile stream_;
+  /* [tail_pos_, tail_pos_ + tail_size_) of block_ is the
+  incomplete line after the last block of stream_ (or pipe) */
+  uint64 tail_pos_ = 0;
+  uint64 tail_size_ = 0;
+  /* Read the text file as a pipe ? */
+  bool read_pipe_ = false;
   /* A block of memory to store the data */
   char* block_;
   /* Block size */
   size_t block_size_;
   /* Random seed */
   int seed_ = 1;
+  /* Number of threads for parsing */
+  int thread_number_ = 1;
+  /* Shared thread pool for parsing, or nullptr */
+  ThreadPool* parse_pool_ = nullptr;
+  /* Chunk size for shuffle */
+  index_t shuffle_chunk_ = 0;
+  /* Number of prefetched blocks */
+  int prefetch_ = 1;
+  /* Memory budget (MB) for the blocks of on-disk data */
+  size_t mem_budget_ = 0;
+  /* Number of chunked shuffle, which changes the seed */
+  int shuffle_count_ = 0;
+  /* Size of the shuffle buffer for on-disk data */
+  index_t shuffle_window_ = 0;
+  /* Statistics of the whole dataset */
+  index_t max_feat_ = 0;
+  index_t max_field_ = 0;
+  uint64 nnz_ = 0;
+
+  // Merge the statistics of a part of dataset.
+  void update_stats(const DMatrix& matrix) {
+    max_feat_ = std::max(max_feat_, matrix.max_feat);
+    max_field_ = std::max(max_field_, matrix.max_field);
+    nnz_ += matrix.nnz;
+  }
 
   // Check current file format and return
   // "libsvm", "ffm", or "csv".
@@ -158,10 +341,64 @@ class Reader {
   // data has the label y.
   std::string check_file_format();
 
+  // Check the format of a line of data in
+  // the same way as check_file_format().
+  std::string check_line_format(const std::string& data_line);
+
+  // Create parser_ for the format of the text file.
+  void init_parser();
+
+  // Create parser_ for the given format, and
+  // delete the old one if there is any.
+  void create_parser(const std::string& format);
+
+  // Delete parser_ and its threads.
+  void free_parser() {
+    delete parser_;
+    parser_ = nullptr;
+  }
+
+  // Get the signature of the text file, or of its first length
+  // bytes. The field map is hashed into the signature as well,
+  // since the data in the binary file depends on it.
+  bool load_signature(FileSignature& signature);
+  bool load_signature(FileSignature& signature, uint64 length);
+
+  // Shuffle the order of rows by using the given seed.
+  void shuffle_order(std::vector<index_t>& order, int seed);
+
   // Find the last '\n' in block and 
   // shrink back file pointer.
   void shrink_block(char* block, size_t* ret, FILE* file);
 
+  // Get the first line of the text file.
+  void get_first_line(std::string& line);
+
+  // Hash the whole content of the text file, which
+  // is decompressed if the file is compressed.
+  uint64 hash_text_file();
+
+  // Open a compressed file as stream_, or map the text
+  // file. Allocate block_ if the file cannot be mapped.
+  void open_text_file();
+
+  // Allocate memory for block_.
+  void alloc_block();
+
+  // Return to the beginning of the text file.
+  void rewind_text_file();
+
+  // Get the next block of text file, which ends with '\n'.
+  // The block is a view of the mapped file, or it is read 
+  // (and decompressed) from the file to block_. Return the
+  // size of the block, and return 0 at the end of file.
+  size_t next_text_block(FILE* file, const char** buf);
+
+  // Keep the incomplete line at the end of block_[0, ret) for
+  // the next block, unless we reach the end of file (eof). 
+  // Return the size of the complete lines.
+  size_t cut_block(size_t ret, bool eof);
+
   // Create parser for different file format
   Parser* CreateParser(const char* format_name) {
     return CREATE_PARSER(format_name);
@@ -175,17 +412,39 @@ class Reader {
 // Sampling data from memory buffer.
 // For in-memory sampling, the Reader will automatically convert
 // txt data to binary data, and uses this binary data in the next time.
+// The binary file is mapped into memory, so loading it needs no parsing.
+// By default, the rows are still copied out of the mapping into private
+// memory (one SparseRow per row, in parallel) before the mapping is
+// closed, and they are shared by the samples of every epoch. Only in
+// compressed mode, a compressed binary file is used in place, so the
+// processes training on the same file share one copy of it in the
+// page cache. If the
+// text file has only grown (e.g., new lines are appended to a log
+// file), only the new lines are parsed and appended to the binary file.
 //------------------------------------------------------------------------------
 class InmemReader : public Reader {
  public:
   // Constructor and Destructor
-  InmemReader() : pos_(0) { }
+  InmemReader() : pos_(0), base_(this) { }
   ~InmemReader() { }
 
   // Pre-load all the data into memory buffer.
   virtual void Initialize(const std::string& filename);
   virtual void Initialize(xLearn::DMatrix* &dmatrix) { }
 
+  // Sample the rows [begin, end) of another InmemReader, which has
+  // been initialized. The data is shared rather than copied, e.g.,
+  // each fold of cross-validation is a view of the same data. The
+  // base Reader must be deleted after its views.
+  void InitializeView(InmemReader* base, index_t begin, index_t end);
+
+  // Number of rows of the data.
+  index_t RowNumber() const;
+
+  // The rows in data_buf_ are mapped at once, and the
+  // other rows are mapped when they are sampled.
+  virtual void SetFeatureMap(const FeatureIdMap* id_map);
+
   // Sample data from the memory buffer.
   virtual index_t Samples(DMatrix* &matrix);
 
@@ -195,9 +454,13 @@ class InmemReader : public Reader {
   // Free the memory of data matrix.
   virtual void Clear() {
     data_buf_.Reset();
+    cmat_.Reset();
+    mmat_.Close();
     data_samples_.Reset();
+    free_parser();
     if (block_ != nullptr) {
-      delete [] block_;
+      free(block_);
+      block_ = nullptr;
     }
   }
 
@@ -210,36 +473,82 @@ class InmemReader : public Reader {
   virtual inline void SetShuffle(bool shuffle) {
     this->shuffle_ = shuffle;
     if (shuffle_ && !order_.empty()) {
-      srand(this->seed_);
-      random_shuffle(order_.begin(), order_.end());
+      shuffle_order(order_, this->seed_);
     }
   }
 
   // Get data buffer
   virtual inline DMatrix* GetMatrix() {
-    return &data_buf_;
+    return &base_->data_buf_;
   }
 
  protected:
   /* Reader will load all the data 
   into this buffer */
   DMatrix data_buf_;
+  /* Used instead of data_buf_ when compress_ is true */
+  CompressedMatrix cmat_;
+  /* Used instead of data_buf_ when the binary file is found */
+  MappedMatrix mmat_;
   /* Number of record at each sampling */
   index_t num_samples_;
   /* Position for sampling */
   index_t pos_;
-  /* For random shuffle */
+  /* For random shuffle. A view only has its own rows here */
   std::vector<index_t> order_;
+  /* The Reader that owns the data, which is this
+  Reader unless it is a view of another one */
+  InmemReader* base_;
 
-  // Check whehter current path has a binary file.
+  // Check whehter current path has a binary file,
+  // which is generated from current text file.
   bool hash_binary(const std::string& filename);
 
-  // Initialize Reader from existing binary file.
-  void init_from_binary();
+  // Write data_buf_ to the binary file.
+  void write_binary(const FileSignature& signature);
+
+  // If the text file has only grown since the binary file was
+  // generated, parse the new lines and append them to the binary 
+  // file. Return false if the text file has been changed otherwise.
+  bool append_binary();
+
+  // Whether the options of the mapped file are the same as ours.
+  bool match_binary(const MappedMatrix& mmat);
+
+  // Initialize Reader by mapping the existing binary file.
+  // Return false if the file cannot be mapped.
+  bool init_from_binary();
+
+  // Use the mapped data, which is decoded or
+  // compressed for the current options.
+  void use_binary();
 
   // Initialize Reader from a new txt file.
   void init_from_txt();
 
+  // Move the mapped data into the compressed matrix.
+  void compress_mapped();
+
+  // Decode (or copy) the mapped data into data_buf_.
+  void decode_mapped();
+
+  // Print the memory size of the compressed matrix.
+  void print_compress_info();
+
+  // Reset order_ to [0, size).
+  void init_order(index_t size) {
+    order_.resize(size);
+    for (index_t i = 0; i < size; ++i) {
+      order_[i] = i;
+    }
+  }
+
+  // Sample data from the compressed matrix.
+  index_t samples_from_compressed(DMatrix* &matrix);
+
+  // Sample data from the mapped binary file in compressed mode.
+  index_t samples_from_mapped(DMatrix* &matrix);
+
  private:
   DISALLOW_COPY_AND_ASSIGN(InmemReader);
 };
@@ -248,12 +557,34 @@ class InmemReader : public Reader {
 // Sampling data from disk file.
 // OndiskReader is used to train very big data, which cannot be
 // loaded into main memory of current single machine.
+// If prefetch is enabled, a background thread reads and parses the
+// next blocks into a queue of DMatrix, while the training threads
+// use the current block. The matrix returned by Samples() is valid
+// until the next call of Samples() or Reset().
+// If shuffle is enabled, the file is split into blocks at the line 
+// boundaries, and the blocks are visited in a different random order 
+// in each epoch. Besides, the rows can pass through a shuffle buffer 
+// of shuffle_window_ rows, so that the rows of different blocks are 
+// mixed while the memory usage is still bounded.
+// The first pass of the text file (in Initialize()) writes the parsed
+// blocks to a chunked binary cache (.cache) file, which also records
+// the statistics of the data. The following epochs, as well as the
+// next runs on the same file, read the chunks instead of parsing the
+// text. The chunks can be shuffled even if the text is compressed.
+// With a memory budget (SetMemoryBudget), the chunks that fit in the
+// budget are kept in memory after they are read for the first time,
+// so only the rest of the data is read from disk in each epoch.
 //------------------------------------------------------------------------------
-// TODO(chao): binary-cache
 class OndiskReader : public Reader {
  public:
   // Constructor and Destructor
-  OndiskReader() { }
+  OndiskReader() 
+    : file_ptr_(nullptr),
+      current_(nullptr), 
+      prefetch_stop_(false), 
+      prefetch_end_(false),
+      block_pos_(0),
+      text_hash_(nullptr) { }
   ~OndiskReader() { 
     Clear();
     Close(file_ptr_); 
@@ -271,9 +602,15 @@ class OndiskReader : public Reader {
 
   // Free the memory of data matrix.
   virtual void Clear() {
+    stop_prefetch();
+    free_prefetch_buf();
+    window_.Reset();
     data_samples_.Reset();
+    cache_.Close();
+    free_parser();
     if (block_ != nullptr) {
-      delete [] block_;
+      free(block_);
+      block_ = nullptr;
     }
   }
 
@@ -282,17 +619,109 @@ class OndiskReader : public Reader {
     return "on-disk";
   }
 
-  // We cannot set shuffle for OndiskReader
-  void inline SetShuffle(bool shuffle) {
-    if (shuffle == true) {
-      LOG(ERR) << "Cannot set shuffle for OndiskReader.";
+  // The binary cache file is generated in the same
+  // directory with the data file.
+  inline std::string CacheFile() const {
+    return filename_ + ".cache";
+  }
+
+  // Whether the blocks are read from the binary cache.
+  inline bool UseCache() const { return cache_.IsOpen(); }
+
+  // Shuffle the order of blocks (and the rows in the 
+  // shuffle buffer) from the next epoch.
+  virtual void SetShuffle(bool shuffle) {
+    this->shuffle_ = shuffle;
+    if (shuffle && stream_.IsOpen() && !cache_.IsOpen()) {
+      Color::print_warning(
+        "Blocks of compressed file cannot be shuffled. Only "
+        "the shuffle window (-shuffle_window) will be used."
+      );
     }
-    this->shuffle_ = false;
+    if (file_ptr_ != nullptr) { Reset(); }
   }
 
  protected:
   /* Maintain the file pointer */
   FILE* file_ptr_; 
+  /* Buffers for the prefetched blocks */
+  std::vector<DMatrix*> prefetch_buf_;
+  /* Buffers that can be filled by the prefetch thread */
+  std::queue<DMatrix*> free_buf_;
+  /* Buffers that are ready for Samples() */
+  std::queue<DMatrix*> ready_buf_;
+  /* The buffer returned by the last Samples() */
+  DMatrix* current_;
+  /* Background thread to read and parse data */
+  std::thread prefetch_thread_;
+  std::mutex mutex_;
+  std::condition_variable cond_;
+  /* Tell the prefetch thread to exit */
+  bool prefetch_stop_;
+  /* The prefetch thread reaches the end of file */
+  bool prefetch_end_;
+  /* Start offset of each block, and the file size at the end */
+  std::vector<uint64> block_offset_;
+  /* Visiting order of blocks in current epoch */
+  std::vector<index_t> block_order_;
+  /* Position in block_order_ */
+  index_t block_pos_;
+  /* Shuffle buffer across blocks */
+  DMatrix window_;
+  /* Random engine for the shuffle buffer */
+  std::mt19937 window_rng_;
+  /* Binary cache of the parsed blocks */
+  BlockCache cache_;
+  /* Hash of the text, which is updated when 
+  the cache is generated */
+  StreamHash* text_hash_;
+
+  // Read a block (through the shuffle buffer if it is used)
+  // and parse it to the matrix. Return 0 when reaching 
+  // the end of file.
+  index_t read_block(DMatrix& matrix);
+
+  // Read the next block from file and parse it to the matrix.
+  index_t read_raw_block(DMatrix& matrix);
+
+  // Exchange the rows of matrix with the shuffle buffer.
+  void shuffle_window(DMatrix& matrix);
+
+  // Move all the rows in shuffle buffer to the matrix
+  // in random order. Return the number of rows.
+  index_t flush_window(DMatrix& matrix);
+
+  // Shuffle the order of blocks? We cannot seek in a 
+  // compressed file, but we can visit the chunks of the
+  // binary cache in any order.
+  inline bool shuffle_block() const {
+    return shuffle_ && (cache_.IsOpen() || !stream_.IsOpen());
+  }
+
+  // Split the file into blocks at the line boundaries.
+  void build_block_index();
+
+  // Start the prefetch thread from current file position.
+  void start_prefetch();
+
+  // Stop the prefetch thread and recycle all the buffers.
+  void stop_prefetch();
+
+  // Free the prefetch buffers and their rows.
+  void free_prefetch_buf();
+
+  // The loop of the prefetch thread.
+  void prefetch_loop();
+
+  // Open the binary cache and load the statistics from it. 
+  // Return false if the file does not exist or it is not 
+  // generated from current data file.
+  bool load_cache();
+
+  // Parse the whole file once to get the statistics. If
+  // write_cache is true, the blocks are written to the 
+  // binary cache, which is used from the next epoch.
+  void scan_file(bool write_cache);
  
  private:
   DISALLOW_COPY_AND_ASSIGN(OndiskReader);
@@ -315,11 +744,17 @@ class FromDMReader : public Reader {
   // Free the memory of data matrix.
   virtual void Clear() {
     data_samples_.Reset();
+    data_copy_.Reset();
     if (block_ != nullptr) {
-      delete [] block_;
+      free(block_);
+      block_ = nullptr;
     }
   }
 
+  // Map the feature ids of a copy of the DMatrix,
+  // which belongs to the caller.
+  virtual void SetFeatureMap(const FeatureIdMap* id_map);
+
   // Return the Reader type
   virtual std::string Type() {
     return "from-dmatrix";
@@ -329,8 +764,7 @@ class FromDMReader : public Reader {
   virtual inline void SetShuffle(bool shuffle) {
     this->shuffle_ = shuffle;
     if (shuffle_ && !order_.empty()) {
-      srand(this->seed_);
-      random_shuffle(order_.begin(), order_.end());
+      shuffle_order(order_, this->seed_);
     }
   }
 
@@ -342,12 +776,174 @@ class FromDMReader : public Reader {
   index_t pos_;
   /* For random shuffle */
   std::vector<index_t> order_;
-
+  /* Copy of the DMatrix whose feature ids are mapped */
+  DMatrix data_copy_;
 
  private:
   DISALLOW_COPY_AND_ASSIGN(FromDMReader);
 };
 
+//------------------------------------------------------------------------------
+// StreamReader reads data from stdin ("-"), a named pipe, or a device
+// in a single pass, e.g., for the prediction in a Unix pipeline:
+//
+//   cat test.txt | xlearn_predict - model.out -format libsvm -o -
+//
+// The data is parsed as soon as a complete line is read from the pipe,
+// and it cannot be read again, so Reset() only works before the first
+// Samples(). The format of the data cannot be detected by re-opening
+// the pipe, and hence it must be declared by SetFormat(). The split 
+// string and the label are still checked from the first line. The
+// statistics of the data (MaxFeat(), etc.) are not collected.
+//------------------------------------------------------------------------------
+class StreamReader : public Reader {
+ public:
+  // Constructor and Destructor
+  StreamReader()
+    : file_ptr_(nullptr),
+      first_buf_(nullptr),
+      first_size_(0),
+      started_(false) { }
+  ~StreamReader() { Clear(); }
+
+  // Open the pipe and read the first block.
+  virtual void Initialize(const std::string& filename);
+  virtual void Initialize(xLearn::DMatrix* &dmatrix) {
+    LOG(FATAL) << "StreamReader cannot be initialized from DMatrix.";
+  }
+
+  // Sample data from the pipe.
+  virtual index_t Samples(DMatrix* &matrix);
+
+  // The pipe cannot return to the beginning.
+  virtual void Reset();
+
+  // Close the pipe and free the memory.
+  virtual void Clear();
+
+  // Return the Reader type
+  virtual std::string Type() {
+    return "stream";
+  }
+
+ protected:
+  /* The pipe, which can be stdin */
+  FILE* file_ptr_;
+  /* The first block that is read in Initialize() */
+  const char* first_buf_;
+  size_t first_size_;
+  /* Samples() has been invoked ? */
+  bool started_;
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(StreamReader);
+};
+
+//------------------------------------------------------------------------------
+// MultiReader reads a list of files (a directory, a glob pattern, or
+// a manifest, see src/base/file_list.h) as one training stream. Each
+// file (shard) has its own InmemReader or OndiskReader, so each shard
+// has its own cached .bin (or .cache) file. The shards are initialized
+// by several threads at the same time, and the blocks of several shards
+// are sampled in turn, so that the prefetch threads of the on-disk 
+// readers read these shards concurrently. For example:
+//
+//   MultiReader* reader = new MultiReader();
+//   reader->SetReaderType("disk");   /* or "memory" */
+//   reader->SetReaderThreads(4);     /* read 4 shards at the same time */
+//   reader->SetShuffleFiles(true);   /* shuffle the shards in each epoch */
+//   reader->Initialize("./data/part-*");
+//
+// The shards are read in the order of their names by default.
+//------------------------------------------------------------------------------
+class MultiReader : public Reader {
+ public:
+  // Constructor and Destructor
+  MultiReader() 
+    : type_("memory"),
+      reader_threads_(1),
+      shuffle_files_(false),
+      shard_pool_(nullptr),
+      next_(0),
+      turn_(0) { }
+  ~MultiReader() { Clear(); }
+
+  // Expand the file list and initialize the reader of each shard.
+  virtual void Initialize(const std::string& filename);
+  virtual void Initialize(xLearn::DMatrix* &dmatrix) {
+    LOG(FATAL) << "MultiReader cannot be initialized from DMatrix.";
+  }
+
+  // Sample data from the shards.
+  virtual index_t Samples(DMatrix* &matrix);
+
+  // Return to the beginning of the data.
+  virtual void Reset();
+
+  // Free the memory of all the shards.
+  virtual void Clear();
+
+  // Return the Reader type
+  virtual std::string Type() {
+    return "multi-file";
+  }
+
+  // If shuffle data ?
+  virtual void SetShuffle(bool shuffle);
+
+  // Set the map of feature ids to all the shards.
+  virtual void SetFeatureMap(const FeatureIdMap* id_map);
+
+  // Reader type of each shard: "memory" or "disk".
+  void SetReaderType(const std::string& type) {
+    CHECK(type == "memory" || type == "disk");
+    type_ = type;
+  }
+
+  // Number of shards that are read at the same time.
+  void SetReaderThreads(int reader_threads) {
+    CHECK_GT(reader_threads, 0);
+    reader_threads_ = reader_threads;
+  }
+
+  // Visit the shards in a random order (by the seed) in each epoch.
+  void SetShuffleFiles(bool shuffle_files) {
+    shuffle_files_ = shuffle_files;
+  }
+
+  // Return the files of the shards.
+  inline const std::vector<std::string>& FileList() const {
+    return file_list_;
+  }
+
+ protected:
+  /* "memory" or "disk" */
+  std::string type_;
+  /* Number of shards that are read at the same time */
+  int reader_threads_;
+  /* Shuffle the order of shards ? */
+  bool shuffle_files_;
+  /* Files and readers of the shards */
+  std::vector<std::string> file_list_;
+  std::vector<Reader*> reader_list_;
+  /* Parse threads that are shared by all the shards */
+  ThreadPool* shard_pool_;
+  /* Visiting order of shards in current epoch */
+  std::vector<size_t> order_;
+  /* Next shard in order_ to read */
+  size_t next_;
+  /* Shards that are being read */
+  std::vector<size_t> active_;
+  /* Position in active_ of the next Samples() */
+  size_t turn_;
+
+  // Set the options of this reader to a shard.
+  void init_shard(Reader* reader);
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(MultiReader);
+};
+
 //------------------------------------------------------------------------------
 // Class register
 //------------------------------------------------------------------------------
@@ -0,0 +1,177 @@
+//------------------------------------------------------------------------------
+// Copyright (c) 2018 by contributors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//------------------------------------------------------------------------------
+
+/*
+This file is the benchmark of the Reader and the Parser, which is
+not a part of the unit tests. Usage:
+
+  ./reader_benchmark shuffle [rows]
+  ./reader_benchmark parse
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "src/base/timer.h"
+#include "src/reader/parser.h"
+#include "src/reader/reader.h"
+
+using namespace xLearn;
+
+// Benchmark of the chunked shuffle. We train a logistic regression
+// model by SGD on a synthetic dataset, in which the labels come in
+// long runs (like data sorted by time), and print the time cost of
+// each epoch and the loss for different chunk sizes. The chunk size
+// -1 means no shuffle.
+void shuffle_benchmark(index_t num_rows) {
+  const index_t kNNZ = 8;
+  const index_t kFeat = 1 << 20;
+  const index_t kRun = 2000;
+  const int kEpoch = 3;
+  std::mt19937 gen(1);
+  std::uniform_int_distribution<index_t> feat_dist(0, kFeat-1);
+  std::vector<real_t> hidden(kFeat);
+  for (index_t j = 0; j < kFeat; ++j) {
+    hidden[j] = (gen() % 2) ? 1.0 : -1.0;
+  }
+  // Generate rows and sort the labels into runs
+  std::vector<std::vector<index_t>> pos, neg;
+  for (index_t i = 0; i < num_rows; ++i) {
+    std::vector<index_t> feat(kNNZ);
+    real_t sum = 0;
+    for (index_t j = 0; j < kNNZ; ++j) {
+      feat[j] = feat_dist(gen);
+      sum += hidden[feat[j]];
+    }
+    if (sum > 0) { pos.push_back(feat); } else { neg.push_back(feat); }
+  }
+  DMatrix* data = new DMatrix;
+  size_t p = 0, n = 0;
+  for (index_t i = 0; i < num_rows; ++i) {
+    bool positive = ((i / kRun) % 2 == 0 && p < pos.size()) ||
+                    n >= neg.size();
+    const std::vector<index_t>& feat = positive ? pos[p++] : neg[n++];
+    data->AddRow();
+    data->Y[i] = positive ? 1 : -1;
+    for (index_t j = 0; j < kNNZ; ++j) {
+      data->AddNode(i, feat[j], 1.0);
+    }
+  }
+  printf("rows: %u, epochs: %d\n", num_rows, kEpoch);
+  int chunk_list[] = {-1, 0, 16, 256, 4096};
+  for (int c = 0; c < 5; ++c) {
+    FromDMReader reader;
+    reader.SetShuffleChunk(std::max(chunk_list[c], 0));
+    reader.Initialize(data);
+    reader.SetShuffle(chunk_list[c] >= 0);
+    std::vector<real_t> w(kFeat, 0);
+    DMatrix* matrix = nullptr;
+    Timer timer;
+    real_t loss = 0;
+    for (int epoch = 0; epoch < kEpoch; ++epoch) {
+      reader.Reset();
+      reader.Samples(matrix);
+      timer.tic();
+      loss = 0;
+      for (index_t i = 0; i < matrix->row_length; ++i) {
+        SparseRow* row = matrix->row[i];
+        real_t y = matrix->Y[i];
+        real_t score = 0;
+        for (SparseRow::iterator iter = row->begin();
+             iter != row->end(); ++iter) {
+          score += w[iter->feat_id] * iter->feat_val;
+        }
+        loss += log1p(exp(-y * score));
+        real_t grad = -y / (1.0 + exp(y * score));
+        for (SparseRow::iterator iter = row->begin();
+             iter != row->end(); ++iter) {
+          w[iter->feat_id] -= 0.1 * grad * iter->feat_val;
+        }
+      }
+      loss /= matrix->row_length;
+      timer.toc();
+      // Trigger the shuffle for next epoch
+      reader.Samples(matrix);
+    }
+    if (chunk_list[c] < 0) {
+      printf("no shuffle       ");
+    } else {
+      printf("chunk size: %5d", chunk_list[c]);
+    }
+    printf(", time per epoch: %.3f sec, train loss: %.5f\n",
+           timer.get() / kEpoch, loss);
+  }
+  delete data;
+}
+
+// Print the parse throughput (MB/s) of one thread.
+void parse_benchmark(Parser* parser, const std::string& format) {
+  static const int kRows = 100000;
+  static const int kCols = 30;
+  std::string data;
+  char item[64];
+  for (int i = 0; i < kRows; ++i) {
+    data += (i % 2 ? "1" : "-1");
+    for (int j = 0; j < kCols; ++j) {
+      uint32 feat = (i * 7919 + j * 104729) % 1000000;
+      real_t value = (feat % 1000 + 1) / 997.0;  // non-zero
+      if (format == "libsvm") {
+        snprintf(item, 64, " %u:%.6f", feat, value);
+      } else if (format == "libffm") {
+        snprintf(item, 64, " %d:%u:%.6f", j, feat, value);
+      } else {
+        snprintf(item, 64, ",%.6f", value);
+      }
+      data += item;
+    }
+    data += "\n";
+  }
+  parser->setLabel(true);
+  parser->setSplitor(format == "csv" ? "," : " ");
+  DMatrix matrix;
+  Timer timer;
+  static const int kRepeat = 3;
+  for (int n = 0; n < kRepeat; ++n) {
+    timer.tic();
+    parser->Parse((char*)data.data(), data.size(), matrix, true);
+    timer.toc();
+  }
+  double mb = data.size() * kRepeat / (1024.0 * 1024.0);
+  printf("%-6s: %.1f MB/s per core\n", format.c_str(), mb / timer.get());
+  delete parser;
+}
+
+int main(int argc, char* argv[]) {
+  if (argc >= 2 && strcmp(argv[1], "shuffle") == 0) {
+    index_t num_rows = argc >= 3 ? atoi(argv[2]) : 400000;
+    shuffle_benchmark(num_rows);
+    return 0;
+  }
+  if (argc >= 2 && strcmp(argv[1], "parse") == 0) {
+    parse_benchmark(new LibsvmParser, "libsvm");
+    parse_benchmark(new FFMParser, "libffm");
+    parse_benchmark(new CSVParser, "csv");
+    return 0;
+  }
+  printf("Usage: %s shuffle [rows] | parse\n", argv[0]);
+  return 1;
+}
@@ -22,9 +22,22 @@ This file tests the Reader class.
 
 #include <string>
 #include <vector>
+#include <random>
+#include <math.h>
+#include <fstream>
+#include <thread>
+#include <sys/stat.h>
+#ifdef _MSC_VER
+#include <direct.h>
+#endif
+
+#ifdef XLEARN_USE_ZLIB
+#include <zlib.h>
+#endif
 
 #include "src/reader/reader.h"
 #include "src/base/file_util.h"
+#include "src/base/stringprintf.h"
 
 using std::vector;
 using std::string;
@@ -111,6 +124,17 @@ void delete_file() {
   RemoveFile(csv_file_comma.c_str());
   RemoveFile(lr_no_file_comma.c_str());
   RemoveFile(ffm_no_file_comma.c_str());
+  // cache file of OndiskReader
+  string files[] = {lr_file, ffm_file, csv_file, lr_no_file,
+                    ffm_no_file, lr_file_comma, ffm_file_comma,
+                    csv_file_comma, lr_no_file_comma,
+                    ffm_no_file_comma};
+  for (int i = 0; i < 10; ++i) {
+    string cache_file = files[i] + ".cache";
+    if (FileExist(cache_file.c_str())) {
+      RemoveFile(cache_file.c_str());
+    }
+  }
   // bin file
   lr_file += ".bin";
   ffm_file += ".bin";
@@ -329,7 +353,938 @@ TEST(ReaderTest, ReadFromBinary) {
   read_from_memory(ffm_no_file_comma, 4);  
 }
 
-TEST(ReaderTest, SampleFromDisk) { 
+// Initialize an InmemReader from the file, and return
+// true if the existing bin file is used.
+bool use_bin_file(const std::string& filename, bool verify_bin) {
+  FileSignature before, after;
+  before.Load(filename + ".bin");
+  InmemReader reader;
+  reader.SetVerifyBin(verify_bin);
+  reader.Initialize(filename);
+  DMatrix* matrix = nullptr;
+  EXPECT_EQ(reader.Samples(matrix), 100);
+  after.Load(filename + ".bin");
+  return before.size > 0 && before.Match(after);
+}
+
+TEST(ReaderTest, BinaryFileSignature) {
+  string filename = kTestfilename + "_bin_sig.txt";
+  string bin_file = filename + ".bin";
+  remove(bin_file.c_str());
+  string data;
+  for (int i = 0; i < 100; ++i) { data += kStrFFM; }
+  FILE* file = OpenFileOrDie(filename.c_str(), "w");
+  WriteDataToDisk(file, data.data(), data.size());
+  Close(file);
+  // Generate the bin file
+  EXPECT_FALSE(use_bin_file(filename, false));
+  EXPECT_TRUE(use_bin_file(filename, false));
+  EXPECT_TRUE(use_bin_file(filename, true));
+  // The bin file of the old version
+  {
+    DMatrix matrix;
+    matrix.ReAlloc(1);
+    matrix.AddNode(0, 1, 0.5);
+    matrix.Serialize(bin_file);
+  }
+  EXPECT_FALSE(use_bin_file(filename, false));
+  EXPECT_TRUE(use_bin_file(filename, false));
+  // Change the text file, even if its size is not changed
+  data[data.size() - 3] = '9';
+  file = OpenFileOrDie(filename.c_str(), "w");
+  WriteDataToDisk(file, data.data(), data.size());
+  Close(file);
+  EXPECT_FALSE(use_bin_file(filename, false));
+  // Change the content hash in the bin file. It 
+  // can only be found by the full verification.
+  char* buf = nullptr;
+  uint64 len = ReadFileToMemory(bin_file, &buf);
+  size_t offset = sizeof(uint64) + sizeof(uint32) + 4 * sizeof(uint64);
+  buf[offset] ^= 1;
+  file = OpenFileOrDie(bin_file.c_str(), "w");
+  WriteDataToDisk(file, buf, len);
+  Close(file);
+  delete [] buf;
+  EXPECT_TRUE(use_bin_file(filename, false));
+  EXPECT_FALSE(use_bin_file(filename, true));
+  EXPECT_TRUE(use_bin_file(filename, true));
+  RemoveFile(filename.c_str());
+  RemoveFile(bin_file.c_str());
+}
+
+// Read all the rows of an epoch, and return the feature
+// id of each row, which is also checked against the label.
+std::vector<index_t> read_feat_ids(InmemReader& reader) {
+  std::vector<index_t> feat_ids;
+  DMatrix* matrix = nullptr;
+  for (;;) {
+    index_t record_num = reader.Samples(matrix);
+    if (record_num == 0) { break; }
+    for (index_t i = 0; i < matrix->row_length; ++i) {
+      SparseRow* row = matrix->row[i];
+      EXPECT_EQ(row->size(), 1);
+      index_t feat = (*row)[0].feat_id;
+      EXPECT_FLOAT_EQ(matrix->Y[i], feat % 2);
+      EXPECT_EQ((*row)[0].field_id, feat % 5);
+      feat_ids.push_back(feat);
+    }
+  }
+  reader.Reset();
+  return feat_ids;
+}
+
+TEST(ReaderTest, MappedBinaryFile) {
+  string filename = kTestfilename + "_mapped.txt";
+  string bin_file = filename + ".bin";
+  remove(bin_file.c_str());
+  const index_t kRows = 250000;
+  FILE* file = OpenFileOrDie(filename.c_str(), "w");
+  for (index_t i = 0; i < kRows; ++i) {
+    string line = StringPrintf("%d %d:%d:0.5\n", i % 2, i % 5, i);
+    WriteDataToDisk(file, line.data(), line.size());
+  }
+  Close(file);
+  // Parse the text file, and generate the bin file
+  InmemReader txt_reader;
+  txt_reader.Initialize(filename);
+  std::vector<index_t> expected = read_feat_ids(txt_reader);
+  ASSERT_EQ(expected.size(), kRows);
+  // Map the bin file, which is read in batches
+  InmemReader bin_reader;
+  bin_reader.Initialize(filename);
+  EXPECT_EQ(bin_reader.MaxFeat(), kRows - 1);
+  EXPECT_EQ(bin_reader.MaxField(), 4);
+  EXPECT_EQ(read_feat_ids(bin_reader), expected);
+  bin_reader.SetShuffle(true);
+  std::vector<index_t> shuffled = read_feat_ids(bin_reader);
+  EXPECT_NE(shuffled, expected);
+  std::sort(shuffled.begin(), shuffled.end());
+  EXPECT_EQ(shuffled, expected);
+  // Compress the mapped data
+  InmemReader cmp_reader;
+  cmp_reader.SetCompress(true, false);
+  cmp_reader.Initialize(filename);
+  EXPECT_EQ(read_feat_ids(cmp_reader), expected);
+  RemoveFile(filename.c_str());
+  RemoveFile(bin_file.c_str());
+}
+
+// Append the rows [begin, end) to the text file.
+void append_rows(const std::string& filename, index_t begin, index_t end) {
+  FILE* file = OpenFileOrDie(filename.c_str(), begin == 0 ? "w" : "a");
+  for (index_t i = begin; i < end; ++i) {
+    string line = StringPrintf("%d %d:%d:0.5\n", i % 2, i % 5, i);
+    WriteDataToDisk(file, line.data(), line.size());
+  }
+  Close(file);
+}
+
+// Read the signature of the text file from the bin file.
+FileSignature bin_signature(const std::string& bin_file) {
+  FileSignature sig;
+  FILE* file = OpenFileOrDie(bin_file.c_str(), "rb");
+  fseek(file, sizeof(uint64) + sizeof(uint32), SEEK_SET);
+  EXPECT_TRUE(sig.Read(file));
+  Close(file);
+  return sig;
+}
+
+TEST(ReaderTest, AppendBinaryFile) {
+  string filename = kTestfilename + "_append.txt";
+  string bin_file = filename + ".bin";
+  const index_t kRows = 10000;
+  std::vector<index_t> expected;
+  for (index_t i = 0; i < 3 * kRows; ++i) { expected.push_back(i); }
+  for (int bin_compress = 0; bin_compress < 2; ++bin_compress) {
+    remove(bin_file.c_str());
+    append_rows(filename, 0, kRows);
+    {
+      InmemReader reader;
+      reader.SetBinCompress(bin_compress);
+      reader.Initialize(filename);
+    }
+    EXPECT_NE(bin_signature(bin_file).content_hash, 0);
+    // Only the new rows are parsed, and the content hash is unknown.
+    append_rows(filename, kRows, 2 * kRows);
+    {
+      InmemReader reader;
+      reader.SetBinCompress(bin_compress);
+      reader.Initialize(filename);
+      std::vector<index_t> feat_ids = read_feat_ids(reader);
+      EXPECT_EQ(feat_ids, std::vector<index_t>(expected.begin(),
+                          expected.begin() + 2 * kRows));
+      EXPECT_EQ(reader.MaxFeat(), 2 * kRows - 1);
+    }
+    FileSignature sig;
+    sig.Load(filename);
+    EXPECT_TRUE(sig.Match(bin_signature(bin_file)));
+    EXPECT_EQ(bin_signature(bin_file).content_hash, 0);
+    {
+      MappedMatrix mmat;
+      ASSERT_TRUE(mmat.Open(bin_file));
+      EXPECT_EQ(mmat.IsCompressed(), bin_compress == 1);
+      EXPECT_EQ(mmat.row_length, 2 * kRows);
+    }
+    // The old text is hashed by the full verification, which 
+    // fails for the unknown content hash.
+    append_rows(filename, 2 * kRows, 3 * kRows);
+    {
+      InmemReader reader;
+      reader.SetVerifyBin(true);
+      reader.SetBinCompress(bin_compress);
+      reader.Initialize(filename);
+      EXPECT_EQ(read_feat_ids(reader), expected);
+    }
+    uint64 content_hash = bin_signature(bin_file).content_hash;
+    EXPECT_NE(content_hash, 0);
+    // Then the content hash is updated with the new rows.
+    append_rows(filename, 3 * kRows, 3 * kRows + 10);
+    {
+      InmemReader reader;
+      reader.SetVerifyBin(true);
+      reader.Initialize(filename);
+      EXPECT_EQ(reader.MaxFeat(), 3 * kRows + 9);
+    }
+    EXPECT_NE(bin_signature(bin_file).content_hash, 0);
+    EXPECT_NE(bin_signature(bin_file).content_hash, content_hash);
+    // The bin file is verified without being changed.
+    FileSignature before, after;
+    before.Load(bin_file);
+    {
+      InmemReader reader;
+      reader.SetVerifyBin(true);
+      reader.Initialize(filename);
+    }
+    after.Load(bin_file);
+    EXPECT_TRUE(before.Match(after));
+  }
+  // The last line of the old text is not complete
+  append_rows(filename, 0, kRows);
+  FILE* file = OpenFileOrDie(filename.c_str(), "a");
+  WriteDataToDisk(file, "1 3:123:0.", 10);
+  Close(file);
+  {
+    InmemReader reader;
+    reader.Initialize(filename);
+  }
+  file = OpenFileOrDie(filename.c_str(), "a");
+  WriteDataToDisk(file, "5\n", 2);
+  Close(file);
+  {
+    InmemReader reader;
+    reader.Initialize(filename);
+    std::vector<index_t> feat_ids = read_feat_ids(reader);
+    ASSERT_EQ(feat_ids.size(), kRows + 1);
+    EXPECT_EQ(feat_ids.back(), 123);
+  }
+  EXPECT_NE(bin_signature(bin_file).content_hash, 0);
+  RemoveFile(filename.c_str());
+  RemoveFile(bin_file.c_str());
+}
+
+TEST(ReaderTest, ReaderView) {
+  string filename = kTestfilename + "_view.txt";
+  string bin_file = filename + ".bin";
+  remove(bin_file.c_str());
+  const index_t kRows = 25000;
+  append_rows(filename, 0, kRows);
+  std::vector<index_t> expected;
+  for (index_t i = 0; i < kRows; ++i) { expected.push_back(i); }
+  // Parse the text file, map the bin file, and compress the data
+  for (int n = 0; n < 3; ++n) {
+    InmemReader base;
+    base.SetCompress(n == 2);
+    base.Initialize(filename);
+    ASSERT_EQ(base.RowNumber(), kRows);
+    // The views of 3 folds
+    std::vector<index_t> feat_ids;
+    for (int i = 0; i < 3; ++i) {
+      index_t begin = kRows * i / 3;
+      index_t end = kRows * (i + 1) / 3;
+      InmemReader view;
+      view.InitializeView(&base, begin, end);
+      EXPECT_EQ(view.MaxFeat(), kRows - 1);
+      EXPECT_EQ(view.MaxField(), 4);
+      std::vector<index_t> ids = read_feat_ids(view);
+      EXPECT_EQ(ids, std::vector<index_t>(expected.begin() + begin,
+                                          expected.begin() + end));
+      // Shuffle the rows of the view
+      view.SetShuffle(true);
+      ids = read_feat_ids(view);
+      std::sort(ids.begin(), ids.end());
+      EXPECT_EQ(ids, std::vector<index_t>(expected.begin() + begin,
+                                          expected.begin() + end));
+      feat_ids.insert(feat_ids.end(), ids.begin(), ids.end());
+      // The chunked shuffle only permutes the rows of the view
+      InmemReader chunk_view;
+      chunk_view.SetShuffleChunk(64);
+      chunk_view.InitializeView(&base, begin, end);
+      chunk_view.SetShuffle(true);
+      for (int epoch = 0; epoch < 2; ++epoch) {
+        ids = read_feat_ids(chunk_view);
+        std::sort(ids.begin(), ids.end());
+        EXPECT_EQ(ids, std::vector<index_t>(expected.begin() + begin,
+                                            expected.begin() + end));
+      }
+    }
+    EXPECT_EQ(feat_ids, expected);
+    // The base Reader is not changed by its views
+    EXPECT_EQ(read_feat_ids(base), expected);
+  }
+  RemoveFile(filename.c_str());
+  RemoveFile(bin_file.c_str());
+}
+
+// Read the feature id of each row, or kNotFound for an empty row.
+std::vector<index_t> read_mapped_ids(Reader& reader) {
+  std::vector<index_t> feat_ids;
+  DMatrix* matrix = nullptr;
+  while (reader.Samples(matrix) > 0) {
+    for (index_t i = 0; i < matrix->row_length; ++i) {
+      const SparseRow* row = matrix->GetRow(i);
+      EXPECT_LE(row->size(), 1);
+      feat_ids.push_back(row->empty() ? FeatureIdMap::kNotFound :
+                                        (*row)[0].feat_id);
+    }
+  }
+  reader.Reset();
+  return feat_ids;
+}
+
+TEST(ReaderTest, FeatureMap) {
+  string filename = kTestfilename + "_remap.txt";
+  string bin_file = filename + ".bin";
+  remove(bin_file.c_str());
+  const index_t kRows = 25000;
+  append_rows(filename, 0, kRows);
+  // The map has the even ids only, and the odd ids are dropped
+  std::vector<index_t> feature_list;
+  std::vector<index_t> expected;
+  for (index_t i = 0; i < kRows; ++i) {
+    if (i % 2 == 0) { feature_list.push_back(i); }
+    expected.push_back(i % 2 == 0 ? i / 2 : FeatureIdMap::kNotFound);
+  }
+  FeatureIdMap id_map;
+  id_map.Build(feature_list);
+  // Parse the text file, map the bin file, and compress the data
+  for (int n = 0; n < 3; ++n) {
+    InmemReader reader;
+    reader.SetCompress(n == 2);
+    reader.Initialize(filename);
+    reader.SetFeatureMap(&id_map);
+    // The ids are mapped only once
+    for (int epoch = 0; epoch < 2; ++epoch) {
+      EXPECT_EQ(read_mapped_ids(reader), expected);
+    }
+    InmemReader view;
+    view.InitializeView(&reader, 0, kRows);
+    EXPECT_EQ(read_mapped_ids(view), expected);
+  }
+  // On-disk reader
+  OndiskReader disk_reader;
+  disk_reader.SetNoBin();
+  disk_reader.Initialize(filename);
+  disk_reader.SetFeatureMap(&id_map);
+  for (int epoch = 0; epoch < 2; ++epoch) {
+    EXPECT_EQ(read_mapped_ids(disk_reader), expected);
+  }
+  RemoveFile(filename.c_str());
+  RemoveFile(bin_file.c_str());
+}
+
+uint64 bin_file_size(const std::string& filename) {
+  FileSignature sig;
+  sig.Load(filename);
+  return sig.size;
+}
+
+TEST(ReaderTest, CompressedBinaryFile) {
+  string filename = kTestfilename + "_bin_compress.txt";
+  string bin_file = filename + ".bin";
+  remove(bin_file.c_str());
+  const index_t kRows = 50000;
+  FILE* file = OpenFileOrDie(filename.c_str(), "w");
+  for (index_t i = 0; i < kRows; ++i) {
+    string line = StringPrintf("%d %d:%d:0.5\n", i % 2, i % 5, i);
+    WriteDataToDisk(file, line.data(), line.size());
+  }
+  Close(file);
+  // Generate the raw bin file
+  std::vector<index_t> expected;
+  {
+    InmemReader reader;
+    reader.Initialize(filename);
+    expected = read_feat_ids(reader);
+  }
+  uint64 raw_size = bin_file_size(bin_file);
+  // The raw bin file is regenerated in compressed format
+  for (int n = 0; n < 2; ++n) {
+    InmemReader reader;
+    reader.SetBinCompress(true);
+    reader.SetThreadNumber(4);
+    reader.Initialize(filename);
+    EXPECT_EQ(read_feat_ids(reader), expected);
+    EXPECT_EQ(reader.NNZ(), kRows);
+  }
+  EXPECT_LT(bin_file_size(bin_file), raw_size);
+  // The compressed bin file is used in compressed mode
+  // and in the default mode (decoded in parallel).
+  {
+    InmemReader reader;
+    reader.SetCompress(true, false);
+    reader.Initialize(filename);
+    EXPECT_EQ(read_feat_ids(reader), expected);
+  }
+  {
+    InmemReader reader;
+    reader.SetThreadNumber(4);
+    reader.Initialize(filename);
+    EXPECT_EQ(reader.MaxFeat(), kRows - 1);
+    EXPECT_EQ(read_feat_ids(reader), expected);
+  }
+  // The quantized bin file of the compressed mode
+  // is not used without quantization.
+  remove(bin_file.c_str());
+  {
+    InmemReader reader;
+    reader.SetCompress(true, true);
+    reader.Initialize(filename);
+    EXPECT_EQ(read_feat_ids(reader), expected);
+  }
+  {
+    MappedMatrix mmat;
+    ASSERT_TRUE(mmat.Open(bin_file));
+    EXPECT_TRUE(mmat.IsQuantized());
+  }
+  {
+    InmemReader reader;
+    reader.Initialize(filename);
+    EXPECT_EQ(read_feat_ids(reader), expected);
+  }
+  {
+    MappedMatrix mmat;
+    ASSERT_TRUE(mmat.Open(bin_file));
+    EXPECT_FALSE(mmat.IsQuantized());
+  }
+  RemoveFile(filename.c_str());
+  RemoveFile(bin_file.c_str());
+}
+
+void read_from_compressed(const std::string& filename,
+                          index_t field, bool quantize) {
+  InmemReader reader;
+  reader.SetCompress(true, quantize);
+  reader.Initialize(filename);
+  DMatrix* matrix = nullptr;
+  for (int n = 0; n < 2; ++n) {
+    index_t total = 0;
+    for (;;) {
+      index_t record_num = reader.Samples(matrix);
+      if (record_num == 0) { break; }
+      EXPECT_EQ(matrix->row_length, record_num);
+      for (index_t i = 0; i < matrix->row_length; ++i) {
+        SparseRow *row = matrix->row[i];
+        EXPECT_EQ(row->size(), 3);
+        for (SparseRow::iterator iter = row->begin();
+             iter != row->end(); ++iter) {
+          EXPECT_EQ(iter->field_id, field);
+          EXPECT_EQ(iter->feat_id, 1);
+          EXPECT_NEAR(iter->feat_val, 0.123, 0.001);
+        }
+        EXPECT_FLOAT_EQ(matrix->norm[i], 22.03274);
+      }
+      total += record_num;
+    }
+    EXPECT_EQ(total, kNumLines);
+    reader.Reset();
+  }
+}
+
+TEST(ReaderTest, SampleFromCompressed) {
+  string lr_file = kTestfilename + "_LR.txt";
+  string ffm_file = kTestfilename + "_ffm.txt";
+  // Compress data from the existing bin file
+  read_from_compressed(lr_file, 0, false);
+  read_from_compressed(ffm_file, 1, true);
+  // Compress data from txt file
+  RemoveFile((lr_file + ".bin").c_str());
+  RemoveFile((ffm_file + ".bin").c_str());
+  read_from_compressed(lr_file, 0, true);
+  read_from_compressed(ffm_file, 1, false);
+  // The compressed bin file is generated in compressed mode
+  EXPECT_EQ(FileExist((lr_file + ".bin").c_str()), true);
+  // Generate the bin file again for the next test
+  read_from_memory(lr_file, 0);
+  read_from_memory(ffm_file, 1);
+}
+
+TEST(ReaderTest, Statistics) {
+  string ffm_file = kTestfilename + "_ffm.txt";
+  InmemReader in_mem_reader;
+  in_mem_reader.Initialize(ffm_file);
+  EXPECT_EQ(in_mem_reader.MaxFeat(), 1);
+  EXPECT_EQ(in_mem_reader.MaxField(), 1);
+  EXPECT_EQ(in_mem_reader.NNZ(), kNumLines * 3);
+  // Parse the file without the cache, generate the cache
+  // in the second time, and load it in the third time.
+  for (int i = 0; i < 3; ++i) {
+    OndiskReader reader;
+    reader.SetBlockSize(1);
+    if (i == 0) {
+      reader.SetNoBin();
+      remove(reader.CacheFile().c_str());
+    }
+    reader.Initialize(ffm_file);
+    EXPECT_EQ(FileExist(reader.CacheFile().c_str()), i > 0);
+    EXPECT_EQ(reader.UseCache(), i > 0);
+    EXPECT_EQ(reader.MaxFeat(), 1);
+    EXPECT_EQ(reader.MaxField(), 1);
+    EXPECT_EQ(reader.NNZ(), kNumLines * 3);
+    // The reader is at the beginning of the file
+    DMatrix* matrix = nullptr;
+    EXPECT_GT(reader.Samples(matrix), 0);
+    EXPECT_EQ(matrix->Y[0], 1);
+  }
+}
+
+// Read all the blocks and record the rows and nnz of each block.
+void read_all_blocks(OndiskReader& reader,
+                     std::vector<index_t>& rows,
+                     std::vector<index_t>& nnz) {
+  rows.clear();
+  nnz.clear();
+  DMatrix* matrix = nullptr;
+  while (reader.Samples(matrix) > 0) {
+    rows.push_back(matrix->row_length);
+    nnz.push_back(matrix->nnz);
+    EXPECT_EQ(matrix->Y[0], 1);
+  }
+  // Keep returning 0 at the end of file
+  EXPECT_EQ(reader.Samples(matrix), 0);
+  EXPECT_TRUE(matrix == nullptr);
+}
+
+TEST(ReaderTest, SampleFromDiskPrefetch) {
+  string ffm_file = kTestfilename + "_ffm.txt";
+  std::vector<index_t> rows_sync, nnz_sync;
+  {
+    OndiskReader reader;
+    reader.SetBlockSize(1);
+    reader.SetPrefetch(0);
+    reader.Initialize(ffm_file);
+    read_all_blocks(reader, rows_sync, nnz_sync);
+  }
+  EXPECT_GT(rows_sync.size(), 1);
+  int depth_list[] = {1, 3};
+  for (int d = 0; d < 2; ++d) {
+    OndiskReader reader;
+    reader.SetBlockSize(1);
+    reader.SetPrefetch(depth_list[d]);
+    reader.SetThreadNumber(2);
+    reader.Initialize(ffm_file);
+    std::vector<index_t> rows, nnz;
+    for (int epoch = 0; epoch < 3; ++epoch) {
+      read_all_blocks(reader, rows, nnz);
+      EXPECT_EQ(rows, rows_sync);
+      EXPECT_EQ(nnz, nnz_sync);
+      reader.Reset();
+      // Reset in the middle of the file
+      DMatrix* matrix = nullptr;
+      EXPECT_EQ(reader.Samples(matrix), rows_sync[0]);
+      reader.Reset();
+    }
+  }
+}
+
+TEST(ReaderTest, SampleFromDiskMmap) {
+  string ffm_file = kTestfilename + "_ffm.txt";
+  // Read the text file, not the binary cache
+  remove((ffm_file + ".cache").c_str());
+  std::vector<index_t> rows[2], nnz[2];
+  for (int m = 0; m < 2; ++m) {
+    OndiskReader reader;
+    reader.SetBlockSize(1);
+    reader.SetMmap(m == 0);
+    reader.SetNoBin();
+    reader.Initialize(ffm_file);
+    for (int epoch = 0; epoch < 2; ++epoch) {
+      read_all_blocks(reader, rows[m], nnz[m]);
+      reader.Reset();
+    }
+  }
+  EXPECT_GT(rows[0].size(), 1);
+  EXPECT_EQ(rows[0], rows[1]);
+  EXPECT_EQ(nnz[0], nnz[1]);
+  // In-memory reader
+  DMatrix* matrix[2];
+  InmemReader reader[2];
+  for (int m = 0; m < 2; ++m) {
+    reader[m].SetBlockSize(1);
+    reader[m].SetMmap(m == 0);
+    reader[m].Initialize(ffm_file);
+    matrix[m] = nullptr;
+    reader[m].Samples(matrix[m]);
+  }
+  ASSERT_EQ(matrix[0]->row_length, matrix[1]->row_length);
+  EXPECT_EQ(matrix[0]->Y, matrix[1]->Y);
+  for (index_t i = 0; i < matrix[0]->row_length; ++i) {
+    EXPECT_EQ(matrix[0]->row[i]->size(), matrix[1]->row[i]->size());
+  }
+}
+
+TEST(ReaderTest, DiskBinaryCache) {
+  string ffm_file = kTestfilename + "_ffm.txt";
+  remove((ffm_file + ".cache").c_str());
+  // Without the statistics (e.g., prediction), the text file is
+  // read once, and the cache is not generated.
+  std::vector<index_t> rows_once, nnz_once;
+  {
+    OndiskReader reader;
+    reader.SetBlockSize(1);
+    reader.SetNeedStats(false);
+    reader.Initialize(ffm_file);
+    EXPECT_FALSE(reader.UseCache());
+    EXPECT_FALSE(FileExist((ffm_file + ".cache").c_str()));
+    read_all_blocks(reader, rows_once, nnz_once);
+  }
+  // Parse the text file, generate the cache, and then load
+  // the cache (and verify it by hashing the text file). The
+  // last reader keeps some of the blocks in memory.
+  std::vector<index_t> rows[4], nnz[4];
+  for (int i = 0; i < 4; ++i) {
+    OndiskReader reader;
+    reader.SetBlockSize(1);
+    reader.SetPrefetch(i % 3);
+    if (i == 0) { reader.SetNoBin(); }
+    if (i == 2) { reader.SetVerifyBin(true); }
+    if (i == 3) { reader.SetMemoryBudget(2); }
+    reader.Initialize(ffm_file);
+    EXPECT_EQ(reader.UseCache(), i > 0);
+    EXPECT_EQ(reader.MaxFeat(), 1);
+    EXPECT_EQ(reader.MaxField(), 1);
+    EXPECT_EQ(reader.NNZ(), kNumLines * 3);
+    for (int epoch = 0; epoch < 2; ++epoch) {
+      read_all_blocks(reader, rows[i], nnz[i]);
+      reader.Reset();
+    }
+  }
+  EXPECT_GT(rows[0].size(), 1);
+  EXPECT_EQ(rows[0], rows_once);
+  EXPECT_EQ(nnz[0], nnz_once);
+  EXPECT_EQ(rows[0], rows[1]);
+  EXPECT_EQ(nnz[0], nnz[1]);
+  EXPECT_EQ(rows[0], rows[2]);
+  EXPECT_EQ(nnz[0], nnz[2]);
+  EXPECT_EQ(rows[0], rows[3]);
+  EXPECT_EQ(nnz[0], nnz[3]);
+  // The cache is generated again if the text file is modified
+  string filename = kTestfilename + "_cache.txt";
+  for (int label = 0; label < 2; ++label) {
+    FILE* file = OpenFileOrDie(filename.c_str(), "w");
+    for (index_t i = 0; i < 100; ++i) {
+      string line = StringPrintf("%d %d:1\n", label, i);
+      WriteDataToDisk(file, line.data(), line.size());
+    }
+    Close(file);
+    OndiskReader reader;
+    reader.Initialize(filename);
+    EXPECT_TRUE(reader.UseCache());
+    DMatrix* matrix = nullptr;
+    EXPECT_EQ(reader.Samples(matrix), 100);
+    EXPECT_EQ(matrix->Y[0], label);
+  }
+  RemoveFile(filename.c_str());
+  RemoveFile((filename + ".cache").c_str());
+}
+
+#ifdef XLEARN_USE_ZLIB
+TEST(ReaderTest, SampleFromGzip) {
+  string ffm_file = kTestfilename + "_ffm.txt";
+  string gz_file = kTestfilename + "_ffm.txt.gz";
+  // Compress the text file
+  char* buf = nullptr;
+  uint64 len = ReadFileToMemory(ffm_file, &buf);
+  gzFile file = gzopen(gz_file.c_str(), "wb");
+  gzwrite(file, buf, len);
+  gzclose(file);
+  delete [] buf;
+  remove((ffm_file + ".cache").c_str());
+  std::vector<index_t> rows[2], nnz[2];
+  string file_list[] = {ffm_file, gz_file};
+  for (int f = 0; f < 2; ++f) {
+    OndiskReader reader;
+    reader.SetBlockSize(1);
+    reader.SetNoBin();
+    reader.Initialize(file_list[f]);
+    for (int epoch = 0; epoch < 2; ++epoch) {
+      read_all_blocks(reader, rows[f], nnz[f]);
+      reader.Reset();
+    }
+  }
+  EXPECT_GT(rows[0].size(), 1);
+  EXPECT_EQ(rows[0], rows[1]);
+  EXPECT_EQ(nnz[0], nnz[1]);
+  // Only the shuffle window is used for compressed file, 
+  // but the chunks of its binary cache can be shuffled.
+  for (int cache = 0; cache < 2; ++cache) {
+    OndiskReader reader;
+    reader.SetBlockSize(1);
+    reader.SetShuffleWindow(cache ? 0 : 1000);
+    if (!cache) { reader.SetNoBin(); }
+    reader.Initialize(gz_file);
+    reader.SetShuffle(true);
+    EXPECT_EQ(reader.UseCache(), cache == 1);
+    bool changed = false;
+    for (int epoch = 0; epoch < 5; ++epoch) {
+      std::vector<index_t> rows_shuffle, nnz_shuffle;
+      read_all_blocks(reader, rows_shuffle, nnz_shuffle);
+      if (rows_shuffle != rows[1]) { changed = true; }
+      std::sort(rows_shuffle.begin(), rows_shuffle.end());
+      std::sort(nnz_shuffle.begin(), nnz_shuffle.end());
+      std::vector<index_t> rows_sort = rows[1], nnz_sort = nnz[1];
+      std::sort(rows_sort.begin(), rows_sort.end());
+      std::sort(nnz_sort.begin(), nnz_sort.end());
+      if (cache) {
+        EXPECT_EQ(rows_shuffle, rows_sort);
+        EXPECT_EQ(nnz_shuffle, nnz_sort);
+      }
+      index_t sum = 0;
+      for (size_t i = 0; i < rows_shuffle.size(); ++i) {
+        sum += rows_shuffle[i];
+      }
+      EXPECT_EQ(sum, kNumLines);
+      reader.Reset();
+    }
+    if (cache) { EXPECT_TRUE(changed); }
+  }
+  // In-memory reader
+  DMatrix* matrix[2];
+  InmemReader reader[2];
+  for (int f = 0; f < 2; ++f) {
+    reader[f].SetBlockSize(1);
+    reader[f].Initialize(file_list[f]);
+    matrix[f] = nullptr;
+    reader[f].Samples(matrix[f]);
+  }
+  ASSERT_EQ(matrix[0]->row_length, matrix[1]->row_length);
+  EXPECT_EQ(matrix[0]->Y, matrix[1]->Y);
+  for (index_t i = 0; i < matrix[0]->row_length; ++i) {
+    EXPECT_EQ(matrix[0]->row[i]->size(), matrix[1]->row[i]->size());
+  }
+  RemoveFile(gz_file.c_str());
+  RemoveFile((gz_file + ".bin").c_str());
+  RemoveFile((gz_file + ".cache").c_str());
+}
+#endif  // XLEARN_USE_ZLIB
+
+// Split the file into several shards in a directory.
+std::vector<std::string> split_file(const std::string& filename,
+                                    const std::string& dir,
+                                    int num_shard) {
+  std::vector<std::string> lines;
+  std::ifstream in(filename);
+  std::string line;
+  while (std::getline(in, line)) { lines.push_back(line); }
+#ifndef _MSC_VER
+  mkdir(dir.c_str(), 0755);
+#else
+  _mkdir(dir.c_str());
+#endif
+  std::vector<std::string> files;
+  size_t len = (lines.size() + num_shard - 1) / num_shard;
+  for (int i = 0; i < num_shard; ++i) {
+    files.push_back(StringPrintf("%s/part-%d.txt", dir.c_str(), i));
+    std::ofstream out(files.back());
+    for (size_t j = i * len; j < std::min(lines.size(), (i+1) * len); ++j) {
+      out << lines[j] << "\n";
+    }
+  }
+  return files;
+}
+
+TEST(ReaderTest, SampleFromMultiFile) {
+  string ffm_file = kTestfilename + "_ffm.txt";
+  string dir = kTestfilename + "_dir";
+  std::vector<std::string> files = split_file(ffm_file, dir, 3);
+  string type_list[] = {"memory", "disk"};
+  for (int t = 0; t < 2; ++t) {
+    for (int threads = 1; threads <= 2; ++threads) {
+      MultiReader reader;
+      reader.SetReaderType(type_list[t]);
+      reader.SetReaderThreads(threads);
+      reader.SetBlockSize(1);
+      reader.Initialize(dir);
+      reader.SetShuffle(true);
+      EXPECT_EQ(reader.FileList(), files);
+      EXPECT_TRUE(reader.has_label());
+      EXPECT_EQ(reader.MaxFeat(), 1);
+      EXPECT_EQ(reader.MaxField(), 1);
+      EXPECT_EQ(reader.NNZ(), kNumLines * 3);
+      for (int epoch = 0; epoch < 2; ++epoch) {
+        reader.Reset();
+        DMatrix* matrix = nullptr;
+        index_t rows = 0;
+        while (reader.Samples(matrix) > 0) {
+          rows += matrix->row_length;
+          EXPECT_EQ(matrix->Y[0], 1);
+        }
+        EXPECT_EQ(rows, kNumLines);
+      }
+    }
+  }
+  // The order of files in each epoch
+  MultiReader reader;
+  reader.SetReaderType("memory");
+  reader.SetShuffleFiles(true);
+  reader.SetNoBin();
+  reader.Initialize(dir + "/part-*.txt");
+  // The last shard has fewer rows than the others
+  std::vector<index_t> order, first_order;
+  bool changed = false;
+  for (int epoch = 0; epoch < 10; ++epoch) {
+    reader.Reset();
+    order.clear();
+    DMatrix* matrix = nullptr;
+    while (reader.Samples(matrix) > 0) {
+      order.push_back(matrix->row_length);
+    }
+    EXPECT_EQ(order.size(), 3);
+    if (epoch == 0) { first_order = order; }
+    if (order != first_order) { changed = true; }
+  }
+  EXPECT_TRUE(changed);
+  for (size_t i = 0; i < files.size(); ++i) {
+    RemoveFile(files[i].c_str());
+    string bin_file = files[i] + ".bin";
+    if (FileExist(bin_file.c_str())) { RemoveFile(bin_file.c_str()); }
+    string cache_file = files[i] + ".cache";
+    if (FileExist(cache_file.c_str())) { RemoveFile(cache_file.c_str()); }
+  }
+  remove(dir.c_str());
+}
+
+// Read one epoch and return the feature id of each row.
+#ifndef _MSC_VER
+// Write the file to a pipe in small pieces, which
+// are not aligned to the lines.
+void write_pipe(const std::string& filename, const std::string& pipe) {
+  char* buf = nullptr;
+  uint64 len = ReadFileToMemory(filename, &buf);
+  FILE* file = OpenFileOrDie(pipe.c_str(), "wb");
+  for (uint64 pos = 0; pos < len; pos += 1001) {
+    size_t size = std::min(len - pos, (uint64)1001);
+    WriteDataToDisk(file, buf + pos, size);
+    fflush(file);
+  }
+  Close(file);
+  delete [] buf;
+}
+
+TEST(ReaderTest, SampleFromStream) {
+  string pipe = kTestfilename + "_pipe";
+  string file_list[] = { kTestfilename + "_ffm.txt",
+                         kTestfilename + "_ffm_no.txt" };
+  bool label_list[] = { true, false };
+  for (int f = 0; f < 2; ++f) {
+    ASSERT_EQ(mkfifo(pipe.c_str(), 0600), 0);
+    std::thread writer(write_pipe, file_list[f], pipe);
+    StreamReader reader;
+    reader.SetFormat("libffm");
+    reader.SetBlockSize(1);
+    reader.Initialize(pipe);
+    // Nothing has been read yet
+    reader.Reset();
+    EXPECT_EQ(reader.has_label(), label_list[f]);
+    DMatrix* matrix = nullptr;
+    index_t rows = 0;
+    for (;;) {
+      index_t tmp = reader.Samples(matrix);
+      if (tmp == 0) { break; }
+      rows += tmp;
+      EXPECT_EQ(matrix->Y[0], label_list[f] ? 1 : -2);
+      EXPECT_EQ(matrix->nnz, tmp * 3);
+    }
+    EXPECT_EQ(rows, kNumLines);
+    EXPECT_EQ(reader.Samples(matrix), 0);
+    EXPECT_TRUE(matrix == nullptr);
+    writer.join();
+    RemoveFile(pipe.c_str());
+  }
+}
+#endif
+
+void read_epoch(OndiskReader& reader, std::vector<index_t>& ids) {
+  ids.clear();
+  reader.Reset();
+  DMatrix* matrix = nullptr;
+  while (reader.Samples(matrix) > 0) {
+    EXPECT_EQ(matrix->nnz, matrix->row_length);
+    for (index_t i = 0; i < matrix->row_length; ++i) {
+      index_t id = (*matrix->row[i])[0].feat_id;
+      EXPECT_EQ(matrix->Y[i], id % 2);
+      ids.push_back(id);
+    }
+  }
+}
+
+TEST(ReaderTest, ShuffleDisk) {
+  // Each row has a different feature id
+  string filename = kTestfilename + "_shuffle.txt";
+  const index_t kRows = 300000;
+  FILE* file = OpenFileOrDie(filename.c_str(), "w");
+  for (index_t i = 0; i < kRows; ++i) {
+    string line = StringPrintf("%d %d:1\n", i % 2, i);
+    WriteDataToDisk(file, line.data(), line.size());
+  }
+  Close(file);
+  std::vector<index_t> seq_ids;
+  {
+    OndiskReader reader;
+    reader.SetBlockSize(1);
+    reader.SetNoBin();
+    reader.Initialize(filename);
+    read_epoch(reader, seq_ids);
+    ASSERT_EQ(seq_ids.size(), kRows);
+    for (index_t i = 0; i < kRows; ++i) {
+      EXPECT_EQ(seq_ids[i], i);
+    }
+  }
+  // Block order, and block order with shuffle buffer
+  index_t window_list[] = {0, 1000};
+  for (int w = 0; w < 2; ++w) {
+    std::vector<std::vector<index_t> > epochs[3];
+    for (int m = 0; m < 3; ++m) {
+      OndiskReader reader;
+      reader.SetBlockSize(1);
+      // The last reader uses the binary cache
+      if (m < 2) { reader.SetNoBin(); }
+      reader.SetPrefetch(m % 2);
+      reader.SetShuffleWindow(window_list[w]);
+      reader.Initialize(filename);
+      EXPECT_EQ(reader.UseCache(), m == 2);
+      EXPECT_EQ(reader.NNZ(), kRows);
+      reader.SetShuffle(true);
+      for (int epoch = 0; epoch < 2; ++epoch) {
+        std::vector<index_t> ids;
+        read_epoch(reader, ids);
+        epochs[m].push_back(ids);
+        // Every row is visited once in an epoch
+        EXPECT_NE(ids, seq_ids);
+        std::sort(ids.begin(), ids.end());
+        EXPECT_EQ(ids, seq_ids);
+      }
+      EXPECT_NE(epochs[m][0], epochs[m][1]);
+    }
+    // Prefetch and the binary cache do not change the result,
+    // since the chunks of the cache are the blocks of the file.
+    EXPECT_EQ(epochs[0], epochs[1]);
+    EXPECT_EQ(epochs[0], epochs[2]);
+    RemoveFile((filename + ".cache").c_str());
+  }
+  RemoveFile(filename.c_str());
+}
+
+TEST(ReaderTest, SampleFromDisk) {
   // has label
   string lr_file = kTestfilename + "_LR.txt";
   string ffm_file = kTestfilename + "_ffm.txt";
@@ -367,6 +1322,95 @@ TEST(ReaderTest, SampleFromDisk) {
   delete_file();
 }
 
+TEST(ReaderTest, ShuffleChunk) {
+  DMatrix* data = new DMatrix;
+  for (index_t i = 0; i < 1000; ++i) {
+    data->AddRow();
+    data->AddNode(i, i, 1.0);
+  }
+  FromDMReader reader;
+  reader.SetShuffleChunk(64);
+  reader.Initialize(data);
+  reader.SetShuffle(true);
+  DMatrix* matrix = nullptr;
+  std::vector<index_t> last_order;
+  for (int epoch = 0; epoch < 3; ++epoch) {
+    reader.Reset();
+    EXPECT_EQ(reader.Samples(matrix), 1000);
+    std::vector<index_t> order(1000);
+    std::vector<bool> visit(1000, false);
+    for (index_t i = 0; i < 1000; ++i) {
+      order[i] = (*matrix->row[i])[0].feat_id;
+      visit[order[i]] = true;
+    }
+    // A permutation of rows, and each chunk is contiguous
+    for (index_t i = 0; i < 1000; ++i) {
+      EXPECT_TRUE(visit[i]);
+    }
+    for (index_t i = 0; i < 1000; ) {
+      index_t chunk = order[i] / 64;
+      index_t len = std::min((index_t)64, 1000 - chunk * 64);
+      for (index_t j = i; j < i + len; ++j) {
+        EXPECT_EQ(order[j] / 64, chunk);
+      }
+      i += len;
+    }
+    EXPECT_NE(order, last_order);
+    last_order = order;
+    EXPECT_EQ(reader.Samples(matrix), 0);
+  }
+  delete data;
+}
+
+// For each chunk size, including 0 (shuffle the rows), a size that
+// does not divide the rows, and a size larger than the data, every
+// epoch is a permutation of the rows, which is not the identity.
+TEST(ReaderTest, ShuffleChunkPermutation) {
+  const index_t kRows = 5000;
+  DMatrix* data = new DMatrix;
+  for (index_t i = 0; i < kRows; ++i) {
+    data->AddRow();
+    data->AddNode(i, i, 1.0);
+  }
+  index_t chunk_list[] = {0, 1, 16, 300, 4096, 8192};
+  for (int c = 0; c < 6; ++c) {
+    FromDMReader reader;
+    reader.SetShuffleChunk(chunk_list[c]);
+    reader.Initialize(data);
+    reader.SetShuffle(true);
+    DMatrix* matrix = nullptr;
+    for (int epoch = 0; epoch < 3; ++epoch) {
+      reader.Reset();
+      ASSERT_EQ(reader.Samples(matrix), kRows);
+      std::vector<bool> visit(kRows, false);
+      index_t num_fixed = 0;
+      for (index_t i = 0; i < kRows; ++i) {
+        index_t id = (*matrix->row[i])[0].feat_id;
+        ASSERT_LT(id, kRows);
+        EXPECT_FALSE(visit[id]);
+        visit[id] = true;
+        if (id == i) { num_fixed++; }
+      }
+      EXPECT_LT(num_fixed, kRows);
+      // Each run of chunk rows comes from a single chunk
+      index_t chunk_size = chunk_list[c];
+      if (chunk_size > 1) {
+        for (index_t i = 0; i < kRows; ) {
+          index_t chunk = (*matrix->row[i])[0].feat_id / chunk_size;
+          index_t len = std::min(chunk_size, kRows - chunk * chunk_size);
+          ASSERT_LE(i + len, kRows);
+          for (index_t j = i; j < i + len; ++j) {
+            EXPECT_EQ((*matrix->row[j])[0].feat_id / chunk_size, chunk);
+          }
+          i += len;
+        }
+      }
+      EXPECT_EQ(reader.Samples(matrix), 0);
+    }
+  }
+  delete data;
+}
+
 Reader* CreateReader(const char* format_name) {
   return CREATE_READER(format_name);
 }
@@ -374,6 +1418,7 @@ Reader* CreateReader(const char* format_name) {
 TEST(READER_TEST, CreateReader) {
   EXPECT_TRUE(CreateReader("memory") != NULL);
   EXPECT_TRUE(CreateReader("disk") != NULL);
+  EXPECT_TRUE(CreateReader("stream") != NULL);
   EXPECT_TRUE(CreateReader("") == NULL);
   EXPECT_TRUE(CreateReader("unknow_name") == NULL);
 }
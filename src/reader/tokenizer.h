@@ -0,0 +1,244 @@
+//------------------------------------------------------------------------------
+// Copyright (c) 2018 by contributors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//------------------------------------------------------------------------------
+
+/*
+This file defines the tokenizer functions used by Parser, which
+read lines and numbers directly from the memory buffer.
+*/
+
+#ifndef XLEARN_READER_TOKENIZER_H_
+#define XLEARN_READER_TOKENIZER_H_
+
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>  // for SSE2
+#define XLEARN_TOKENIZER_SSE2
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#include "src/base/common.h"
+#include "src/data/data_structure.h"
+
+namespace xLearn {
+
+//------------------------------------------------------------------------------
+// All the functions in this file work on a [ptr, end) range of
+// the memory buffer. They never write the buffer and never read
+// beyond the end, so the buffer does not need to end with '\0'.
+// A number function moves ptr to the first character that does
+// not belong to the number. We can parse a libsvm line like this:
+//
+//   const char* ptr = buf;
+//   const char* end = buf + size;
+//   while (ptr < end) {
+//     const char* line = ptr;
+//     const char* line_end = NextLine(ptr, end);
+//     real_t y = ParseReal(line, line_end);
+//     SkipBlank(line, line_end, ' ');
+//     index_t idx = ParseIndex(line, line_end);
+//     ... /* check and skip ':' */
+//     real_t value = ParseReal(line, line_end);
+//     ...
+//   }
+//------------------------------------------------------------------------------
+
+// Max length of a number that is parsed by strtod()
+static const int kMaxNumberLength = 64;
+
+inline bool IsDigit(char c) {
+  return static_cast<unsigned char>(c - '0') < 10;
+}
+
+inline bool IsBlank(char c, char splitor) {
+  return c == splitor || c == ' ' || c == '\t';
+}
+
+// Return the index of the lowest set bit.
+inline int CountTrailingZeros(uint32 value) {
+#ifdef _MSC_VER
+  unsigned long index;
+  _BitScanForward(&index, value);
+  return static_cast<int>(index);
+#else
+  return __builtin_ctz(value);
+#endif
+}
+
+// Return the first position of c in [ptr, end), or end
+// if not found. We scan 16 bytes at a time using SSE2.
+inline const char* FindByte(const char* ptr, const char* end, char c) {
+#ifdef XLEARN_TOKENIZER_SSE2
+  const __m128i target = _mm_set1_epi8(c);
+  while (end - ptr >= 16) {
+    __m128i chunk = _mm_loadu_si128(
+      reinterpret_cast<const __m128i*>(ptr));
+    uint32 mask = _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, target));
+    if (mask != 0) {
+      return ptr + CountTrailingZeros(mask);
+    }
+    ptr += 16;
+  }
+#endif
+  while (ptr < end && *ptr != c) { ++ptr; }
+  return ptr;
+}
+
+// Return the end of the line that starts at ptr, and move
+// ptr to the beginning of the next line. The '\r' of the
+// windows or DOS format is not a part of the line.
+inline const char* NextLine(const char*& ptr, const char* end) {
+  const char* line_begin = ptr;
+  const char* line_end = FindByte(ptr, end, '\n');
+  ptr = line_end < end ? line_end + 1 : end;
+  if (line_end > line_begin && line_end[-1] == '\r') {
+    --line_end;
+  }
+  return line_end;
+}
+
+// Skip the splitors and blank characters.
+inline void SkipBlank(const char*& ptr, const char* end, char splitor) {
+  while (ptr < end && IsBlank(*ptr, splitor)) { ++ptr; }
+}
+
+// Skip the remaining characters of current token.
+inline void SkipToken(const char*& ptr, const char* end, char splitor) {
+  while (ptr < end && !IsBlank(*ptr, splitor)) { ++ptr; }
+}
+
+// Parse an integer id. Like atoi(), the parsing stops at
+// the first non-digit character, and a negative number
+// wraps around.
+inline index_t ParseIndex(const char*& ptr, const char* end) {
+  bool negative = false;
+  if (ptr < end && (*ptr == '-' || *ptr == '+')) {
+    negative = (*ptr == '-');
+    ++ptr;
+  }
+  index_t value = 0;
+  while (ptr < end && IsDigit(*ptr)) {
+    value = value * 10 + (*ptr - '0');
+    ++ptr;
+  }
+  return negative ? 0 - value : value;
+}
+
+// Parse a number that the fast path cannot handle using strtod().
+inline real_t parse_real_slow(const char*& ptr, const char* end) {
+  char tmp[kMaxNumberLength + 1];
+  int len = 0;
+  while (ptr + len < end && len < kMaxNumberLength &&
+         ptr[len] != ':' && ptr[len] != ',' &&
+         ptr[len] != ' ' && ptr[len] != '\t' &&
+         ptr[len] != '\r' && ptr[len] != '\n') {
+    tmp[len] = ptr[len];
+    ++len;
+  }
+  tmp[len] = '\0';
+  char* tmp_end = tmp;
+  double value = strtod(tmp, &tmp_end);
+  ptr += tmp_end - tmp;
+  return static_cast<real_t>(value);
+}
+
+// Parse a floating-point number. The result is always the same
+// as (real_t)atof(): if the decimal mantissa has at most 19
+// significant digits and fits in 2^53, and the decimal exponent
+// is in [-22, 22], both the mantissa and the power of ten are
+// exact doubles, so one multiplication or division is correctly
+// rounded (Clinger's fast path). Otherwise we use strtod().
+inline real_t ParseReal(const char*& ptr, const char* end) {
+  static const double kPow10[] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,
+    1e8,  1e9,  1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+    1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+  };
+  const char* p = ptr;
+  bool negative = false;
+  if (p < end && (*p == '-' || *p == '+')) {
+    negative = (*p == '-');
+    ++p;
+  }
+  uint64 mantissa = 0;
+  int digits = 0;
+  int exp10 = 0;
+  bool has_digit = false;
+  // Integer part
+  while (p < end && IsDigit(*p)) {
+    if (mantissa != 0 || *p != '0') { digits++; }
+    mantissa = mantissa * 10 + (*p - '0');
+    has_digit = true;
+    ++p;
+  }
+  // Fraction part
+  if (p < end && *p == '.') {
+    ++p;
+    while (p < end && IsDigit(*p)) {
+      if (mantissa != 0 || *p != '0') { digits++; }
+      mantissa = mantissa * 10 + (*p - '0');
+      exp10--;
+      has_digit = true;
+      ++p;
+    }
+  }
+  // inf, nan, hex and other special cases
+  if (!has_digit || digits > 19 ||
+      (p < end && (*p == 'x' || *p == 'X'))) {
+    return parse_real_slow(ptr, end);
+  }
+  // Exponent part
+  if (p < end && (*p == 'e' || *p == 'E')) {
+    ++p;
+    bool exp_negative = false;
+    if (p < end && (*p == '-' || *p == '+')) {
+      exp_negative = (*p == '-');
+      ++p;
+    }
+    if (p == end || !IsDigit(*p)) {
+      return parse_real_slow(ptr, end);
+    }
+    int exp = 0;
+    while (p < end && IsDigit(*p)) {
+      if (exp < 10000) { exp = exp * 10 + (*p - '0'); }
+      ++p;
+    }
+    exp10 += exp_negative ? -exp : exp;
+  }
+  double value;
+  if (mantissa == 0) {
+    value = 0.0;
+  } else if (mantissa <= (1ULL << 53) && exp10 >= -22 && exp10 <= 22) {
+    value = static_cast<double>(mantissa);
+    if (exp10 < 0) {
+      value /= kPow10[-exp10];
+    } else {
+      value *= kPow10[exp10];
+    }
+  } else {
+    return parse_real_slow(ptr, end);
+  }
+  ptr = p;
+  return static_cast<real_t>(negative ? -value : value);
+}
+
+}  // namespace xLearn
+
+#endif  // XLEARN_READER_TOKENIZER_H_
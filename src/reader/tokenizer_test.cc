@@ -0,0 +1,153 @@
+//------------------------------------------------------------------------------
+// Copyright (c) 2018 by contributors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//------------------------------------------------------------------------------
+
+/*
+This file tests tokenizer.h file.
+*/
+
+#include "gtest/gtest.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <cmath>
+#include <random>
+#include <string>
+
+#include "src/reader/tokenizer.h"
+
+namespace xLearn {
+
+TEST(TOKENIZER_TEST, FindByte) {
+  std::string str(100, 'a');
+  const char* begin = str.data();
+  const char* end = begin + str.size();
+  EXPECT_EQ(FindByte(begin, end, '\n'), end);
+  for (size_t i = 0; i < str.size(); ++i) {
+    str[i] = '\n';
+    EXPECT_EQ(FindByte(begin, end, '\n'), begin + i);
+    // Never read beyond the end
+    EXPECT_EQ(FindByte(begin, begin + i, '\n'), begin + i);
+    str[i] = 'a';
+  }
+}
+
+TEST(TOKENIZER_TEST, NextLine) {
+  std::string str = "1 2\n\r\n3 4\r\n5";
+  const char* ptr = str.data();
+  const char* end = ptr + str.size();
+  std::vector<std::string> lines;
+  while (ptr < end) {
+    const char* line = ptr;
+    const char* line_end = NextLine(ptr, end);
+    lines.push_back(std::string(line, line_end));
+  }
+  ASSERT_EQ(lines.size(), 4);
+  EXPECT_EQ(lines[0], "1 2");
+  EXPECT_EQ(lines[1], "");
+  EXPECT_EQ(lines[2], "3 4");
+  EXPECT_EQ(lines[3], "5");
+}
+
+TEST(TOKENIZER_TEST, SkipBlank_and_SkipToken) {
+  std::string str = " ,\t12:0.5, 3";
+  const char* ptr = str.data();
+  const char* end = ptr + str.size();
+  SkipBlank(ptr, end, ',');
+  EXPECT_EQ(*ptr, '1');
+  SkipToken(ptr, end, ',');
+  EXPECT_EQ(*ptr, ',');
+  SkipBlank(ptr, end, ',');
+  EXPECT_EQ(*ptr, '3');
+  SkipToken(ptr, end, ',');
+  EXPECT_EQ(ptr, end);
+}
+
+TEST(TOKENIZER_TEST, ParseIndex) {
+  const char* strs[] = { "0", "12:", "4294967295 ", "-1", "+7", "abc" };
+  for (int i = 0; i < 6; ++i) {
+    const char* ptr = strs[i];
+    const char* end = ptr + strlen(ptr);
+    index_t value = ParseIndex(ptr, end);
+    EXPECT_EQ(value, (index_t)atoi(strs[i]));
+    const char* ptr_std = strs[i];
+    strtol(ptr_std, (char**)&ptr_std, 10);
+    if (i < 5) {
+      EXPECT_EQ(ptr, ptr_std);
+    }
+  }
+}
+
+// Check that ParseReal() gets the same result as atof()
+void check_real(const std::string& str) {
+  const char* ptr = str.data();
+  const char* end = ptr + str.size();
+  real_t value = ParseReal(ptr, end);
+  real_t expected = static_cast<real_t>(atof(str.c_str()));
+  if (std::isnan(expected)) {
+    EXPECT_TRUE(std::isnan(value)) << str;
+  } else {
+    EXPECT_EQ(value, expected) << str;
+  }
+  char* ptr_std = nullptr;
+  strtod(str.c_str(), &ptr_std);
+  EXPECT_EQ(ptr - str.data(), ptr_std - str.c_str()) << str;
+}
+
+TEST(TOKENIZER_TEST, ParseReal) {
+  const char* strs[] = {
+    "0", "1", "-1", "+1", "0.12", ".5", "5.", "-0", "0.0",
+    "1e5", "1E-5", "2.5e+3", "1e", "1e+", "3.4028235e38",
+    "1e400", "-1e400", "1e-400", "4.9e-324", "0.000000000000000000000000001",
+    "12345678901234567890123", "9007199254740993", "0.1234567890123456789",
+    "inf", "-inf", "nan", "0x10", "", "-", ".", "abc",
+    "1:2", "0.5,0.6", "7 8", "1.5\r\n"
+  };
+  for (size_t i = 0; i < sizeof(strs) / sizeof(strs[0]); ++i) {
+    check_real(strs[i]);
+  }
+  // Random numbers
+  std::mt19937 gen(2018);
+  std::uniform_int_distribution<int> digit(0, 9);
+  std::uniform_int_distribution<int> length(1, 22);
+  std::uniform_int_distribution<int> exponent(-30, 30);
+  char buf[128];
+  for (int i = 0; i < 200000; ++i) {
+    std::string str;
+    if (gen() % 2) { str += '-'; }
+    int int_len = length(gen) % 8;
+    for (int j = 0; j < int_len; ++j) {
+      str += static_cast<char>('0' + digit(gen));
+    }
+    str += '.';
+    int frac_len = length(gen);
+    for (int j = 0; j < frac_len; ++j) {
+      str += static_cast<char>('0' + digit(gen));
+    }
+    if (gen() % 4 == 0) {
+      snprintf(buf, sizeof(buf), "e%d", exponent(gen));
+      str += buf;
+    }
+    check_real(str);
+  }
+  // Numbers printed by printf
+  std::uniform_real_distribution<double> real(-1000.0, 1000.0);
+  for (int i = 0; i < 200000; ++i) {
+    snprintf(buf, sizeof(buf), "%.*g", (int)(i % 17) + 1, real(gen));
+    check_real(buf);
+  }
+}
+
+}  // namespace xLearn
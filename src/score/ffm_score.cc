@@ -44,7 +44,7 @@ real_t FFMScore::CalcScore(const SparseRow* row,
     index_t feat_id = iter->feat_id;
     // To avoid unseen feature
     if (feat_id >= num_feat) continue;
-    sum_w += (iter->feat_val * w[feat_id*aux_size] * sqrt_norm);
+    sum_w += (iter->feat_val * w[(param_index_t)feat_id*aux_size] * sqrt_norm);
   }
   // bias
   w = model.GetParameter_b();
@@ -52,8 +52,8 @@ real_t FFMScore::CalcScore(const SparseRow* row,
   /*********************************************************
    *  latent factor                                        *
    *********************************************************/
-  index_t align0 = aux_size * model.get_aligned_k();
-  index_t align1 = num_field * align0;
+  param_index_t align0 = aux_size * model.get_aligned_k();
+  param_index_t align1 = num_field * align0;
   int align = kAlign * aux_size;
   w = model.GetParameter_v();
   __m128 XMMt = _mm_setzero_ps();
@@ -144,8 +144,8 @@ void FFMScore::calc_grad_sgd(const SparseRow* row,
   /*********************************************************
    *  latent factor                                        *
    *********************************************************/
-  index_t align0 = model.GetAuxiliarySize() * model.get_aligned_k();
-  index_t align1 = model.GetNumField() * align0;
+  param_index_t align0 = model.GetAuxiliarySize() * model.get_aligned_k();
+  param_index_t align1 = model.GetNumField() * align0;
   index_t align = kAlign * model.GetAuxiliarySize();
   w = model.GetParameter_v();
   __m128 XMMpg = _mm_set1_ps(pg);
@@ -208,8 +208,8 @@ void FFMScore::calc_grad_adagrad(const SparseRow* row,
     index_t feat_id = iter->feat_id;
     // To avoid unseen feature
     if (feat_id >= num_feat) continue;
-    real_t &wl = w[feat_id*2];
-    real_t &wlg = w[feat_id*2+1];
+    real_t &wl = w[(param_index_t)feat_id*2];
+    real_t &wlg = w[(param_index_t)feat_id*2+1];
     real_t g = regu_lambda_*wl+pg*iter->feat_val*sqrt_norm;
     wlg += g*g;
     wl -= learning_rate_ * g * InvSqrt(wlg);
@@ -224,8 +224,8 @@ void FFMScore::calc_grad_adagrad(const SparseRow* row,
   /*********************************************************
    *  latent factor                                        *
    *********************************************************/
-  index_t align0 = 2 * model.get_aligned_k();
-  index_t align1 = model.GetNumField() * align0;
+  param_index_t align0 = 2 * model.get_aligned_k();
+  param_index_t align1 = model.GetNumField() * align0;
   index_t align = kAlign * 2;
   w = model.GetParameter_v();
   __m128 XMMpg = _mm_set1_ps(pg);
@@ -296,9 +296,9 @@ void FFMScore::calc_grad_ftrl(const SparseRow* row,
     index_t feat_id = iter->feat_id;
     // To avoid unseen feature
     if (feat_id >= num_feat) continue;
-    real_t &wl = w[feat_id*3];
-    real_t &wlg = w[feat_id*3+1];
-    real_t &wlz = w[feat_id*3+2];
+    real_t &wl = w[(param_index_t)feat_id*3];
+    real_t &wlg = w[(param_index_t)feat_id*3+1];
+    real_t &wlz = w[(param_index_t)feat_id*3+2];
     real_t g = lambda_2_*wl+pg*iter->feat_val*sqrt_norm; 
     real_t old_wlg = wlg;
     wlg += g*g;
@@ -334,8 +334,8 @@ void FFMScore::calc_grad_ftrl(const SparseRow* row,
   /*********************************************************
    *  latent factor                                        *
    *********************************************************/
-  index_t align0 = 3 * model.get_aligned_k();
-  index_t align1 = model.GetNumField() * align0;
+  param_index_t align0 = 3 * model.get_aligned_k();
+  param_index_t align1 = model.GetNumField() * align0;
   index_t align = kAlign * 3;
   w = model.GetParameter_v();
   __m128 XMMpg = _mm_set1_ps(pg);
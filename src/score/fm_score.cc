@@ -43,7 +43,7 @@ real_t FMScore::CalcScore(const SparseRow* row,
     index_t feat_id = iter->feat_id;
     // To avoid unseen feature in Prediction
     if (feat_id >= num_feat) continue;
-    t += (iter->feat_val * w[feat_id*aux_size] * sqrt_norm);
+    t += (iter->feat_val * w[(param_index_t)feat_id*aux_size] * sqrt_norm);
   }
   // bias
   w = model.GetParameter_b();
@@ -52,7 +52,7 @@ real_t FMScore::CalcScore(const SparseRow* row,
    *  latent factor                                        *
    *********************************************************/
   index_t aligned_k = model.get_aligned_k();
-  index_t align0 = model.get_aligned_k() * aux_size;
+  param_index_t align0 = model.get_aligned_k() * aux_size;
   std::vector<real_t> sv(aligned_k, 0);
   real_t* s = sv.data();
   for (SparseRow::const_iterator iter = row->begin();
@@ -148,7 +148,7 @@ void FMScore::calc_grad_sgd(const SparseRow* row,
    *  latent factor                                        *
    *********************************************************/
   index_t aligned_k = model.get_aligned_k();
-  index_t align0 = model.get_aligned_k() * 
+  param_index_t align0 = model.get_aligned_k() * 
                    model.GetAuxiliarySize();
   __m128 XMMpg = _mm_set1_ps(pg);
   __m128 XMMlr = _mm_set1_ps(learning_rate_);
@@ -207,8 +207,8 @@ void FMScore::calc_grad_adagrad(const SparseRow* row,
     index_t feat_id = iter->feat_id;
     // To avoid unseen feature
     if (feat_id >= num_feat) continue;
-    real_t &wl = w[feat_id*2];
-    real_t &wlg = w[feat_id*2+1];
+    real_t &wl = w[(param_index_t)feat_id*2];
+    real_t &wlg = w[(param_index_t)feat_id*2+1];
     real_t g = regu_lambda_*wl+pg*iter->feat_val*sqrt_norm;
     wlg += g*g;
     wl -= learning_rate_ * g * InvSqrt(wlg);
@@ -224,7 +224,7 @@ void FMScore::calc_grad_adagrad(const SparseRow* row,
    *  latent factor                                        *
    *********************************************************/
   index_t aligned_k = model.get_aligned_k();
-  index_t align0 = model.get_aligned_k() * 
+  param_index_t align0 = model.get_aligned_k() * 
                    model.GetAuxiliarySize();
   __m128 XMMpg = _mm_set1_ps(pg);
   __m128 XMMlr = _mm_set1_ps(learning_rate_);
@@ -288,9 +288,9 @@ void FMScore::calc_grad_ftrl(const SparseRow* row,
     index_t feat_id = iter->feat_id;
     // To avoid unseen feature
     if (feat_id >= num_feat) continue;
-    real_t &wl = w[feat_id*3];
-    real_t &wlg = w[feat_id*3+1];
-    real_t &wlz = w[feat_id*3+2];
+    real_t &wl = w[(param_index_t)feat_id*3];
+    real_t &wlg = w[(param_index_t)feat_id*3+1];
+    real_t &wlz = w[(param_index_t)feat_id*3+2];
     real_t g = lambda_2_*wl+pg*iter->feat_val*sqrt_norm; 
     real_t old_wlg = wlg;
     wlg += g*g;
@@ -327,7 +327,7 @@ void FMScore::calc_grad_ftrl(const SparseRow* row,
    *  latent factor                                        *
    *********************************************************/
   index_t aligned_k = model.get_aligned_k();
-  index_t align0 = model.get_aligned_k() * 
+  param_index_t align0 = model.get_aligned_k() * 
                    model.GetAuxiliarySize();
   __m128 XMMpg = _mm_set1_ps(pg);
   __m128 XMMalpha = _mm_set1_ps(alpha_);
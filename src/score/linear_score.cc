@@ -37,7 +37,7 @@ real_t LinearScore::CalcScore(const SparseRow* row,
     index_t feat_id = iter->feat_id;
     // To avoid unseen feature in Prediction
     if (feat_id >= num_feat) continue;
-    index_t idx = feat_id * auxiliary_size;
+    param_index_t idx = (param_index_t)feat_id * auxiliary_size;
     score += w[idx] * iter->feat_val;
   }
   // bias
@@ -105,8 +105,8 @@ void LinearScore::calc_grad_adagrad(const SparseRow* row,
     // To avoid unseen feature
     if (feat_id >= num_feat) continue;
     real_t gradient = pg * iter->feat_val;
-    index_t idx_g = feat_id * 2;
-    index_t idx_c = idx_g + 1;
+    param_index_t idx_g = (param_index_t)feat_id * 2;
+    param_index_t idx_c = idx_g + 1;
     gradient += regu_lambda_ * w[idx_g];
     w[idx_c] += (gradient * gradient);
     w[idx_g] -= (learning_rate_ * gradient *
@@ -135,9 +135,9 @@ void LinearScore::calc_grad_ftrl(const SparseRow* row,
     index_t feat_id = iter->feat_id;
     // To avoid unseen feature
     if (feat_id >= num_feat) continue;
-    real_t &wl = w[feat_id*3];
-    real_t &wlg = w[feat_id*3+1];
-    real_t &wlz = w[feat_id*3+2];
+    real_t &wl = w[(param_index_t)feat_id*3];
+    real_t &wlg = w[(param_index_t)feat_id*3+1];
+    real_t &wlz = w[(param_index_t)feat_id*3+2];
     real_t g = lambda_2_*wl+pg*iter->feat_val*sqrt_norm; 
     real_t old_wlg = wlg;
     wlg += g*g;
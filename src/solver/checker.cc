@@ -28,6 +28,8 @@ This file is the implementation of the Checker class.
 #include "src/solver/checker.h"
 #include "src/base/levenshtein_distance.h"
 #include "src/base/file_util.h"
+#include "src/base/file_list.h"
+#include "src/base/huge_page.h"
 
 namespace xLearn {
 
@@ -40,6 +42,10 @@ USAGE:
      xlearn_train <train_file_path> [OPTIONS] 
                                                     
  e.g.,  xlearn_train train_data.txt -s 0 -v validate_data.txt -r 0.1
+
+ The <train_file_path> (and the validation file) can also be a directory, a glob 
+ pattern (e.g., "./data/part-*"), or a manifest file that lists a file on each 
+ line (e.g., @./train_list.txt).
                                                                     
 OPTIONS: 
   -s <type> : Type of machine learning model (default 0) 
@@ -105,11 +111,47 @@ OPTIONS:
                                                                                        
   -block <block_size>  :  Block size fot on-disk training.     
 
+  -prefetch <depth>    :  Number of blocks that are read and parsed in background for on-disk training. 
+                          Using 1 by default, and 0 means reading data synchronously. 
+
+  -mem_budget <MB>     :  Memory budget for on-disk training. The parsed blocks that fit in the budget 
+                          are kept in memory, and the other blocks are read from the binary cache in 
+                          each epoch. Using 0 by default, which reads all the blocks from disk.
+
   -sw <stop_window>    :  Size of stop window for early-stopping. Using 2 by default.                       
                                                                                       
   -seed <random_seed>  :  Random Seed to shuffle data set.
 
+  -shuffle_chunk <size> :  Shuffle data in chunks of <size> contiguous rows for in-memory training. This 
+                          makes each epoch faster, but could slow down the convergence. Using 0 (global 
+                          shuffle) by default.
+
+  -shuffle_window <size> :  Size of the shuffle buffer (number of rows) across blocks for on-disk training. 
+                           This option implies the --disk-shuffle option. Using 0 by default.
+
   --disk               :  Open on-disk training for large-scale machine learning problems. 
+
+  --disk-shuffle       :  Visit the blocks of on-disk training in a random order in each epoch. 
+
+  -reader_threads <number> :  Number of files that are read at the same time if the input is a list of 
+                          files. Using 1 by default.
+
+  --shuffle-files      :  Visit the files in a random order in each epoch if the input is a list of files. 
+                          The files are visited in the order of their names by default.
+
+  -format <format>     :  Declare the format of the data: 'libsvm', 'libffm', or 'csv'. On default, the 
+                          format is detected from the first line. It must be set if the training file 
+                          is '-' (stdin) or a pipe, which is copied to '<name>.<pid>.spill' in the 
+                          directory of the model file for the later epochs.
+
+  -field_map <file>    :  File of the field id of each column of csv data, separated by blanks, commas 
+                          or lines, so that the csv data can be used by ffm. All the columns are in 
+                          field 0 by default.
+
+  -huge_page <type>    :  Allocate the model parameters on huge pages, which speeds up the random access 
+                          to a large model: 'none', 'thp' (transparent huge pages), '2m', or '1g'. The 
+                          '2m' and '1g' pages must be reserved in advance (vm.nr_hugepages), or xLearn 
+                          falls back to the smaller pages. Using 'none' by default.
                                                                     
   --cv                 :  Open cross-validation in training tasks. If we use this option, xLearn 
                           will ignore the validation file (-t).  
@@ -124,7 +166,28 @@ OPTIONS:
   --no-norm            :  Disable instance-wise normalization. By default, xLearn will use 
                           instance-wise normalization for both training and prediction. 
 
-  --no-bin             :  Do not generate bin file for training and test data file.
+  --no-bin             :  Do not generate bin file (or the binary cache of on-disk training) 
+                          for training and test data file.
+
+  --verify-bin         :  Hash the whole text file to verify the bin file. On default, xLearn only checks 
+                          the size, the modification time, and a few sampled chunks of the text file.
+
+  --bin-compress       :  Store the bin file in compressed format, which is several times smaller, and 
+                          it is decoded in parallel when it is loaded.
+
+  --compress           :  Store the training data in compressed format for in-memory training. This 
+                          can reduce the memory usage, and the bin file is also compressed. 
+
+  --quantize           :  Store the feature value in bfloat16 format (lossy). This option implies 
+                          the --compress option. 
+
+  --remap              :  Map the feature ids that are used in the training data to a dense range, 
+                          so the model has no parameter for the unused ids (e.g., hashed ids). The 
+                          map is saved in the model, and the features that are not in the training 
+                          data are dropped in prediction. It costs an extra pass of the data.
+
+  --numa               :  Interleave the model parameters across the NUMA nodes, and pin the worker threads 
+                          to the nodes. The detected topology is printed at startup.
                                                                   
   --quiet              :  Don't print any evaluation information during the training and 
                           just train the model quietly. 
@@ -147,6 +210,23 @@ OPTIONS:
   -l <log_file_path>       :  Path of the log file. Using '/tmp/xlearn_log' by default. 
 
   -block <block_size>      :  Block size fot on-disk prediction. 
+
+  -prefetch <depth>        :  Number of blocks that are read and parsed in background for on-disk 
+                              prediction. Using 1 by default, and 0 means reading data synchronously. 
+
+  -reader_threads <number> :  Number of files that are read at the same time if the test file is 
+                              a directory, a glob pattern, or a manifest (@file). Using 1 by default.
+
+  -format <format>         :  Declare the format of the data: 'libsvm', 'libffm', or 'csv'. It must be 
+                              set if the test file is '-' (stdin) or a pipe, which is read in a single 
+                              pass. Use '-o -' to write the output to stdout, e.g., 
+                              cat test.txt | xlearn_predict - model -format libsvm -o - 
+
+  -field_map <file>        :  File of the field id of each column of csv data. It must be the same as
+                              the one used in training.
+
+  -huge_page <type>        :  Allocate the model parameters on huge pages: 'none', 'thp', '2m', or '1g'. 
+                              Using 'none' by default.
                                                             
   --sign                   :  Converting output to 0 and 1. 
                                                                
@@ -156,6 +236,14 @@ OPTIONS:
   
   --no-norm                :  Disable instance-wise normalization. By default, xLearn will use 
                               instance-wise normalization for both training and prediction. 
+
+  --verify-bin             :  Hash the whole text file to verify the bin file. On default, xLearn only 
+                              checks the size, the modification time, and a few sampled chunks of the file.
+
+  --bin-compress           :  Store the bin file in compressed format, which is several times smaller.
+
+  --numa                   :  Interleave the model parameters across the NUMA nodes, and pin the worker 
+                              threads to the nodes.
 ----------------------------------------------------------------------------------------------)"
     );
   }
@@ -181,13 +269,29 @@ void Checker::Initialize(bool is_train, int argc, char* argv[]) {
     menu_.push_back(std::string("-pre"));
     menu_.push_back(std::string("-nthread"));
     menu_.push_back(std::string("-block"));
+    menu_.push_back(std::string("-prefetch"));
+    menu_.push_back(std::string("-mem_budget"));
     menu_.push_back(std::string("-sw"));
     menu_.push_back(std::string("-seed"));
+    menu_.push_back(std::string("-shuffle_chunk"));
+    menu_.push_back(std::string("-shuffle_window"));
     menu_.push_back(std::string("--disk"));
+    menu_.push_back(std::string("--disk-shuffle"));
+    menu_.push_back(std::string("-reader_threads"));
+    menu_.push_back(std::string("--shuffle-files"));
+    menu_.push_back(std::string("-format"));
+    menu_.push_back(std::string("-field_map"));
+    menu_.push_back(std::string("-huge_page"));
     menu_.push_back(std::string("--cv"));
     menu_.push_back(std::string("--dis-es"));
     menu_.push_back(std::string("--no-norm"));
     menu_.push_back(std::string("--no-bin"));
+    menu_.push_back(std::string("--verify-bin"));
+    menu_.push_back(std::string("--bin-compress"));
+    menu_.push_back(std::string("--compress"));
+    menu_.push_back(std::string("--quantize"));
+    menu_.push_back(std::string("--remap"));
+    menu_.push_back(std::string("--numa"));
     menu_.push_back(std::string("--quiet"));
     menu_.push_back(std::string("-alpha"));
     menu_.push_back(std::string("-beta"));
@@ -198,10 +302,18 @@ void Checker::Initialize(bool is_train, int argc, char* argv[]) {
     menu_.push_back(std::string("-l"));
     menu_.push_back(std::string("-nthread"));
     menu_.push_back(std::string("-block"));
+    menu_.push_back(std::string("-prefetch"));
+    menu_.push_back(std::string("-reader_threads"));
+    menu_.push_back(std::string("-format"));
+    menu_.push_back(std::string("-field_map"));
+    menu_.push_back(std::string("-huge_page"));
     menu_.push_back(std::string("--sign"));
     menu_.push_back(std::string("--sigmoid"));
     menu_.push_back(std::string("--disk"));
     menu_.push_back(std::string("--no-norm"));
+    menu_.push_back(std::string("--verify-bin"));
+    menu_.push_back(std::string("--bin-compress"));
+    menu_.push_back(std::string("--numa"));
   }
   // Get the user's input
   for (int i = 0; i < argc; ++i) {
@@ -209,6 +321,49 @@ void Checker::Initialize(bool is_train, int argc, char* argv[]) {
   }
 }
 
+// Whether the format name is empty (detected from the
+// first line of data), "libsvm", "libffm", or "csv".
+static bool check_format_name(const std::string& format) {
+  return format.empty() || format == "libsvm" ||
+         format == "libffm" || format == "csv";
+}
+
+// The field map must be an existing file if it is given.
+static bool check_field_map(const std::string& filename) {
+  if (filename.empty() || FileExist(filename.c_str())) { return true; }
+  Color::print_error(
+    StringPrintf("Field map file: %s does not exist.", filename.c_str())
+  );
+  return false;
+}
+
+// The type of the pages for the model must be
+// "none", "thp", "2m", or "1g".
+static bool check_page_name(const std::string& name) {
+  PageType type;
+  if (ParsePageType(name, &type)) { return true; }
+  Color::print_error(
+    StringPrintf("Illegal -huge_page : '%s'. -huge_page can only be "
+                 "'none', 'thp', '2m', or '1g'.", name.c_str())
+  );
+  return false;
+}
+
+// The format of a stream (stdin or a pipe) cannot be detected
+// before we read it, so it must be declared by user.
+static bool check_stream_format(const std::string& filename,
+                                const std::string& format) {
+  if (filename.empty() || !IsStream(filename) || !format.empty()) {
+    return true;
+  }
+  Color::print_error(
+    StringPrintf("The format of %s must be declared, "
+                 "e.g., -format libsvm.",
+                 FileListName(filename).c_str())
+  );
+  return false;
+}
+
 // Check and parse user's input
 bool Checker::check_cmd(HyperParam& hyper_param) {
   // Do not have any args
@@ -239,7 +394,7 @@ bool Checker::check_train_options(HyperParam& hyper_param) {
   /*********************************************************
    *  Check the file path of the training data             *
    *********************************************************/
-  if (FileExist(args_[1].c_str())) {
+  if (InputExist(args_[1])) {
     hyper_param.train_set_file = std::string(args_[1]);
   } else {
     Color::print_error(
@@ -344,7 +499,7 @@ bool Checker::check_train_options(HyperParam& hyper_param) {
       }
       i += 2;
     } else if (list[i].compare("-v") == 0) {  // validation file
-      if (FileExist(list[i+1].c_str())) {
+      if (InputExist(list[i+1])) {
         hyper_param.validate_set_file = list[i+1];
       } else {
         Color::print_error(
@@ -463,6 +618,30 @@ bool Checker::check_train_options(HyperParam& hyper_param) {
         hyper_param.block_size = value;
       }
       i += 2;
+    } else if (list[i].compare("-prefetch") == 0) {  // prefetch depth for on-disk reader
+      int value = atoi(list[i+1].c_str());
+      if (value < 0) {
+        Color::print_error(
+          StringPrintf("Illegal -prefetch : '%i'. -prefetch must be greater than or equal to 0.",
+               value)
+        );
+        bo = false;
+      } else {
+        hyper_param.prefetch = value;
+      }
+      i += 2;
+    } else if (list[i].compare("-mem_budget") == 0) {  // memory budget for on-disk reader
+      int value = atoi(list[i+1].c_str());
+      if (value < 0) {
+        Color::print_error(
+          StringPrintf("Illegal -mem_budget : '%i'. -mem_budget must be greater than or equal to 0.",
+               value)
+        );
+        bo = false;
+      } else {
+        hyper_param.mem_budget = value;
+      }
+      i += 2;
     } else if (list[i].compare("-sw") == 0) {  // window size for early stopping
       int value = atoi(list[i+1].c_str());
       if (value < 1) {
@@ -487,9 +666,73 @@ bool Checker::check_train_options(HyperParam& hyper_param) {
         hyper_param.seed = value;
       }
       i += 2;
+    } else if (list[i].compare("-shuffle_chunk") == 0) {  // chunked shuffle
+      int value = atoi(list[i+1].c_str());
+      if (value < 0) {
+        Color::print_error(
+          StringPrintf("Illegal -shuffle_chunk : '%i'. -shuffle_chunk must be greater than or equal to 0.",
+               value)
+        );
+        bo = false;
+      } else {
+        hyper_param.shuffle_chunk = value;
+      }
+      i += 2;
+    } else if (list[i].compare("-shuffle_window") == 0) {  // shuffle buffer
+      int value = atoi(list[i+1].c_str());
+      if (value < 0) {
+        Color::print_error(
+          StringPrintf("Illegal -shuffle_window : '%i'. -shuffle_window must be greater than or equal to 0.",
+               value)
+        );
+        bo = false;
+      } else {
+        hyper_param.shuffle_window = value;
+        hyper_param.disk_shuffle = true;
+      }
+      i += 2;
     } else if (list[i].compare("--disk") == 0) {  // on-disk training
       hyper_param.on_disk = true;
       i += 1;
+    } else if (list[i].compare("--disk-shuffle") == 0) {  // on-disk shuffle
+      hyper_param.disk_shuffle = true;
+      i += 1;
+    } else if (list[i].compare("-reader_threads") == 0) {  // files read at the same time
+      int value = atoi(list[i+1].c_str());
+      if (value <= 0) {
+        Color::print_error(
+          StringPrintf("Illegal -reader_threads : '%i'. -reader_threads must be greater than zero.",
+               value)
+        );
+        bo = false;
+      } else {
+        hyper_param.reader_threads = value;
+      }
+      i += 2;
+    } else if (list[i].compare("--shuffle-files") == 0) {  // shuffle the files
+      hyper_param.shuffle_files = true;
+      i += 1;
+    } else if (list[i].compare("-format") == 0) {  // declared data format
+      if (!check_format_name(list[i+1])) {
+        Color::print_error(
+          StringPrintf("Illegal -format : '%s'. -format can only be 'libsvm', 'libffm', or 'csv'.",
+               list[i+1].c_str())
+        );
+        bo = false;
+      } else {
+        hyper_param.data_format = list[i+1];
+      }
+      i += 2;
+    } else if (list[i].compare("-field_map") == 0) {  // field of csv columns
+      hyper_param.field_map_file = list[i+1];
+      i += 2;
+    } else if (list[i].compare("-huge_page") == 0) {  // pages of the model
+      if (!check_page_name(list[i+1])) {
+        bo = false;
+      } else {
+        hyper_param.huge_page = list[i+1];
+      }
+      i += 2;
     } else if (list[i].compare("--cv") == 0) {  // cross-validation
       hyper_param.cross_validation = true;
       i += 1;
@@ -505,6 +748,25 @@ bool Checker::check_train_options(HyperParam& hyper_param) {
     } else if (list[i].compare("--no-bin") == 0) {  // do not generate bin file
       hyper_param.bin_out = false;
       i += 1;
+    } else if (list[i].compare("--verify-bin") == 0) {  // hash the whole text file
+      hyper_param.verify_bin = true;
+      i += 1;
+    } else if (list[i].compare("--bin-compress") == 0) {  // compressed bin file
+      hyper_param.bin_compress = true;
+      i += 1;
+    } else if (list[i].compare("--compress") == 0) {  // compressed data
+      hyper_param.compress = true;
+      i += 1;
+    } else if (list[i].compare("--quantize") == 0) {  // quantize value
+      hyper_param.compress = true;
+      hyper_param.quantize = true;
+      i += 1;
+    } else if (list[i].compare("--remap") == 0) {  // dense feature ids
+      hyper_param.remap_feature = true;
+      i += 1;
+    } else if (list[i].compare("--numa") == 0) {  // NUMA placement
+      hyper_param.numa = true;
+      i += 1;
     } else if (list[i].compare("--quiet") == 0) {  // quiet
       hyper_param.quiet = true;
       i += 1;
@@ -572,6 +834,13 @@ bool Checker::check_train_options(HyperParam& hyper_param) {
       break;
     }
   }
+  if (!check_stream_format(hyper_param.train_set_file,
+                           hyper_param.data_format) ||
+      !check_stream_format(hyper_param.validate_set_file,
+                           hyper_param.data_format) ||
+      !check_field_map(hyper_param.field_map_file)) {
+    bo = false;
+  }
   if (!bo) { return false; }
   /*********************************************************
    *  Check warning and fix conflict                       *
@@ -581,7 +850,7 @@ bool Checker::check_train_options(HyperParam& hyper_param) {
    *  Set default value                                    *
    *********************************************************/
   if (hyper_param.model_file.empty() && !hyper_param.cross_validation) {
-    hyper_param.model_file = hyper_param.train_set_file + ".model";
+    hyper_param.model_file = FileListName(hyper_param.train_set_file) + ".model";
   }
   if (hyper_param.metric.compare("rmse") == 0) {
     hyper_param.metric = "rmsd";
@@ -597,7 +866,7 @@ bool Checker::check_train_param(HyperParam& hyper_param) {
    *  Check file path                                      *
    *********************************************************/
   if (hyper_param.from_file) {
-    if (!FileExist(hyper_param.train_set_file.c_str())) {
+    if (!InputExist(hyper_param.train_set_file)) {
       Color::print_error(
         StringPrintf("Training data file: %s does not exist.", 
                       hyper_param.train_set_file.c_str())
@@ -605,7 +874,7 @@ bool Checker::check_train_param(HyperParam& hyper_param) {
       bo = false;
     }
     if (!hyper_param.validate_set_file.empty() &&
-        !FileExist(hyper_param.validate_set_file.c_str())) {
+        !InputExist(hyper_param.validate_set_file)) {
       Color::print_error(
         StringPrintf("Validation data file: %s does not exist.", 
                       hyper_param.validate_set_file.c_str())
@@ -685,6 +954,25 @@ bool Checker::check_train_param(HyperParam& hyper_param) {
     );
     bo = false;
   }
+  if (!check_format_name(hyper_param.data_format)) {
+    Color::print_error(
+      StringPrintf("Unknow data format: %s.",
+        hyper_param.data_format.c_str())
+    );
+    bo = false;
+  }
+  if (!check_page_name(hyper_param.huge_page)) {
+    bo = false;
+  }
+  if (hyper_param.from_file) {
+    if (!check_stream_format(hyper_param.train_set_file,
+                             hyper_param.data_format) ||
+        !check_stream_format(hyper_param.validate_set_file,
+                             hyper_param.data_format) ||
+        !check_field_map(hyper_param.field_map_file)) {
+      bo = false;
+    }
+  }
   if (!bo) return false;
   /*********************************************************
    *  Check warning and fix conflict                       *
@@ -694,7 +982,7 @@ bool Checker::check_train_param(HyperParam& hyper_param) {
    *  Set default value                                    *
    *********************************************************/
   if (hyper_param.model_file.empty() && !hyper_param.cross_validation) {
-    hyper_param.model_file = hyper_param.train_set_file + ".model";
+    hyper_param.model_file = FileListName(hyper_param.train_set_file) + ".model";
   }
   if (hyper_param.metric.compare("rmse") == 0) {
     hyper_param.metric = "rmsd";
@@ -710,11 +998,34 @@ void Checker::check_conflict_train(HyperParam& hyper_param) {
                          "xLearn has already disable the -cv option.");
     hyper_param.cross_validation = false;
   }
+  if (hyper_param.from_file && hyper_param.cross_validation &&
+      IsFileList(hyper_param.train_set_file)) {
+    Color::print_warning("Cross-validation doesn't support a list of training files. "
+                         "xLearn has already disable the -cv option.");
+    hyper_param.cross_validation = false;
+  }
   if (hyper_param.on_disk && hyper_param.cross_validation) {
     Color::print_warning("On-disk training doesn't support cross-validation. "
                          "xLearn has already disable the -cv option.");
     hyper_param.cross_validation = false;
   }
+  if (hyper_param.on_disk && hyper_param.compress) {
+    Color::print_warning("On-disk training doesn't support compressed data. "
+                         "xLearn has already disable the --compress option.");
+    hyper_param.compress = false;
+    hyper_param.quantize = false;
+  }
+  if (!hyper_param.on_disk && hyper_param.mem_budget > 0) {
+    Color::print_warning("In-memory training keeps all the data in memory. "
+                         "xLearn has already disable the -mem_budget option.");
+    hyper_param.mem_budget = 0;
+  }
+  if (!hyper_param.on_disk && hyper_param.disk_shuffle) {
+    Color::print_warning("In-memory training always shuffles the data. "
+                         "xLearn has already disable the --disk-shuffle option.");
+    hyper_param.disk_shuffle = false;
+    hyper_param.shuffle_window = 0;
+  }
   if (hyper_param.cross_validation && hyper_param.early_stop) {
     Color::print_warning("Cross-validation doesn't support early-stopping. "
                          "xLearn has already close early-stopping.");
@@ -797,7 +1108,7 @@ bool Checker::check_prediction_options(HyperParam& hyper_param) {
   /*********************************************************
    *  Check the path of test set file                      *
    *********************************************************/
-  if (FileExist(args_[1].c_str())) {
+  if (InputExist(args_[1])) {
     hyper_param.test_set_file = std::string(args_[1]);
   } else {
     Color::print_error(
@@ -854,6 +1165,51 @@ bool Checker::check_prediction_options(HyperParam& hyper_param) {
         hyper_param.block_size = value;
       }
       i += 2;
+    } else if (list[i].compare("-prefetch") == 0) {  // prefetch depth for on-disk reader
+      int value = atoi(list[i+1].c_str());
+      if (value < 0) {
+        Color::print_error(
+          StringPrintf("Illegal -prefetch : '%i'. -prefetch must be greater than or equal to 0.",
+               value)
+        );
+        bo = false;
+      } else {
+        hyper_param.prefetch = value;
+      }
+      i += 2;
+    } else if (list[i].compare("-reader_threads") == 0) {  // files read at the same time
+      int value = atoi(list[i+1].c_str());
+      if (value <= 0) {
+        Color::print_error(
+          StringPrintf("Illegal -reader_threads : '%i'. -reader_threads must be greater than zero.",
+               value)
+        );
+        bo = false;
+      } else {
+        hyper_param.reader_threads = value;
+      }
+      i += 2;
+    } else if (list[i].compare("-format") == 0) {  // declared data format
+      if (!check_format_name(list[i+1])) {
+        Color::print_error(
+          StringPrintf("Illegal -format : '%s'. -format can only be 'libsvm', 'libffm', or 'csv'.",
+               list[i+1].c_str())
+        );
+        bo = false;
+      } else {
+        hyper_param.data_format = list[i+1];
+      }
+      i += 2;
+    } else if (list[i].compare("-field_map") == 0) {  // field of csv columns
+      hyper_param.field_map_file = list[i+1];
+      i += 2;
+    } else if (list[i].compare("-huge_page") == 0) {  // pages of the model
+      if (!check_page_name(list[i+1])) {
+        bo = false;
+      } else {
+        hyper_param.huge_page = list[i+1];
+      }
+      i += 2;
     } else if (list[i].compare("--sign") == 0) {  // convert output to 0 and 1
       hyper_param.sign = true;
       i += 1;
@@ -866,6 +1222,15 @@ bool Checker::check_prediction_options(HyperParam& hyper_param) {
     } else if (list[i].compare("--no-norm") == 0) {  // normalization
       hyper_param.norm = false;
       i += 1;
+    } else if (list[i].compare("--verify-bin") == 0) {  // hash the whole text file
+      hyper_param.verify_bin = true;
+      i += 1;
+    } else if (list[i].compare("--bin-compress") == 0) {  // compressed bin file
+      hyper_param.bin_compress = true;
+      i += 1;
+    } else if (list[i].compare("--numa") == 0) {  // NUMA placement
+      hyper_param.numa = true;
+      i += 1;
     } else {  // no match
       std::string similar_str;
       ss.FindSimilar(list[i], menu_, similar_str);
@@ -878,6 +1243,11 @@ bool Checker::check_prediction_options(HyperParam& hyper_param) {
       break;
     }
   }
+  if (!check_stream_format(hyper_param.test_set_file,
+                           hyper_param.data_format) ||
+      !check_field_map(hyper_param.field_map_file)) {
+    bo = false;
+  }
   if (!bo) { return false; }
   /*********************************************************
    *  Check warning and fix conflict                       *
@@ -887,7 +1257,7 @@ bool Checker::check_prediction_options(HyperParam& hyper_param) {
    *  Set default value                                    *
    *********************************************************/
   if (hyper_param.output_file.empty()) {
-    hyper_param.output_file = hyper_param.test_set_file + ".out";
+    hyper_param.output_file = FileListName(hyper_param.test_set_file) + ".out";
   }
 
   return true;
@@ -900,7 +1270,7 @@ bool Checker::check_prediction_param(HyperParam& hyper_param) {
   *  Check the path of test set file                      *
   *********************************************************/
  if (hyper_param.from_file) {
-  if (!FileExist(hyper_param.test_set_file.c_str())) {
+  if (!InputExist(hyper_param.test_set_file)) {
       Color::print_error(
         StringPrintf("Test set file: %s does not exist.",
             hyper_param.test_set_file.c_str())
@@ -935,6 +1305,22 @@ bool Checker::check_prediction_param(HyperParam& hyper_param) {
     );
     bo = false;
   }
+ if (!check_format_name(hyper_param.data_format)) {
+    Color::print_error(
+      StringPrintf("Unknow data format: %s.",
+        hyper_param.data_format.c_str())
+    );
+    bo = false;
+ }
+ if (!check_page_name(hyper_param.huge_page)) {
+    bo = false;
+ }
+ if (hyper_param.from_file &&
+     (!check_stream_format(hyper_param.test_set_file,
+                           hyper_param.data_format) ||
+      !check_field_map(hyper_param.field_map_file))) {
+    bo = false;
+ }
  if (!bo) return false;
  /*********************************************************
   *  Check warning and fix conflict                       *
@@ -945,7 +1331,7 @@ bool Checker::check_prediction_param(HyperParam& hyper_param) {
   *********************************************************/
  if (hyper_param.res_out) {
   if (hyper_param.output_file.empty()) {
-    hyper_param.output_file = hyper_param.test_set_file + ".out";
+    hyper_param.output_file = FileListName(hyper_param.test_set_file) + ".out";
   }
  }
 
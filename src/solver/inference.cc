@@ -22,6 +22,7 @@ This file is the implementation of the Predictor class.
 #include "src/base/timer.h"
 #include "src/base/format_print.h"
 
+#include <stdio.h>
 #include <vector>
 #include <sstream>
 
@@ -30,7 +31,9 @@ namespace xLearn {
 // Given a pre-trained model and test data, the predictor
 // will return the prediction output
 void Predictor::Predict() {
-  if (res_out_)
+  // Write the output to stdout if the output file is "-"
+  bool to_stdout = res_out_ && out_file_ == "-";
+  if (res_out_ && !to_stdout)
     std::ofstream o_file(out_file_);
   static std::vector<real_t> out;
   DMatrix* matrix = nullptr;
@@ -49,6 +52,15 @@ void Predictor::Predict() {
     } else if (sign_) {
       this->sign(out, out);
     }
+    if (to_stdout) {
+      // The output of a pipeline is not kept in memory,
+      // and it is flushed for the next command.
+      for (index_t i = 0; i < out.size(); ++i) {
+        fprintf(stdout, "%g\n", out[i]);
+      }
+      fflush(stdout);
+      continue;
+    }
     this->out_.insert(this->out_.end(), out.begin(), out.end());
     if (res_out_) {
       std::ofstream o_file(out_file_, std::ofstream::app);
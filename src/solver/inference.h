@@ -33,7 +33,9 @@ namespace xLearn {
 
 //------------------------------------------------------------------------------
 // Given a pre-trained model and test data, the predictor
-// will return the prediction output
+// will return the prediction output. If the output file is
+// "-", the output of each block is written to stdout as soon
+// as it is ready, and it is not kept by GetResult().
 //------------------------------------------------------------------------------
 class Predictor {
  public:
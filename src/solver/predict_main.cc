@@ -18,6 +18,9 @@
 This file is the entry for prediction of the xLearn.
 */
 
+#include <string.h>
+#include <iostream>
+
 #include "src/base/common.h"
 #include "src/base/timer.h"
 #include "src/base/stringprintf.h"
@@ -31,6 +34,14 @@ int main(int argc, char* argv[]) {
   Timer timer;
   timer.tic();
 
+  // The output is written to stdout by '-o -', and then
+  // all the other messages are printed to stderr.
+  for (int i = 3; i + 1 < argc; ++i) {
+    if (strcmp(argv[i], "-o") == 0 && strcmp(argv[i+1], "-") == 0) {
+      std::cout.rdbuf(std::cerr.rdbuf());
+    }
+  }
+
   xLearn::Solver solver;
   solver.SetPredict();
   solver.Initialize(argc, argv);
@@ -30,6 +30,8 @@ This file is the implementation of the Solver class.
 #include "src/base/stringprintf.h"
 #include "src/base/split_string.h"
 #include "src/base/timer.h"
+#include "src/base/file_list.h"
+#include "src/base/file_util.h"
 #include "src/base/system.h"
 
 namespace xLearn {
@@ -68,9 +70,19 @@ void Solver::print_logo() const {
  ******************************************************************************/
 
 // Create Reader by a given string
-Reader* Solver::create_reader() {
+Reader* Solver::create_reader(const std::string& filename) {
   Reader* reader;
   std::string str = hyper_param_.from_file ? hyper_param_.on_disk ? "disk" : "memory" : "dmatrix";
+  if (hyper_param_.from_file && IsStream(filename)) {
+    str = "stream";
+  } else if (hyper_param_.from_file && IsFileList(filename)) {
+    MultiReader* multi = new MultiReader();
+    multi->SetReaderType(str);
+    multi->SetReaderThreads(hyper_param_.reader_threads);
+    multi->SetShuffleFiles(hyper_param_.is_train && 
+                           hyper_param_.shuffle_files);
+    return multi;
+  }
   reader = CREATE_READER(str.c_str());
   if (reader == nullptr) {
     LOG(FATAL) << "Cannot create reader: " << str;
@@ -184,6 +196,195 @@ void Solver::init_log() {
               StringPrintf("%s.ERROR", prefix.c_str()));
 }
 
+// Split the rows of the training file into folds for cross-
+// validation. Each fold is a Reader of a range of rows, and the
+// data is shared by all the folds rather than copied, so no fold
+// file is written or parsed.
+void Solver::split_folds() {
+  CHECK_EQ(reader_.size(), 1);
+  CHECK_GE(hyper_param_.num_folds, 2);
+  InmemReader* base = dynamic_cast<InmemReader*>(reader_[0]);
+  CHECK_NOTNULL(base);
+  cv_reader_ = base;
+  uint64 row_number = base->RowNumber();
+  int num_folds = hyper_param_.num_folds;
+  reader_.resize(num_folds, nullptr);
+  for (int i = 0; i < num_folds; ++i) {
+    InmemReader* fold = new InmemReader();
+    fold->SetSeed(hyper_param_.seed);
+    fold->SetShuffleChunk(hyper_param_.shuffle_chunk);
+    fold->InitializeView(base, row_number * i / num_folds,
+                         row_number * (i + 1) / num_folds);
+    fold->SetShuffle(true);
+    reader_[i] = fold;
+  }
+  LOG(INFO) << "Split " << row_number << " rows into "
+            << num_folds << " folds.";
+}
+
+// Map the feature ids that are used in the training data to a
+// dense range, so that the model has no parameter for the unused
+// ids, e.g., the data has hashed ids. The ids are collected in an
+// extra pass of the data, and the map is saved in the model. The
+// features that are only in the validation data are dropped.
+void Solver::build_feature_map(Reader* reader) {
+  CHECK_NOTNULL(reader);
+  DMatrix* matrix = nullptr;
+  while (reader->Samples(matrix) > 0) {
+    id_map_.Collect(*matrix);
+  }
+  reader->Reset();
+  id_map_.Build();
+}
+
+// Map the feature ids of all the Readers. The Reader of the
+// whole data goes first in cross-validation, since the folds
+// share its data.
+void Solver::set_feature_map() {
+  if (cv_reader_ != nullptr) {
+    cv_reader_->SetFeatureMap(&id_map_);
+  }
+  for (size_t i = 0; i < reader_.size(); ++i) {
+    reader_[i]->SetFeatureMap(&id_map_);
+  }
+}
+
+// Copy a stream to a spill file in the directory of the model
+// file, e.g., "stdin.<pid>.spill" for stdin, or "<name>.<pid>.spill"
+// for a named pipe. The process id keeps the jobs that are started
+// in the same directory apart. The spill file is removed in Clear().
+std::string Solver::spill_stream(const std::string& filename) {
+  std::string name = FileListName(filename);
+  size_t pos = name.find_last_of("/\\");
+  if (pos != std::string::npos) { name = name.substr(pos + 1); }
+  std::string dir;
+  pos = hyper_param_.model_file.find_last_of("/\\");
+  if (pos != std::string::npos) {
+    dir = hyper_param_.model_file.substr(0, pos + 1);
+  }
+  std::string spill_file = StringPrintf("%s%s.%u.spill", 
+                                        dir.c_str(), name.c_str(),
+                                        (uint32)getpid());
+  for (int i = 1; FileExist(spill_file.c_str()); ++i) {
+    spill_file = StringPrintf("%s%s.%u.%d.spill",
+                              dir.c_str(), name.c_str(),
+                              (uint32)getpid(), i);
+  }
+  FILE* file_r = stdin;
+  if (filename == "-") {
+#ifdef _MSC_VER
+    _setmode(_fileno(stdin), _O_BINARY);
+#endif
+  } else {
+    file_r = OpenFileOrDie(filename.c_str(), "rb");
+  }
+  FILE* file_w = OpenFileOrDie(spill_file.c_str(), "wb");
+  spill_files_.push_back(spill_file);
+  static const size_t kBufferSize = 4 * 1024 * 1024;
+  std::vector<char> buf(kBufferSize);
+  uint64 total = 0;
+  size_t size = 0;
+  while ((size = ReadDataFromDisk(file_r, buf.data(), kBufferSize)) > 0) {
+    WriteDataToDisk(file_w, buf.data(), size);
+    total += size;
+  }
+  Close(file_w);
+  if (file_r != stdin) { Close(file_r); }
+  Color::print_info(
+    StringPrintf("Copy %s (%s) to %s for the later epochs. It is "
+                 "removed at the end, or can be removed by hand if "
+                 "the training is interrupted.",
+                 FileListName(filename).c_str(),
+                 PrintSize(total).c_str(),
+                 spill_file.c_str())
+  );
+  if (total == 0) {
+    LOG(FATAL) << "The stream " << FileListName(filename) << " is empty.";
+  }
+  return spill_file;
+}
+
+// Read the field id of each csv column from the field map file,
+// which is separated by blanks, commas or lines. An empty file
+// name means that all the columns are in field 0.
+static std::vector<index_t> read_field_map(const std::string& filename) {
+  std::vector<index_t> field_map;
+  if (filename.empty()) { return field_map; }
+  char* buf = nullptr;
+  uint64 size = ReadFileToMemory(filename, &buf);
+  std::string str(buf, size);
+  delete [] buf;
+  std::vector<std::string> list;
+  SplitStringUsing(str, " ,\t\r\n", &list);
+  for (size_t i = 0; i < list.size(); ++i) {
+    int field = atoi(list[i].c_str());
+    if (field < 0) {
+      LOG(FATAL) << "Invalid field id " << list[i]
+                 << " in the field map " << filename;
+    }
+    field_map.push_back(field);
+  }
+  if (field_map.empty()) {
+    LOG(FATAL) << "The field map " << filename << " is empty.";
+  }
+  return field_map;
+}
+
+// The type of the pages for the model parameters.
+// The name is checked by Checker.
+static PageType page_type(const HyperParam& hyper_param) {
+  PageType type = kNormalPage;
+  ParsePageType(hyper_param.huge_page, &type);
+  return type;
+}
+
+// Report the pages of the model parameters, which can be
+// a fallback of the given type, and their NUMA placement.
+static void print_model_pages(const HyperParam& hyper_param,
+                              Model* model,
+                              const NumaTopology& numa) {
+  PageType type = page_type(hyper_param);
+  PageType used = model->GetPageType();
+  if (type != kNormalPage && used == type) {
+    Color::print_info(
+      StringPrintf("Model parameters are on huge pages: %s",
+                   PageTypeName(used).c_str())
+    );
+  } else if (type != kNormalPage) {
+    Color::print_warning(
+      StringPrintf("Cannot allocate huge pages (%s) for the model, "
+                   "and xLearn uses pages: %s",
+                   PageTypeName(type).c_str(),
+                   PageTypeName(used).c_str())
+    );
+  }
+  if (hyper_param.numa && numa.NumNodes() > 1) {
+    Color::print_info(
+      StringPrintf("Model parameters are interleaved across %d NUMA nodes.",
+                   numa.NumNodes())
+    );
+  }
+}
+
+// Create the thread pool. The workers are divided into
+// contiguous groups, and each group is pinned to a node.
+ThreadPool* Solver::create_pool(size_t thread_number) {
+  if (!hyper_param_.numa) {
+    return new ThreadPool(thread_number);
+  }
+  numa_.Detect();
+  Color::print_info(
+    StringPrintf("NUMA topology: %s", numa_.Report().c_str())
+  );
+  if (numa_.NumNodes() <= 1) {
+    return new ThreadPool(thread_number);
+  }
+  const NumaTopology* numa = &numa_;
+  return new ThreadPool(thread_number, [numa, thread_number](size_t id) {
+    numa->PinThread(numa->NodeOfWorker(id, thread_number));
+  });
+}
+
 // Initialize training task
 void Solver::init_train() {
   /*********************************************************
@@ -193,7 +394,7 @@ void Solver::init_train() {
   if (hyper_param_.thread_number != 0) {
     threadNumber = hyper_param_.thread_number;
   }
-  pool_ = new ThreadPool(threadNumber);
+  pool_ = create_pool(threadNumber);
   Color::print_info(
     StringPrintf("xLearn uses %i threads for training task.",
              threadNumber)
@@ -205,32 +406,28 @@ void Solver::init_train() {
   timer.tic();
   Color::print_action("Read Problem ...");
   LOG(INFO) << "Start to init Reader";
-  // Split file
   if (hyper_param_.from_file) {
-    if (hyper_param_.cross_validation) {
-      CHECK_GT(hyper_param_.num_folds, 0);
-      splitor_.split(hyper_param_.train_set_file,
-                    hyper_param_.num_folds);
-      LOG(INFO) << "Split file into "
-                << hyper_param_.num_folds
-                << " parts.";
+    // A stream can be read only once
+    if (IsStream(hyper_param_.train_set_file)) {
+      hyper_param_.train_set_file = 
+        spill_stream(hyper_param_.train_set_file);
+    }
+    if (!hyper_param_.validate_set_file.empty() &&
+        IsStream(hyper_param_.validate_set_file)) {
+      hyper_param_.validate_set_file = 
+        spill_stream(hyper_param_.validate_set_file);
     }
   }
   // Get the Reader list
   int num_reader = 0;
   if (hyper_param_.from_file) {
     std::vector<std::string> file_list;
-    if (hyper_param_.cross_validation) {
-      num_reader += hyper_param_.num_folds;
-      for (int i = 0; i < hyper_param_.num_folds; ++i) {
-        std::string filename = StringPrintf("%s_%d",
-            hyper_param_.train_set_file.c_str(), i);
-        file_list.push_back(filename);
-      }
-    } else {  // do not use cross-validation
-      num_reader += 1;  // training file
-      CHECK_NE(hyper_param_.train_set_file.empty(), true);
-      file_list.push_back(hyper_param_.train_set_file);
+    num_reader += 1;  // training file
+    CHECK_NE(hyper_param_.train_set_file.empty(), true);
+    file_list.push_back(hyper_param_.train_set_file);
+    // In cross-validation, the training file is read only 
+    // once, and then its rows are split into the folds.
+    if (!hyper_param_.cross_validation) {
       if (!hyper_param_.validate_set_file.empty()) {
         num_reader += 1;  // validation file
         file_list.push_back(hyper_param_.validate_set_file);
@@ -238,16 +435,36 @@ void Solver::init_train() {
     }
     LOG(INFO) << "Number of Reader: " << num_reader;
     reader_.resize(num_reader, nullptr);
+    std::vector<index_t> field_map =
+      read_field_map(hyper_param_.field_map_file);
     // Create Reader
     for (int i = 0; i < num_reader; ++i) {
-      reader_[i] = create_reader();
+      reader_[i] = create_reader(file_list[i]);
       reader_[i]->SetBlockSize(hyper_param_.block_size);
+      reader_[i]->SetPrefetch(hyper_param_.prefetch);
+      reader_[i]->SetMemoryBudget(hyper_param_.mem_budget);
       reader_[i]->SetSeed(hyper_param_.seed);
+      reader_[i]->SetShuffleChunk(hyper_param_.shuffle_chunk);
+      reader_[i]->SetThreadNumber(threadNumber);
       if (hyper_param_.bin_out == false) {
         reader_[i]->SetNoBin();
       }
+      if (hyper_param_.compress) {
+        reader_[i]->SetCompress(true, hyper_param_.quantize);
+      }
+      reader_[i]->SetShuffleWindow(hyper_param_.shuffle_window);
+      reader_[i]->SetFormat(hyper_param_.data_format);
+      reader_[i]->SetFieldMap(field_map);
+      reader_[i]->SetVerifyBin(hyper_param_.verify_bin);
+      reader_[i]->SetBinCompress(hyper_param_.bin_compress);
       reader_[i]->Initialize(file_list[i]);
-      if (!hyper_param_.on_disk) {
+      // The ids are collected before the data is shuffled, so
+      // that the order of training is the same as without map.
+      if (i == 0 && hyper_param_.remap_feature &&
+          hyper_param_.pre_model_file.empty()) {
+        build_feature_map(reader_[i]);
+      }
+      if (!hyper_param_.on_disk || hyper_param_.disk_shuffle) {
         reader_[i]->SetShuffle(true);
       }
       if (reader_[i] == nullptr) {
@@ -259,6 +476,10 @@ void Solver::init_train() {
       }
       LOG(INFO) << "Init Reader: " << file_list[i];
     } 
+    if (hyper_param_.cross_validation) {
+      split_folds();
+      num_reader = reader_.size();
+    }
   } else {
     num_reader += 1;  // training dataset
     std::vector<xLearn::DMatrix*> data_list;
@@ -271,14 +492,24 @@ void Solver::init_train() {
     // Create Reader
     LOG(INFO) << "Number of Reader: " << num_reader;
     reader_.resize(num_reader, nullptr);
+    std::vector<index_t> field_map =
+      read_field_map(hyper_param_.field_map_file);
     for (int i = 0; i < num_reader; ++i) {
       reader_[i] = create_reader();
       reader_[i]->SetBlockSize(hyper_param_.block_size);
       reader_[i]->SetSeed(hyper_param_.seed);
+      reader_[i]->SetShuffleChunk(hyper_param_.shuffle_chunk);
+      reader_[i]->SetThreadNumber(threadNumber);
       if (hyper_param_.bin_out == false) {
         reader_[i]->SetNoBin();
       }
       reader_[i]->Initialize(data_list[i]);
+      // The ids are collected before the data is shuffled, so
+      // that the order of training is the same as without map.
+      if (i == 0 && hyper_param_.remap_feature &&
+          hyper_param_.pre_model_file.empty()) {
+        build_feature_map(reader_[i]);
+      }
       if (!hyper_param_.on_disk) {
         reader_[i]->SetShuffle(true);
       }
@@ -291,21 +522,23 @@ void Solver::init_train() {
   /*********************************************************
    *  Read problem                                         *
    *********************************************************/
-  DMatrix* matrix = nullptr;
+  // The statistics of data are collected by Reader
+  // in initialization, so we don't need another pass.
   index_t max_feat = 0, max_field = 0;
   for (int i = 0; i < num_reader; ++i) {
-    while(reader_[i]->Samples(matrix)) {
-      int tmp = matrix->MaxFeat();
-      if (tmp > max_feat) { max_feat = tmp; }
-      if (hyper_param_.score_func.compare("ffm") == 0) {
-        tmp = matrix->MaxField();
-        if (tmp > max_field) { max_field = tmp; }
-      }
+    max_feat = std::max(max_feat, reader_[i]->MaxFeat());
+    if (hyper_param_.score_func.compare("ffm") == 0) {
+      max_field = std::max(max_field, reader_[i]->MaxField());
     }
-    // Return to the beginning of target file.
-    reader_[i]->Reset();
   }
   hyper_param_.num_feature = max_feat + 1;
+  if (!id_map_.Empty()) {
+    hyper_param_.num_feature = id_map_.Size();
+    Color::print_info(
+      StringPrintf("Map %d used feature ids (max id: %u) to a dense range.",
+                   id_map_.Size(), max_feat)
+    );
+  }
   // Check overflow:
   // INT_MAX +  = 0
   if (hyper_param_.num_feature == 0) {
@@ -314,7 +547,7 @@ void Solver::init_train() {
   }
   LOG(INFO) << "Number of feature: " << hyper_param_.num_feature;
   Color::print_info(
-    StringPrintf("Number of Feature: %d", 
+    StringPrintf("Number of Feature: %u", 
                  hyper_param_.num_feature)
   );
   if (hyper_param_.score_func.compare("ffm") == 0) {
@@ -338,6 +571,10 @@ void Solver::init_train() {
   // Initialize parameters from reader
   if (hyper_param_.pre_model_file.empty()) {
     model_ = new Model();
+    model_->SetPageType(page_type(hyper_param_));
+    if (hyper_param_.numa) {
+      model_->SetNumaTopology(&numa_);
+    }
     if (hyper_param_.opt_type.compare("sgd") == 0) {
       hyper_param_.auxiliary_size = 1;
     } else if (hyper_param_.opt_type.compare("adagrad") == 0) {
@@ -353,15 +590,31 @@ void Solver::init_train() {
                      hyper_param_.auxiliary_size,
                      hyper_param_.model_scale);
   } else { // Initialize parameter from pre-trained model
-    model_ = new Model(hyper_param_.pre_model_file);
+    model_ = new Model(hyper_param_.pre_model_file,
+                       page_type(hyper_param_),
+                       hyper_param_.numa ? &numa_ : nullptr);
+    if (!model_->GetFeatureList().empty()) {
+      id_map_.Build(model_->GetFeatureList());
+    } else if (hyper_param_.remap_feature) {
+      Color::print_warning(
+        "The pre-trained model does not map the feature ids, "
+        "and xLearn has already disable (--remap) option."
+      );
+    }
+  }
+  // The map is saved in the model
+  if (!id_map_.Empty()) {
+    model_->SetFeatureList(id_map_.FeatureList());
+    set_feature_map();
   }
-  index_t num_param = model_->GetNumParameter();
+  param_index_t num_param = model_->GetNumParameter();
   hyper_param_.num_param = num_param;
   LOG(INFO) << "Number parameters: " << num_param;
   Color::print_info(
     StringPrintf("Model size: %s", 
          PrintSize(num_param*sizeof(real_t)).c_str())
   );
+  print_model_pages(hyper_param_, model_, numa_);
   Color::print_info(
     StringPrintf("Time cost for model initial: %.2f (sec)",
          timer.toc())
@@ -405,7 +658,7 @@ void Solver::init_predict() {
   if (hyper_param_.thread_number != 0) {
     threadNumber = hyper_param_.thread_number;
   }
-  pool_ = new ThreadPool(threadNumber);
+  pool_ = create_pool(threadNumber);
   Color::print_info(
     StringPrintf("xLearn uses %i threads for prediction task.",
              threadNumber)
@@ -421,7 +674,9 @@ void Solver::init_predict() {
   );
   Timer timer;
   timer.tic();
-  model_ = new Model(hyper_param_.model_file);
+  model_ = new Model(hyper_param_.model_file,
+                     page_type(hyper_param_),
+                     hyper_param_.numa ? &numa_ : nullptr);
   hyper_param_.score_func = model_->GetScoreFunction();
   hyper_param_.loss_func = model_->GetLossFunction();
   hyper_param_.num_feature = model_->GetNumFeature();
@@ -441,7 +696,7 @@ void Solver::init_predict() {
       hyper_param_.score_func.c_str())
   );
   Color::print_info(
-    StringPrintf("Number of Feature: %d", 
+    StringPrintf("Number of Feature: %u", 
                  hyper_param_.num_feature)
   );
   if (hyper_param_.score_func.compare("fm") == 0 ||
@@ -457,6 +712,7 @@ void Solver::init_predict() {
       );
     }
   }
+  print_model_pages(hyper_param_, model_, numa_);
   Color::print_info(
     StringPrintf("Time cost for loading model: %.2f (sec)",
         timer.toc())
@@ -469,10 +725,18 @@ void Solver::init_predict() {
   timer.reset();
   timer.tic();
   // Create Reader
-  reader_.resize(1, create_reader());
+  reader_.resize(1, create_reader(hyper_param_.test_set_file));
   if (hyper_param_.from_file) {
     CHECK_NE(hyper_param_.test_set_file.empty(), true);
     reader_[0]->SetBlockSize(hyper_param_.block_size);
+    reader_[0]->SetPrefetch(hyper_param_.prefetch);
+    reader_[0]->SetThreadNumber(threadNumber);
+    reader_[0]->SetFormat(hyper_param_.data_format);
+    reader_[0]->SetFieldMap(read_field_map(hyper_param_.field_map_file));
+    reader_[0]->SetVerifyBin(hyper_param_.verify_bin);
+    reader_[0]->SetBinCompress(hyper_param_.bin_compress);
+    // The model fixes the number of features and fields
+    reader_[0]->SetNeedStats(false);
     reader_[0]->Initialize(hyper_param_.test_set_file);
     reader_[0]->SetShuffle(false);
     if (reader_[0] == nullptr) {
@@ -495,6 +759,12 @@ void Solver::init_predict() {
     exit(0);
     }
   }
+  // Map the feature ids in the same way as training,
+  // and drop the features that are not in the model.
+  if (!model_->GetFeatureList().empty()) {
+    id_map_.Build(model_->GetFeatureList());
+    set_feature_map();
+  }
   Color::print_info(
     StringPrintf("Time cost for reading problem: %.2f (sec)",
                   timer.toc())
@@ -632,6 +902,20 @@ void Solver::Clear() {
     }
   }
   reader_.clear();
+  delete cv_reader_;
+  cv_reader_ = nullptr;
+  id_map_.Clear();
+  // Remove the spill files and their cache files
+  for (size_t i = 0; i < spill_files_.size(); ++i) {
+    std::string cache_list[] = { "", ".bin", ".cache" };
+    for (size_t j = 0; j < 3; ++j) {
+      std::string filename = spill_files_[i] + cache_list[j];
+      if (FileExist(filename.c_str())) {
+        RemoveFile(filename.c_str());
+      }
+    }
+  }
+  spill_files_.clear();
 }
 
 } // namespace xLearn
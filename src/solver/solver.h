@@ -23,12 +23,13 @@ This file defines the Solver class, which is the entry of the xLearn.
 
 #include "src/base/common.h"
 #include "src/base/thread_pool.h"
+#include "src/base/numa.h"
 #include "src/data/hyper_parameters.h"
 #include "src/data/data_structure.h"
 #include "src/data/model_parameters.h"
+#include "src/data/feature_id_map.h"
 #include "src/reader/reader.h"
 #include "src/reader/parser.h"
-#include "src/reader/file_splitor.h"
 #include "src/score/score_function.h"
 #include "src/loss/loss.h"
 #include "src/loss/metric.h"
@@ -54,7 +55,8 @@ class Solver {
  public:
   // Constructor and Destructor
   Solver() 
-    : score_(nullptr),
+    : cv_reader_(nullptr),
+      score_(nullptr),
       loss_(nullptr),
       metric_(nullptr) { }
   ~Solver() { }
@@ -92,8 +94,9 @@ class Solver {
   xLearn::Model* model_;
   /* One Reader corresponds one data file */
   std::vector<xLearn::Reader*> reader_;
-  /* Split file in cross-validation */
-  xLearn::FileSpliter splitor_;
+  /* The Reader of the whole training file in cross-validation,
+  and each Reader in reader_ is a fold (a view of its rows) */
+  xLearn::Reader* cv_reader_;
   /* linear, fm or ffm ? */
   xLearn::Score* score_;
   /* cross-entropy or squared ? */
@@ -102,11 +105,21 @@ class Solver {
   xLearn::Metric* metric_;
   /* ThreadPool for multi-thread training */
   ThreadPool* pool_;
+  /* NUMA nodes of the machine, which are
+  detected if hyper_param_.numa is true */
+  NumaTopology numa_;
   /* predict results */
   std::vector<real_t> out_;
-
-  // Create object by name
-  xLearn::Reader* create_reader();
+  /* Spill files of the stream input */
+  std::vector<std::string> spill_files_;
+  /* Map of the feature ids, which is empty
+  if the ids of the data are used */
+  xLearn::FeatureIdMap id_map_;
+
+  // Create object by name. The Reader of a directory, a glob
+  // pattern, or a manifest file is a MultiReader, and the
+  // Reader of a stream (e.g., stdin) is a StreamReader.
+  xLearn::Reader* create_reader(const std::string& filename = "");
   xLearn::Score* create_score();
   xLearn::Loss* create_loss();
   xLearn::Metric* create_metric();
@@ -114,6 +127,19 @@ class Solver {
   // xLearn command line logo
   void print_logo() const;
 
+  // Create the thread pool. If hyper_param_.numa is true,
+  // the workers are pinned to the NUMA nodes.
+  ThreadPool* create_pool(size_t thread_number);
+
+  // Split the rows of cv_reader_ into folds for cross-validation.
+  void split_folds();
+
+  // Collect the feature ids of the training data to id_map_.
+  void build_feature_map(xLearn::Reader* reader);
+
+  // Map the feature ids of all the Readers by id_map_.
+  void set_feature_map();
+
   // Initialize function
   void init_train();
   void init_predict();
@@ -121,6 +147,10 @@ class Solver {
   void checker(int argc, char* argv[]);
   void checker(HyperParam& hyper_param);
 
+  // Copy a stream (e.g., stdin) to a spill file, which can
+  // be read in each epoch. Return the name of the spill file.
+  std::string spill_stream(const std::string& filename);
+
   // Start function
   void start_train_work();
   void start_prediction_work();